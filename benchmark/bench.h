@@ -0,0 +1,35 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+#include <chrono>
+
+#define BENCH_IP_ADDR       "127.0.0.1"
+#define BENCH_PORT          1633
+#define BENCH_SOCKET_PATH   "led_bench.sock"
+#define BENCH_RING_NAME     "/led_bench_ring"
+#define BENCH_RUN_TIME_MS   500                                                 // time spent measuring each configuration
+
+// each benchmark prints its own results to stdout
+void bench_server_throughput();
+void bench_pipeline_throughput();
+void bench_local_transport();
+void bench_io_backend();
+void bench_trickle_receive();
+void bench_codec();
+void bench_delta();
+void bench_compact();
+void bench_preset();
+void bench_multi();
+void bench_large_strip();
+void bench_timeline();
+void bench_render();
+void bench_pru_mem();
+void bench_pru_sim();
+void bench_pacer();
+
+// seconds elapsed since start
+static inline double bench_elapsed_sec(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif // __BENCH_H__
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_message.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "share.h"
+#include "bench.h"
+
+#define BENCH_CODEC_FRAME_COUNT     100000                                      // frames encoded / decoded per measurement
+#define BENCH_STREAM_FRAME_COUNT    2000                                        // frames streamed after warm up
+
+// count every heap allocation made by the benchmark process
+static std::atomic<long> allocation_count(0);
+
+void *operator new(size_t size)
+{
+    void *ptr;
+
+    allocation_count++;
+    ptr = malloc(size ? size : 1);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+static void print_result(const char *name, long allocations, int frame_count, double elapsed)
+{
+    printf("%-22s  %12.2f  %10.0f\n", name, (double)allocations / frame_count, frame_count / elapsed / 1000);
+}
+
+// encode / decode a full strip with the vector api and the caller buffer / view api
+void bench_codec()
+{
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    Led_Strip decoded_leds(WS2812_LED_COUNT);
+    std::vector<uint8_t> buffer(LED_BUFFER_MAX_SIZE);
+    long allocations;
+
+    printf("path                    allocs/frame  kframes/s\n");
+
+    allocations = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_CODEC_FRAME_COUNT; i++)
+    {
+        std::vector<uint8_t> net_frame = leds.get_led_net_frame();
+        decoded_leds.set_leds_from_net_frame(net_frame);
+    }
+    print_result("vector round trip", allocation_count.load() - allocations, BENCH_CODEC_FRAME_COUNT, bench_elapsed_sec(start));
+
+    allocations = allocation_count.load();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_CODEC_FRAME_COUNT; i++)
+    {
+        size_t frame_size = leds.encode_into(buffer.data(), buffer.size());
+        decoded_leds.set_leds_from_frame(buffer.data(), frame_size);
+    }
+    print_result("encode_into round trip", allocation_count.load() - allocations, BENCH_CODEC_FRAME_COUNT, bench_elapsed_sec(start));
+
+    allocations = allocation_count.load();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_CODEC_FRAME_COUNT; i++)
+    {
+        size_t frame_size = leds.encode_into(buffer.data(), buffer.size());
+        Led_Codec::decode_view(buffer.data(), frame_size);
+    }
+    print_result("encode + decode_view", allocation_count.load() - allocations, BENCH_CODEC_FRAME_COUNT, bench_elapsed_sec(start));
+
+    // the ack checksum against the 64-bit content hash used to skip duplicate frames
+    {
+        size_t frame_size = leds.encode_into(buffer.data(), buffer.size());
+        Led_Codec::led_frame_view_t view = Led_Codec::decode_view(buffer.data(), frame_size);
+        volatile uint64_t result = 0;
+
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_CODEC_FRAME_COUNT; i++)
+        {
+            result = result + Led_Message::checksum(buffer.data(), frame_size);
+        }
+        print_result("frame checksum", allocation_count.load() - allocations, BENCH_CODEC_FRAME_COUNT, bench_elapsed_sec(start));
+
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_CODEC_FRAME_COUNT; i++)
+        {
+            result = result + Led_Codec::get_frame_hash(view);
+        }
+        print_result("frame hash", allocation_count.load() - allocations, BENCH_CODEC_FRAME_COUNT, bench_elapsed_sec(start));
+    }
+
+    // client and server in this process - streaming session in steady state
+    {
+        Led_Server_Nonblocking server(BENCH_PORT);
+        Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+        std::vector<uint8_t> frame = leds.get_led_net_frame();
+
+        server.initialize();
+        server.start_server();
+        while (!server.get_server_is_running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // connect and grow every reused buffer first
+        client.set_streaming(true);
+        for (int i = 0; i < 100; i++)
+        {
+            client.send(frame);
+        }
+
+        int pool_hits = client.get_frame_pool_hit_count() + server.get_frame_pool_hit_count();
+        int pool_misses = client.get_frame_pool_miss_count() + server.get_frame_pool_miss_count();
+
+        // same session - the prebuilt frame, a frame built per send, and the strip sent from its storage
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_STREAM_FRAME_COUNT; i++)
+        {
+            client.send(frame);
+        }
+        print_result("streaming send + ack", allocation_count.load() - allocations, BENCH_STREAM_FRAME_COUNT, bench_elapsed_sec(start));
+
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_STREAM_FRAME_COUNT; i++)
+        {
+            std::vector<uint8_t> net_frame = leds.get_led_net_frame();
+            client.send(net_frame);
+        }
+        print_result("frame copy + send", allocation_count.load() - allocations, BENCH_STREAM_FRAME_COUNT, bench_elapsed_sec(start));
+
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_STREAM_FRAME_COUNT; i++)
+        {
+            client.send(leds);
+        }
+        print_result("strip gather send", allocation_count.load() - allocations, BENCH_STREAM_FRAME_COUNT, bench_elapsed_sec(start));
+
+        // an unchanged strip - only its hash is sent after the first frame
+        client.set_dedup(true);
+        allocations = allocation_count.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_STREAM_FRAME_COUNT; i++)
+        {
+            client.send(leds);
+        }
+        print_result("unchanged strip (hash)", allocation_count.load() - allocations, BENCH_STREAM_FRAME_COUNT, bench_elapsed_sec(start));
+        printf("same frames %d, server duplicates %d\n", client.get_same_frame_count(), server.get_duplicate_frame_count());
+
+        // every response buffer of the session recycled through the frame pools
+        printf("frame pool hits %d, misses %d\n", client.get_frame_pool_hit_count() + server.get_frame_pool_hit_count() - pool_hits,
+                client.get_frame_pool_miss_count() + server.get_frame_pool_miss_count() - pool_misses);
+
+        client.close_connection();
+        server.stop_server();
+    }
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_compact.h"
+#include "bench.h"
+
+#define BENCH_COMPACT_ROUNDS        200000                                      // frames encoded / decoded per measurement
+
+static const char *encoding_names[LED_COMPACT_COUNT] = { "raw", "rle", "palette" };
+
+static void bench_pattern(const char *name, Led_Strip &leds)
+{
+    uint8_t frame[LED_BUFFER_MAX_SIZE];
+    uint8_t compact[LED_BUFFER_MAX_SIZE];
+    std::vector<Led_Strip::led_color_t> decoded(LED_MAX_COUNT);
+    led_compact_encoding_t encoding;
+    size_t frame_size = 0;
+    size_t compact_size = 0;
+    double raw_encode_ns;
+    double raw_decode_ns;
+    double compact_encode_ns;
+    double compact_decode_ns;
+    volatile uint32_t result = 0;
+
+    // raw - the led_net_t frame, decoded by copying the colors out of the view
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_COMPACT_ROUNDS; i++)
+    {
+        frame_size = Led_Codec::encode_into(leds.get_led_colors(), LED_MAX_COUNT, frame, sizeof(frame));
+    }
+    raw_encode_ns = bench_elapsed_sec(start) * 1e9 / BENCH_COMPACT_ROUNDS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_COMPACT_ROUNDS; i++)
+    {
+        Led_Codec::led_frame_view_t view = Led_Codec::decode_view(frame, frame_size);
+
+        memcpy(decoded.data(), view.led_colors, view.led_count * sizeof(Led_Strip::led_color_t));
+        result = result + decoded[i % LED_MAX_COUNT].red;
+    }
+    raw_decode_ns = bench_elapsed_sec(start) * 1e9 / BENCH_COMPACT_ROUNDS;
+
+    // compact - priced, encoded with the cheapest encoding and expanded into the colors
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_COMPACT_ROUNDS; i++)
+    {
+        compact_size = Led_Compact::encode_into(leds.get_led_colors(), LED_MAX_COUNT, compact, sizeof(compact));
+    }
+    compact_encode_ns = bench_elapsed_sec(start) * 1e9 / BENCH_COMPACT_ROUNDS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_COMPACT_ROUNDS; i++)
+    {
+        result = result + Led_Compact::decode_into(compact, compact_size, decoded.data(), LED_MAX_COUNT);
+    }
+    compact_decode_ns = bench_elapsed_sec(start) * 1e9 / BENCH_COMPACT_ROUNDS;
+
+    encoding = static_cast<led_compact_encoding_t>(reinterpret_cast<Led_Compact::led_compact_t*>(compact)->compact_encoding);
+    printf("    %-12s raw      %5zu  %8.0f  %8.0f\n", name, frame_size, raw_encode_ns, raw_decode_ns);
+    printf("    %-12s %-7s  %5zu  %8.0f  %8.0f\n", "", encoding_names[encoding], compact_size, compact_encode_ns, compact_decode_ns);
+}
+
+// bytes on the wire and encode / decode cost of compact frames against the raw frame
+void bench_compact()
+{
+    Led_Strip leds(LED_MAX_COUNT, 0, 0, 0);
+
+    printf("%d leds                        bytes  encode ns  decode ns\n", LED_MAX_COUNT);
+
+    leds.set_all_leds(255, 128, 0);
+    bench_pattern("solid", leds);
+
+    leds.set_led_color_range(0, 49, 255, 0, 0);
+    leds.set_led_color_range(100, 149, 0, 255, 0);
+    leds.set_led_color_range(200, 249, 0, 0, 255);
+    bench_pattern("ranges", leds);
+
+    // short repeating pattern - every led starts a new run
+    for (uint32_t i = 0; i < LED_MAX_COUNT; i++)
+    {
+        leds.set_led_color(i, (i % 3) == 0 ? 255 : 0, (i % 3) == 1 ? 255 : 0, (i % 3) == 2 ? 255 : 0);
+    }
+    bench_pattern("theater", leds);
+
+    // gradient - every led a different color
+    for (uint32_t i = 0; i < LED_MAX_COUNT; i++)
+    {
+        leds.set_led_color(i, i, 255 - i, (i * 7) & 0xff);
+    }
+    bench_pattern("gradient", leds);
+}
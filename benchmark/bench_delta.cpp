@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_delta.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "bench.h"
+
+#define BENCH_DIFF_ROUNDS           200000                                      // full strip comparisons per diff measurement
+#define BENCH_DELTA_FRAME_COUNT     2000                                        // frames streamed per session
+
+// byte at a time reference for the diff kernel
+static size_t find_difference_scalar(const uint8_t *base, const uint8_t *frame, size_t offset, size_t size)
+{
+    while (offset < size && base[offset] == frame[offset])
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+static double stream_strip(bool use_delta, size_t *payload_bytes)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    Led_Strip leds(LED_MAX_COUNT, 0, 0, 0);
+    Led_Strip previous(LED_MAX_COUNT, 0, 0, 0);
+    uint8_t delta_buffer[LED_BUFFER_MAX_SIZE];
+    double elapsed;
+
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+    client.set_delta(use_delta);
+    *payload_bytes = 0;
+
+    // a chase of 5 lit leds moving one step per frame
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_DELTA_FRAME_COUNT; i++)
+    {
+        leds.set_led_color(i % LED_MAX_COUNT, 255, 255, 255);
+        leds.set_led_color((i + LED_MAX_COUNT - 5) % LED_MAX_COUNT, 0, 0, 0);
+        client.send(leds);
+
+        // what the frame costs on the wire (without the message header)
+        size_t delta_size = Led_Delta::encode_into(0, previous.get_led_colors(), leds.get_led_colors(), LED_MAX_COUNT,
+                delta_buffer, sizeof(delta_buffer));
+        *payload_bytes += (use_delta && delta_size > 0 && i > 0) ? delta_size : Led_Codec::get_frame_size(LED_MAX_COUNT);
+        previous.set_leds_from_frame(delta_buffer, leds.encode_into(delta_buffer, sizeof(delta_buffer)));
+    }
+    elapsed = bench_elapsed_sec(start);
+
+    client.close_connection();
+    server.stop_server();
+
+    return BENCH_DELTA_FRAME_COUNT / elapsed;
+}
+
+// diff kernel speed, and frames streamed in full vs as deltas
+void bench_delta()
+{
+    Led_Strip base(LED_MAX_COUNT, 10, 20, 30);
+    const uint8_t *base_bytes = reinterpret_cast<const uint8_t*>(base.get_led_colors());
+    std::vector<uint8_t> frame(base_bytes, base_bytes + (LED_MAX_COUNT * sizeof(Led_Strip::led_color_t)));
+    volatile size_t result = 0;
+    size_t payload_bytes;
+    double frames_per_sec;
+
+    // worst case for the kernel - nothing changed, every byte is compared
+    printf("diff kernel (%zu byte strip)   MB/s\n", frame.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_DIFF_ROUNDS; i++)
+    {
+        result = result + find_difference_scalar(base_bytes, frame.data(), 0, frame.size());
+    }
+    printf("    byte loop             %10.0f\n", (double)BENCH_DIFF_ROUNDS * frame.size() / bench_elapsed_sec(start) / 1e6);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_DIFF_ROUNDS; i++)
+    {
+        result = result + Led_Delta::find_difference(base_bytes, frame.data(), 0, frame.size());
+    }
+    printf("    %2d byte blocks        %10.0f\n", LED_DELTA_BLOCK_SIZE, (double)BENCH_DIFF_ROUNDS * frame.size() / bench_elapsed_sec(start) / 1e6);
+
+    printf("streaming             bytes/frame  frames/s\n");
+    frames_per_sec = stream_strip(false, &payload_bytes);
+    printf("    keyframes         %11.1f  %8.0f\n", (double)payload_bytes / BENCH_DELTA_FRAME_COUNT, frames_per_sec);
+    frames_per_sec = stream_strip(true, &payload_bytes);
+    printf("    deltas            %11.1f  %8.0f\n", (double)payload_bytes / BENCH_DELTA_FRAME_COUNT, frames_per_sec);
+}
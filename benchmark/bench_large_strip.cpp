@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <thread>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_frame_pool.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "bench.h"
+
+#define BENCH_LARGE_MAX_LEDS        50000                                       // largest strip measured, the led count limit is raised to it
+
+// pipelined frames of one strip size, every frame changes one led so none is skipped as a duplicate
+static double send_frames(uint32_t led_count, double *frames_per_sec)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    Led_Strip leds(led_count, 0, 0, 255);
+    int frame_count = 0;
+    double elapsed;
+
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        leds.set_led_color(frame_count % led_count, frame_count, frame_count, frame_count);
+        client.send_pipelined(leds);
+        frame_count++;
+    } while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS);
+    client.flush();
+    elapsed = bench_elapsed_sec(start);
+
+    client.close_connection();
+    server.stop_server();
+
+    *frames_per_sec = frame_count / elapsed;
+
+    return (frame_count * Led_Codec::get_frame_size(led_count)) / elapsed / (1024 * 1024);
+}
+
+// frames that fit the receive buffer vs frames streamed into the session strip
+void bench_large_strip()
+{
+    const uint32_t led_counts[] = {LED_MAX_COUNT, 2000, 3000, 10000, BENCH_LARGE_MAX_LEDS};
+    double frames_per_sec;
+    double mbytes_per_sec;
+
+    Led_Codec::set_max_led_count(BENCH_LARGE_MAX_LEDS);
+
+    printf("leds     receive     frames/s      MB/s\n");
+    for (uint32_t led_count : led_counts)
+    {
+        mbytes_per_sec = send_frames(led_count, &frames_per_sec);
+        printf("%-7u  %-8s  %11.0f  %8.1f\n", led_count,
+                (Led_Codec::get_frame_size(led_count) > LED_FRAME_POOL_SLOT_SIZE) ? "streamed" : "buffered", frames_per_sec, mbytes_per_sec);
+    }
+
+    Led_Codec::set_max_led_count(LED_MAX_COUNT);
+}
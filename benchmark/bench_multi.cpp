@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_multi.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "share.h"
+#include "bench.h"
+
+#define BENCH_MULTI_UPDATE_COUNT    1000                                        // updates of every strip per measurement
+
+// every strip changes each update, nothing is skipped as a duplicate
+static double send_updates(int dispatch_thread_count, bool use_multi)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    std::vector<Led_Strip> strips(LED_MAX_STRIPS, Led_Strip(WS2812_LED_COUNT, 0, 0, 0));
+    std::vector<Led_Multi::led_strip_ref_t> strip_refs;
+    double elapsed;
+
+    for (uint32_t i = 0; i < LED_MAX_STRIPS; i++)
+    {
+        strip_refs.push_back({i, &strips[i]});
+    }
+
+    server.set_dispatch_thread_count(dispatch_thread_count);
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MULTI_UPDATE_COUNT; i++)
+    {
+        for (Led_Strip &leds : strips)
+        {
+            leds.set_led_color(i % WS2812_LED_COUNT, i, i, i);
+        }
+
+        // one message for all strips, or one message (and ack) per strip
+        if (use_multi)
+        {
+            client.send_strips(strip_refs);
+        }
+        else
+        {
+            for (Led_Strip &leds : strips)
+            {
+                client.send(leds);
+            }
+        }
+    }
+    elapsed = bench_elapsed_sec(start);
+
+    client.close_connection();
+    server.stop_server();
+
+    return BENCH_MULTI_UPDATE_COUNT / elapsed;
+}
+
+// updating LED_MAX_STRIPS strips with a message per strip vs one multi-strip frame
+void bench_multi()
+{
+    int thread_count = std::max((int)std::thread::hardware_concurrency(), 1);
+    int worker_count = std::max(std::min(thread_count, LED_MAX_STRIPS) - 1, 1);     // at least one, even on a single core
+
+    printf("%d strips of %d leds, %d cores\n", LED_MAX_STRIPS, WS2812_LED_COUNT, thread_count);
+    printf("path                         updates/s\n");
+    printf("%-26s  %10.0f\n", "message per strip", send_updates(0, false));
+    printf("%-26s  %10.0f\n", "multi-strip, serial", send_updates(0, true));
+    printf("%-26s  %10.0f\n", "multi-strip, parallel", send_updates(worker_count, true));
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "led.h"
+#include "led_client.h"
+#include "led_network.h"
+#include "led_message.h"
+#include "share.h"
+#include "bench.h"
+
+// cpu time used by the calling thread
+static double thread_cpu_ms()
+{
+    struct timespec cpu_time;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time);
+    return cpu_time.tv_sec * 1000.0 + cpu_time.tv_nsec / 1000000.0;
+}
+
+static bool receive_exact(int fd, uint8_t *data, size_t size)
+{
+    size_t total = 0;
+
+    while (total < size)
+    {
+        ssize_t bytes_recv = recv(fd, &data[total], size - total, 0);
+        if (bytes_recv <= 0)
+        {
+            return false;
+        }
+        total += bytes_recv;
+    }
+
+    return true;
+}
+
+// accept one client, read its frame and answer with an ack that arrives one byte per interval
+static void trickle_ack_server(int listen_fd, int interval_ms)
+{
+    std::vector<uint8_t> message(LED_HEADER_SIZE);
+    std::vector<uint8_t> ack;
+    int client_fd = accept(listen_fd, nullptr, nullptr);
+
+    if (client_fd < 0)
+    {
+        return;
+    }
+
+    if (receive_exact(client_fd, message.data(), LED_HEADER_SIZE))
+    {
+        message.resize(Led_Network::get_message_size(message.data()));
+        if (receive_exact(client_fd, &message[LED_HEADER_SIZE], message.size() - LED_HEADER_SIZE))
+        {
+            const Led_Message::led_msg_t *msg_header = Led_Message::parse(message);
+
+            ack = Led_Message::create_ack(Led_Message::get_sequence(msg_header), LED_ACK_STATUS_OK,
+                    Led_Message::checksum(msg_header->msg_data, Led_Message::get_payload_size(msg_header)));
+        }
+    }
+
+    for (size_t i = 0; i < ack.size(); i++)
+    {
+        if (interval_ms > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        }
+        send(client_fd, &ack[i], 1, MSG_NOSIGNAL);
+    }
+
+    close(client_fd);
+}
+
+// wall and cpu time of one send() while the server trickles its ack in, header and payload phase
+void bench_trickle_receive()
+{
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    std::vector<uint8_t> frame = leds.get_led_net_frame();
+    struct sockaddr_in server_addr = {};
+    int listen_fd;
+    int opt = 1;
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(BENCH_IP_ADDR);
+    server_addr.sin_port = htons(BENCH_PORT);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0 || listen(listen_fd, 1) < 0)
+    {
+        fprintf(stderr, "failed to listen on port %d\n", BENCH_PORT);
+        if (listen_fd >= 0)
+        {
+            close(listen_fd);
+        }
+        return;
+    }
+
+    printf("interval ms  ack bytes   wall ms    cpu ms\n");
+    for (int interval_ms : {0, 5, 20, 50})
+    {
+        std::thread server_thread(trickle_ack_server, listen_fd, interval_ms);
+        Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+        double wall_ms;
+        double cpu_ms;
+
+        auto start = std::chrono::steady_clock::now();
+        double cpu_start = thread_cpu_ms();
+        try
+        {
+            client.send(frame);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "send failed: %s\n", e.what());
+        }
+        cpu_ms = thread_cpu_ms() - cpu_start;
+        wall_ms = bench_elapsed_sec(start) * 1000;
+
+        server_thread.join();
+        printf("%11d  %9zu  %8.1f  %8.2f\n", interval_ms, LED_MSG_HEADER_SIZE + sizeof(Led_Message::led_ack_t), wall_ms, cpu_ms);
+    }
+
+    close(listen_fd);
+}
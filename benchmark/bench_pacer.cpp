@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "led_frame_pacer.h"
+#include "led_pru_sim.h"
+#include "share.h"
+#include "bench.h"
+
+#define BENCH_PACER_BURST_FRAMES    4                                           // frames sent back to back
+#define BENCH_PACER_BURST_US        25000                                       // between bursts - 160 frames per second on average, unevenly
+
+// bursty frames written as they arrive (refresh_rate 0) or at a fixed rate, shown by the emulated PRU
+static Led_Frame_Pacer::led_pacer_stats_t run_pacer(const char *name, uint32_t refresh_rate)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    std::vector<Led_Strip> strips;
+    Led_Frame_Pacer::led_pacer_stats_t stats;
+    int frame_count = 0;
+
+    // frames differ so none is skipped as a duplicate
+    for (int i = 0; i < 256; i++)
+    {
+        strips.push_back(Led_Strip(WS2812_LED_COUNT, i, 0, 255));
+    }
+
+    server.set_pru_output(true);
+    server.set_output_rate(refresh_rate);
+    server.initialize();
+    Led_Pru_Sim pru_sim;
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+    auto start = std::chrono::steady_clock::now();
+    for (int burst = 0; bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS; burst++)
+    {
+        for (int i = 0; i < BENCH_PACER_BURST_FRAMES; i++)
+        {
+            client.send_pipelined(strips[frame_count % strips.size()]);
+            frame_count++;
+        }
+        client.flush();
+        std::this_thread::sleep_until(start + std::chrono::microseconds((uint64_t)(burst + 1) * BENCH_PACER_BURST_US));
+    }
+
+    // the last frame is latched
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    client.close_connection();
+    server.stop_server();
+
+    stats = server.get_output_pacer_stats();
+    Led_Pru_Sim::led_pru_sim_stats_t pru_stats = pru_sim.get_stats();
+    printf("%-16s  %6d  %7d  %9d  %5d  %6d  %6u  %8.0f  %7u\n", name, frame_count, server.get_output_frame_count(),
+            server.get_output_overwritten_count(), stats.tick_count, stats.missed_tick_count, stats.lateness_us_max,
+            pru_stats.latency_us_avg, pru_stats.latency_us_max);
+
+    return stats;
+}
+
+void bench_pacer()
+{
+    Led_Frame_Pacer::led_pacer_stats_t stats;
+
+    printf("%d leds, bursts of %d frames every %d us, up to %u frames/s\n", WS2812_LED_COUNT, BENCH_PACER_BURST_FRAMES,
+            BENCH_PACER_BURST_US, Led_Frame_Pacer::get_max_refresh_rate());
+    printf("                                              ticks    late us  flip to latch us\n");
+    printf("output            frames  written  coalesced  ticks  missed     max       avg      max\n");
+    run_pacer("as frames arrive", 0);
+    run_pacer("paced 60/s", 60);
+    stats = run_pacer("paced 200/s", 200);
+
+    printf("tick lateness at 200/s\n");
+    for (int i = 0; i < LED_PACER_LATENESS_BUCKETS; i++)
+    {
+        if (Led_Frame_Pacer::get_lateness_bucket_us(i) == UINT32_MAX)
+        {
+            printf("  > %5u us  %6d\n", Led_Frame_Pacer::get_lateness_bucket_us(i - 1), stats.lateness_histogram[i]);
+        }
+        else
+        {
+            printf("  <= %4u us  %6d\n", Led_Frame_Pacer::get_lateness_bucket_us(i), stats.lateness_histogram[i]);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_codec.h"
+#include "led_message.h"
+#include "led_preset_store.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "share.h"
+#include "bench.h"
+
+#define BENCH_PRESET_STORE          "./bench_presets.dat"
+#define BENCH_PRESET_COUNT          64                                          // scenes in the store
+#define BENCH_PRESET_LOOKUPS        200000                                      // find_preset calls per measurement
+#define BENCH_PRESET_FRAME_COUNT    2000                                        // scenes switched per session
+
+// store open / lookup cost, and switching scenes with full frames vs preset ids
+void bench_preset()
+{
+    std::vector<Led_Preset_Store::led_preset_source_t> presets;
+    std::vector<std::vector<uint8_t>> frames;
+    const uint8_t *frame;
+    size_t frame_size;
+    volatile size_t result = 0;
+
+    // scenes of the size a saved file holds, each a different solid color
+    for (int i = 0; i < BENCH_PRESET_COUNT; i++)
+    {
+        Led_Strip leds(WS2812_LED_COUNT, i * 4, 255 - (i * 4), i);
+        std::string file_path = "./bench_preset_" + std::to_string(i) + ".dat";
+
+        leds.save_all_leds(file_path.c_str());
+        presets.push_back({(uint32_t)i, "scene " + std::to_string(i), file_path});
+        frames.push_back(leds.get_led_net_frame());
+    }
+    Led_Preset_Store::create(BENCH_PRESET_STORE, presets);
+    for (const Led_Preset_Store::led_preset_source_t &preset : presets)
+    {
+        remove(preset.file_path.c_str());
+    }
+
+    // opening only maps the file, nothing is parsed until a preset is used
+    auto start = std::chrono::steady_clock::now();
+    {
+        Led_Preset_Store store(BENCH_PRESET_STORE);
+        printf("open %d preset store     %8.1f us\n", BENCH_PRESET_COUNT, bench_elapsed_sec(start) * 1000000);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_PRESET_LOOKUPS; i++)
+        {
+            store.find_preset(i % BENCH_PRESET_COUNT, &frame, &frame_size);
+            result = result + frame_size;
+        }
+        printf("find + validate preset   %8.1f ns\n", bench_elapsed_sec(start) * 1000000000 / BENCH_PRESET_LOOKUPS);
+    }
+
+    // client and server in this process - scenes alternate so none is skipped as a duplicate
+    {
+        Led_Server_Nonblocking server(BENCH_PORT);
+        Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+        double elapsed;
+
+        server.set_preset_store(BENCH_PRESET_STORE);
+        server.initialize();
+        server.start_server();
+        while (!server.get_server_is_running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        client.set_streaming(true);
+        client.send(frames[0]);
+
+        printf("scene switch             bytes/msg  kframes/s\n");
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_PRESET_FRAME_COUNT; i++)
+        {
+            client.send(frames[i % BENCH_PRESET_COUNT]);
+        }
+        elapsed = bench_elapsed_sec(start);
+        printf("%-22s  %10zu  %9.0f\n", "full frame", LED_MSG_HEADER_SIZE + frames[0].size(), BENCH_PRESET_FRAME_COUNT / elapsed / 1000);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_PRESET_FRAME_COUNT; i++)
+        {
+            client.activate_preset(i % BENCH_PRESET_COUNT);
+        }
+        elapsed = bench_elapsed_sec(start);
+        printf("%-22s  %10zu  %9.0f\n", "preset id", LED_MSG_HEADER_SIZE + sizeof(Led_Message::led_preset_msg_t),
+                BENCH_PRESET_FRAME_COUNT / elapsed / 1000);
+
+        client.close_connection();
+        server.stop_server();
+    }
+
+    remove(BENCH_PRESET_STORE);
+}
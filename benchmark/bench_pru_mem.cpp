@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "led.h"
+#include "pru_mem.h"
+#include "share.h"
+#include "bench.h"
+
+// previous write path - bytes copied one at a time through a char view of the word mapping
+static void write_led_bytes(volatile uint32_t *shared_mem_map, const Led_Strip::led_color_t *led_colors, uint32_t led_count)
+{
+    char *shared_mem_bytes = (char*) shared_mem_map;
+    const char *buff = (const char*) led_colors;
+    uint32_t size = led_count * sizeof(Led_Strip::led_color_t);
+
+    shared_mem_bytes[(SHARED_MEM_LED_BUFFER_OFFSET + SHARED_MEM_LED_COUNT_OFFSET) * sizeof(uint32_t)] = led_count;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        shared_mem_bytes[(SHARED_MEM_LED_BUFFER_OFFSET + SHARED_MEM_LED_START_OFFSET) * sizeof(uint32_t) + i] = buff[i];
+    }
+    shared_mem_bytes[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] = 1;
+}
+
+// both write a frame of WS2812_LED_COUNT leds into the SHARED_MEM_MAP_FILE mapping
+void bench_pru_mem()
+{
+    Led_Strip leds(WS2812_LED_COUNT, 1, 2, 3);
+    PruMem pru_mem((const void*)SHARED_MEM_START_ADDR);
+    int shared_mem_fd = open(SHARED_MEM_MAP_FILE, O_RDWR);
+    volatile uint32_t *shared_mem_map = (volatile uint32_t*) mmap(0, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED, shared_mem_fd, SHARED_MEM_START_ADDR);
+    int frame_count;
+
+    if (shared_mem_fd < 0 || shared_mem_map == MAP_FAILED)
+    {
+        printf("failed to map %s\n", SHARED_MEM_MAP_FILE);
+        return;
+    }
+
+    printf("%d leds per frame\n", WS2812_LED_COUNT);
+    printf("write                      ns per frame\n");
+
+    frame_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        write_led_bytes(shared_mem_map, leds.get_led_colors(), WS2812_LED_COUNT);
+        frame_count++;
+    }
+    printf("%-26s  %10.1f\n", "byte loop", bench_elapsed_sec(start) * 1e9 / frame_count);
+
+    frame_count = 0;
+    start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        pru_mem.write_mem_led_count(WS2812_LED_COUNT);
+        pru_mem.write_mem_led_colors(leds.get_led_colors(), WS2812_LED_COUNT);
+        pru_mem.write_mem_led_start();
+        frame_count++;
+    }
+    printf("%-26s  %10.1f\n", "word per led + barrier", bench_elapsed_sec(start) * 1e9 / frame_count);
+
+    munmap((void*)shared_mem_map, getpagesize());
+    close(shared_mem_fd);
+}
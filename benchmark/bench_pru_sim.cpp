@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "led_pru_sim.h"
+#include "share.h"
+#include "bench.h"
+
+// frames sent to the server every frame_interval_us (0 flat out), shown by the emulated PRU and strip
+static void run_pru_sim(const char *name, uint32_t frame_interval_us)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    std::vector<Led_Strip> strips;
+    int frame_count = 0;
+
+    // frames differ so none is skipped as a duplicate
+    for (int i = 0; i < 256; i++)
+    {
+        strips.push_back(Led_Strip(WS2812_LED_COUNT, i, 0, 255));
+    }
+
+    server.set_pru_output(true);
+    server.initialize();
+    Led_Pru_Sim pru_sim;
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+    auto start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        client.send_pipelined(strips[frame_count % strips.size()]);
+        frame_count++;
+        if (frame_interval_us > 0)
+        {
+            std::this_thread::sleep_until(start + std::chrono::microseconds((uint64_t)frame_count * frame_interval_us));
+        }
+    }
+    client.flush();
+
+    // the last frame is latched
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    client.close_connection();
+    server.stop_server();
+
+    Led_Pru_Sim::led_pru_sim_stats_t stats = pru_sim.get_stats();
+    printf("%-12s  %6d  %6d  %11d  %7d  %7.0f  %6u  %8.0f  %6u\n", name, frame_count, stats.frame_count,
+            server.get_output_overwritten_count(), stats.dropped_count,
+            stats.queued_us_avg, stats.queued_us_max, stats.latency_us_avg, stats.latency_us_max);
+}
+
+void bench_pru_sim()
+{
+    printf("%d leds: %u us per frame, up to %.1f frames/s\n", WS2812_LED_COUNT, (uint32_t)WS2812_FRAME_US, 1e6 / WS2812_FRAME_US);
+    printf("                            server  PRU       queued us        flip to latch us\n");
+    printf("sent by       frames   shown  overwritten  dropped      avg     max       avg     max\n");
+    run_pru_sim("60/s", 16667);
+    run_pru_sim("200/s", 5000);
+    run_pru_sim("flat out", 0);
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "led_triple_buffer.h"
+#include "pru_mem.h"
+#include "share.h"
+#include "bench.h"
+
+// pipelined frames received with and without the PRU output thread writing the newest one
+static void run_output(bool pru_output)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    std::vector<Led_Strip> strips;
+    int frame_count = 0;
+
+    // frames differ so none is skipped as a duplicate
+    for (int i = 0; i < 256; i++)
+    {
+        strips.push_back(Led_Strip(WS2812_LED_COUNT, i, 0, 255));
+    }
+
+    server.set_pru_output(pru_output);
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+    auto start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        client.send_pipelined(strips[frame_count % strips.size()]);
+        frame_count++;
+    }
+    client.flush();
+    double elapsed_sec = bench_elapsed_sec(start);
+
+    client.close_connection();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    server.stop_server();
+
+    printf("%-26s  %12.0f  %10d  %12d\n", pru_output ? "output thread" : "no output", frame_count / elapsed_sec,
+            server.get_output_frame_count(), server.get_output_overwritten_count());
+}
+
+// cost on the receive path per frame - publishing to the output thread vs writing the PRU memory in place
+static void run_publish()
+{
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    Led_Codec::led_frame_view_t view = {(uint32_t)leds.get_led_count(), leds.get_led_colors()};
+    Led_Triple_Buffer output_frames;
+    PruMem pru_mem((const void*)SHARED_MEM_START_ADDR);
+    int frame_count = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        output_frames.publish(view);
+        frame_count++;
+    }
+    printf("%-26s  %10.1f\n", "publish", bench_elapsed_sec(start) * 1e9 / frame_count);
+
+    frame_count = 0;
+    start = std::chrono::steady_clock::now();
+    while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+    {
+        pru_mem.write_mem_led_count(view.led_count);
+        pru_mem.write_mem_led_colors(view.led_colors, view.led_count);
+        pru_mem.write_mem_led_start();
+        frame_count++;
+    }
+    printf("%-26s  %10.1f\n", "write PRU memory", bench_elapsed_sec(start) * 1e9 / frame_count);
+}
+
+void bench_render()
+{
+    printf("%d leds per frame\n", WS2812_LED_COUNT);
+    printf("receive path               ns per frame\n");
+    run_publish();
+
+    printf("server                       frames/s     written   overwritten\n");
+    run_output(false);
+    run_output(true);
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "led.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "share.h"
+#include "bench.h"
+
+// send frames until stop is set, either one connection per frame or one streaming session
+static void producer(std::atomic<bool> *stop, std::atomic<int> *frame_count, bool streaming)
+{
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    std::vector<uint8_t> frame = leds.get_led_net_frame();
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+
+    client.set_streaming(streaming);
+    while (!stop->load())
+    {
+        try
+        {
+            client.send(frame);
+            (*frame_count)++;
+        }
+        catch (...)
+        {
+            // count only delivered frames
+        }
+    }
+}
+
+// connect and send a partial header, then never finish the frame
+static int connect_stalled_client()
+{
+    struct sockaddr_in server_addr = {};
+    int stalled_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(BENCH_IP_ADDR);
+    server_addr.sin_port = htons(BENCH_PORT);
+
+    if (stalled_fd >= 0)
+    {
+        if (connect(stalled_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0)
+        {
+            send(stalled_fd, LED_MAGIC, LED_MAGIC_LEN, 0);
+        }
+    }
+
+    return stalled_fd;
+}
+
+// returns frames/s delivered by all producers together
+static double run_producers(int producer_count, bool with_stalled_client, bool streaming,
+        led_io_backend_t io_backend = LED_IO_BACKEND_EPOLL)
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    std::atomic<bool> stop(false);
+    std::atomic<int> frame_count(0);
+    std::vector<std::thread> producers;
+    int stalled_fd = -1;
+
+    server.set_io_backend(io_backend);
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (with_stalled_client)
+    {
+        stalled_fd = connect_stalled_client();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < producer_count; i++)
+    {
+        producers.push_back(std::thread(producer, &stop, &frame_count, streaming));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_TIME_MS));
+    stop.store(true);
+    for (auto &thread : producers)
+    {
+        thread.join();
+    }
+    double elapsed = bench_elapsed_sec(start);
+
+    if (stalled_fd >= 0)
+    {
+        close(stalled_fd);
+    }
+    server.stop_server();
+
+    return frame_count.load() / elapsed;
+}
+
+void bench_server_throughput()
+{
+    printf("producers  stalled  streaming    frames/s\n");
+
+    for (int producer_count = 1; producer_count <= 8; producer_count *= 2)
+    {
+        printf("%9d  %7s  %9s  %10.0f\n", producer_count, "no", "no", run_producers(producer_count, false, false));
+    }
+    printf("%9d  %7s  %9s  %10.0f\n", 4, "yes", "no", run_producers(4, true, false));
+
+    // one session per producer instead of a TCP handshake per frame
+    for (int producer_count = 1; producer_count <= 8; producer_count *= 2)
+    {
+        printf("%9d  %7s  %9s  %10.0f\n", producer_count, "no", "yes", run_producers(producer_count, false, true));
+    }
+}
+
+// streaming producers against the epoll and io_uring server loops
+void bench_io_backend()
+{
+    printf("  backend  producers    frames/s\n");
+
+    for (int backend = LED_IO_BACKEND_EPOLL; backend < LED_IO_BACKEND_COUNT; backend++)
+    {
+        for (int producer_count = 1; producer_count <= 16; producer_count *= 4)
+        {
+            double frame_rate = run_producers(producer_count, false, true, (led_io_backend_t)backend);
+
+            printf("%9s  %9d  %10.0f\n", (backend == LED_IO_BACKEND_URING) ? "io_uring" : "epoll", producer_count, frame_rate);
+        }
+    }
+}
+
+// frames/s for stop-and-wait send() compared to pipelined sends with increasing windows
+void bench_pipeline_throughput()
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    std::vector<uint8_t> frame = leds.get_led_net_frame();
+
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    printf("   window    frames    frames/s\n");
+    for (int window_size = 0; window_size <= 32; window_size = (window_size ? window_size * 4 : 1))
+    {
+        Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+        int frame_count = 0;
+
+        client.set_streaming(true);
+        auto start = std::chrono::steady_clock::now();
+        while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+        {
+            // window 0 - stop-and-wait send()
+            if (window_size == 0)
+            {
+                client.send(frame);
+            }
+            else
+            {
+                client.set_window_size(window_size);
+                client.send_pipelined(frame);
+            }
+            frame_count++;
+        }
+        client.flush();
+        double elapsed = bench_elapsed_sec(start);
+
+        printf("%9d  %8d  %10.0f\n", window_size, frame_count, frame_count / elapsed);
+    }
+
+    server.stop_server();
+}
+
+// frames/s from one same host producer over each local ingest path
+void bench_local_transport()
+{
+    Led_Strip leds(WS2812_LED_COUNT, 0, 0, 255);
+    std::vector<uint8_t> frame = leds.get_led_net_frame();
+
+    printf("transport    frames    frames/s\n");
+
+    // TCP on loopback and unix socket - streaming session, one ack per frame
+    for (int transport = 0; transport < 2; transport++)
+    {
+        std::unique_ptr<Led_Server_Nonblocking> server;
+        std::unique_ptr<Led_Client> client;
+        int frame_count = 0;
+
+        if (transport == 0)
+        {
+            server = std::unique_ptr<Led_Server_Nonblocking>(new Led_Server_Nonblocking(BENCH_PORT));
+            client = std::unique_ptr<Led_Client>(new Led_Client(BENCH_IP_ADDR, BENCH_PORT));
+        }
+        else
+        {
+            server = std::unique_ptr<Led_Server_Nonblocking>(new Led_Server_Nonblocking(BENCH_SOCKET_PATH));
+            client = std::unique_ptr<Led_Client>(new Led_Client(BENCH_SOCKET_PATH));
+        }
+
+        server->initialize();
+        server->start_server();
+        while (!server->get_server_is_running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        client->set_streaming(true);
+        auto start = std::chrono::steady_clock::now();
+        while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+        {
+            client->send(frame);
+            frame_count++;
+        }
+        double elapsed = bench_elapsed_sec(start);
+        client->close_connection();
+        server->stop_server();
+
+        printf("%9s  %8d  %10.0f\n", (transport == 0) ? "tcp" : "unix", frame_count, frame_count / elapsed);
+    }
+
+    // shared memory ring - count frames the server consumed
+    {
+        Led_Server_Nonblocking server(BENCH_PORT);
+        int frame_count;
+
+        server.set_shm_ring(BENCH_RING_NAME);
+        server.initialize();
+        server.start_server();
+        while (!server.get_server_is_running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Led_Shm_Producer producer(BENCH_RING_NAME);
+        auto start = std::chrono::steady_clock::now();
+        while (bench_elapsed_sec(start) * 1000 < BENCH_RUN_TIME_MS)
+        {
+            if (!producer.send(frame))
+            {
+                std::this_thread::yield();
+            }
+        }
+        double elapsed = bench_elapsed_sec(start);
+        frame_count = server.get_receive_message_count();
+        server.stop_server();
+
+        printf("%9s  %8d  %10.0f\n", "shm", frame_count, frame_count / elapsed);
+    }
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "led.h"
+#include "led_timeline.h"
+#include "led_client.h"
+#include "led_server.h"
+#include "bench.h"
+
+#define BENCH_TIMELINE_FRAME_US     16667                                       // 60 frames per second
+#define BENCH_TIMELINE_FRAME_COUNT  (BENCH_RUN_TIME_MS * 1000 / BENCH_TIMELINE_FRAME_US)
+
+// uploading an animation frame by frame (a round trip each) vs as one timeline, then playing it out
+void bench_timeline()
+{
+    Led_Server_Nonblocking server(BENCH_PORT);
+    Led_Client client(BENCH_IP_ADDR, BENCH_PORT);
+    std::vector<Led_Strip> strips;
+    std::vector<Led_Timeline::led_timeline_ref_t> frames;
+    double frame_by_frame_us;
+    double timeline_us;
+
+    strips.reserve(BENCH_TIMELINE_FRAME_COUNT);
+    for (int i = 0; i < BENCH_TIMELINE_FRAME_COUNT; i++)
+    {
+        strips.push_back(Led_Strip(LED_MAX_COUNT, i, 0, 255));
+        frames.push_back({(uint32_t)(i * BENCH_TIMELINE_FRAME_US), &strips.back()});
+    }
+
+    server.initialize();
+    server.start_server();
+    while (!server.get_server_is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    client.set_streaming(true);
+
+    auto start = std::chrono::steady_clock::now();
+    for (Led_Strip &leds : strips)
+    {
+        client.send(leds);
+    }
+    frame_by_frame_us = bench_elapsed_sec(start) * 1e6;
+
+    start = std::chrono::steady_clock::now();
+    client.send_timeline(frames);
+    timeline_us = bench_elapsed_sec(start) * 1e6;
+
+    // wait for the last frame to be shown
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_TIME_MS + 50));
+
+    client.close_connection();
+    server.stop_server();
+
+    printf("%d frames of %d leds, 60 per second\n", BENCH_TIMELINE_FRAME_COUNT, LED_MAX_COUNT);
+    printf("upload                       total us\n");
+    printf("%-26s  %10.0f\n", "frame by frame", frame_by_frame_us);
+    printf("%-26s  %10.0f\n", "timeline", timeline_us);
+    printf("playout: %d shown, %d late (> %d us), %d dropped\n", server.get_strip_frame_count(0) - BENCH_TIMELINE_FRAME_COUNT,
+            server.get_playout_late_count(), LED_PLAYOUT_LATE_US, server.get_playout_dropped_count());
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "debug.h"
+#include "bench.h"
+
+debug_mode_t debug_mode = DEBUG_OFF;
+
+typedef struct bench_entry_t
+{
+    const char *name;
+    void (*run)();
+} bench_entry_t;
+
+static const bench_entry_t bench_list[] =
+{
+    {"server_throughput",   bench_server_throughput},
+    {"pipeline_throughput", bench_pipeline_throughput},
+    {"local_transport",     bench_local_transport},
+    {"io_backend",          bench_io_backend},
+    {"trickle_receive",     bench_trickle_receive},
+    {"codec",               bench_codec},
+    {"delta",               bench_delta},
+    {"compact",             bench_compact},
+    {"preset",              bench_preset},
+    {"multi",               bench_multi},
+    {"large_strip",         bench_large_strip},
+    {"timeline",            bench_timeline},
+    {"render",              bench_render},
+    {"pru_mem",             bench_pru_mem},
+    {"pru_sim",             bench_pru_sim},
+    {"pacer",               bench_pacer},
+};
+
+static const int bench_count = sizeof(bench_list) / sizeof(bench_list[0]);
+
+void usage(const char *executable_name)
+{
+    fprintf(stderr, "usage: %s [benchmark ...]\n", executable_name);
+    fprintf(stderr, "    run all benchmarks when no name is given\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "    benchmarks:\n");
+    for (int i = 0; i < bench_count; i++)
+    {
+        fprintf(stderr, "        %s\n", bench_list[i].name);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // no arguments - run everything
+    if (argc < 2)
+    {
+        for (int i = 0; i < bench_count; i++)
+        {
+            printf("== %s\n", bench_list[i].name);
+            bench_list[i].run();
+        }
+
+        return 0;
+    }
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        int i;
+
+        for (i = 0; i < bench_count; i++)
+        {
+            if (strcmp(argv[arg], bench_list[i].name) == 0)
+            {
+                printf("== %s\n", bench_list[i].name);
+                bench_list[i].run();
+                break;
+            }
+        }
+
+        if (i == bench_count)
+        {
+            fprintf(stderr, "unknown benchmark %s\n", argv[arg]);
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -51,5 +51,6 @@ extern debug_mode_t debug_mode;
 } while (0)
 
 void dbg_verbose_print_vector(const std::vector<uint8_t> &client_message);
+void dbg_verbose_print_buffer(const uint8_t *client_message, size_t size);
 
 #endif //__DEBUG_H__
@@ -6,9 +6,10 @@
 
 #define LED_MAGIC                   "LEDS"
 #define LED_MAGIC_LEN               (sizeof(LED_MAGIC) - 1)
-#define LED_MAX_COUNT               250
+#define LED_MAX_COUNT               250                                         // default led count limit, see Led_Codec::set_max_led_count
+#define LED_MAX_COUNT_LIMIT         65536                                       // largest led count limit that may be configured
 #define LED_HEADER_SIZE             (LED_MAGIC_LEN + sizeof(uint32_t))
-#define LED_BUFFER_MAX_SIZE         (LED_HEADER_SIZE + (LED_MAX_COUNT * 3))
+#define LED_BUFFER_MAX_SIZE         (LED_HEADER_SIZE + (LED_MAX_COUNT * 3))     // frame of a default size strip, sizes the preallocated buffers
 
 class Led_Strip
 {
@@ -43,6 +44,10 @@ public:
 
     //led_color_t *get_led_color(uint32_t led_index);
     int get_led_count();
+
+    // internal color storage, valid until the strip is resized - lets senders skip the copy into a frame
+    const led_color_t *get_led_colors();
+
     std::unique_ptr<led_color_t> get_led_color(uint32_t led_index);
 
     Led_Strip& set_led_color(uint32_t led_index, const led_color_t *led_color);
@@ -64,12 +69,22 @@ public:
     std::vector<uint8_t> get_led_net_frame();
     Led_Strip& set_leds_from_net_frame(std::vector<uint8_t> &net_frame);
 
+    // allocation free versions - encode into a caller buffer (returns bytes written), and
+    // decode in place (reuses the strip storage once it is large enough)
+    size_t encode_into(uint8_t *buffer, size_t buffer_size);
+    Led_Strip& set_leds_from_frame(const uint8_t *net_frame, size_t frame_size);
+
+    // expand a Led_Compact frame (raw, run-length or palette) straight into the strip storage
+    Led_Strip& set_leds_from_compact(const uint8_t *compact, size_t compact_size);
+
 private:
     std::vector<led_color_t> led_strip;
     static const led_color_t led_color_white;
     static const std::string led_magic;
     static const int led_file_min_len;
-    static const int led_file_max_len;
+
+    // follows the configured led count limit
+    static size_t get_led_file_max_len();
 };
 
 //int led_write_file(led_config_t *config, const char *file_name);
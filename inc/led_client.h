@@ -4,26 +4,177 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <memory>
 
 #include "led.h"
 #include "led_network.h"
+#include "led_codec.h"
+#include "led_shm_ring.h"
+#include "led_multi.h"
+#include "led_timeline.h"
+
+#define LED_PIPELINE_DEFAULT_WINDOW 8                                           // frames in flight before send_pipelined waits for an ack
+#define LED_PIPELINE_MAX_WINDOW     256
+#define LED_FRAME_MAX_IOV           (1 + (2 * LED_MAX_STRIPS))                  // pieces a payload may be gathered from (header + colors, per strip for multi-strip frames)
+#define LED_ZEROCOPY_MIN_SIZE       (10 * 1024)                                 // below this, copying is cheaper than pinning pages and waiting for completion
 
 class Led_Client : public Led_Network
 {
 public:
-    Led_Client(std::string ip_addr, int port);
+    Led_Client(std::string ip_addr, int port, led_transport_t transport = LED_TRANSPORT_TCP);
+
+    // connect to a same host server on an AF_UNIX socket path
+    Led_Client(std::string socket_path);
     ~Led_Client() override;
 
     void initialize();
     void send(std::vector<uint8_t> &client_message);
 
+    // send a strip without building a frame first - only the headers are encoded (on the stack),
+    // the colors are gathered by sendmsg straight from the strip storage
+    void send(Led_Strip &leds);
+
+    // show a preset from the server's store - a few bytes instead of a full frame,
+    // throws if the server has no such preset
+    void activate_preset(uint32_t preset_id);
+
+    // send up to LED_MAX_STRIPS strips in one multi-strip message and wait for its ack - each strip is
+    // gathered from its storage, the server applies all of them or none (stream transports only)
+    void send_strips(const std::vector<Led_Multi::led_strip_ref_t> &strips);
+
+    // upload frames the server shows at their offsets (microseconds, in order) from its own clock -
+    // split into as many timeline messages as needed, sent without waiting for each ack, and returns once all
+    // are queued on the server - continue_timeline keeps the start of the previous timeline, which needs streaming
+    void send_timeline(const std::vector<Led_Timeline::led_timeline_ref_t> &frames, bool continue_timeline = false);
+
+    // send several frames at once - UDP uses one sendmmsg call, TCP pipelines them
+    void send_batch(const std::vector<std::vector<uint8_t>> &client_messages);
+
+    // streaming sessions keep one connection open for many frames,
+    // otherwise the connection is closed after each response
+    void set_streaming(bool enable);
+    bool get_streaming();
+    void close_connection();
+
+    // pipelined mode - up to window_size sequenced frames are in flight, the server
+    // acknowledges each one by sequence number instead of echoing the frame
+    void set_window_size(int window_size);
+    int get_window_size();
+    uint32_t send_pipelined(const std::vector<uint8_t> &client_message);
+    uint32_t send_pipelined(Led_Strip &leds);
+    void flush();
+    int get_outstanding_count();
+    uint32_t get_acked_sequence();
+
+    // debug mode - server returns the full frame instead of a small ack
+    void set_echo(bool enable);
+    bool get_echo();
+
+    // status of the most recent ack and number of frames the server did not apply
+    uint32_t get_last_ack_status();
+    int get_rejected_count();
+
+    // delta frames for strips sent with send(Led_Strip&) on a stream connection (not pipelined / echoed)
+    //   - only the spans changed since the last acknowledged frame are sent
+    //   - a keyframe is sent instead if the delta would be larger, or the server has no base (new session)
+    void set_delta(bool enable);
+    bool get_delta();
+    int get_delta_frame_count();
+    int get_keyframe_count();
+
+    // compact frames for strips sent with send(Led_Strip&) or send_pipelined(Led_Strip&)
+    //   - run-length or palette encoded when that is smaller than the raw colors, chosen per frame
+    //   - combined with delta frames, whichever of the two is smaller is sent
+    void set_compact(bool enable);
+    bool get_compact();
+    int get_compact_frame_count();
+
+    // strips sent with send(Led_Strip&) that equal the last acknowledged one are sent as their 64-bit
+    // content hash only, the server acks without decoding anything if it still shows that frame
+    void set_dedup(bool enable);
+    bool get_dedup();
+    int get_same_frame_count();
+
+    // MSG_ZEROCOPY for TCP messages of at least min_size bytes, applied when the next connection is opened
+    //   - the kernel sends from the caller's pages, a send returns once it reported them released
+    //   - sockets without support (AF_UNIX, UDP, older kernels) keep copying sends
+    //   - copied count - zero copy sends the kernel still had to copy (e.g. over loopback)
+    void set_zerocopy(bool enable, size_t min_size = LED_ZEROCOPY_MIN_SIZE);
+    bool get_zerocopy();
+    int get_zerocopy_send_count();
+    int get_zerocopy_copied_count();
+
 private:
     struct sockaddr_in server_addr;
     std::string server_ip;
     int server_port;
+    std::string server_path;
+    bool streaming;
+    int window_size;
+    uint32_t sent_sequence;
+    uint32_t acked_sequence;
+    bool echo;
+    uint32_t last_ack_status;
+    int rejected_count;
+    std::vector<uint32_t> outstanding_checksums;                                // ring indexed by sequence, holds the unacknowledged frames
+    bool zerocopy;
+    size_t zerocopy_min_size;
+    bool zerocopy_enabled;                                                      // SO_ZEROCOPY set on the current socket
+    uint32_t zerocopy_started;                                                  // completion ids handed out / reported by the kernel
+    uint32_t zerocopy_completed;
+    int zerocopy_send_count;
+    int zerocopy_copied_count;
+    bool delta;
+    std::vector<Led_Strip::led_color_t> delta_base;                             // colors of the last acknowledged strip
+    uint32_t delta_base_sequence;
+    bool delta_base_valid;
+    int delta_frame_count;
+    int keyframe_count;
+    bool compact;
+    int compact_frame_count;
+    bool dedup;
+    uint64_t applied_hash;                                                      // content hash of the last acknowledged strip
+    bool applied_hash_valid;
+    int same_frame_count;
 
     void bind_socket();
+    void bind_unix_socket();
     void set_socket_timeout();
+    void enable_zerocopy();
+    void wait_zerocopy_completions();
+    void send_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view = nullptr);
+    uint32_t send_pipelined_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view = nullptr);
+    void exchange_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view);
+    size_t encode_compact(const Led_Codec::led_frame_view_t &frame_view, Led_Frame_Pool::Buffer &compact_buffer);
+    bool send_same(uint64_t frame_hash);
+    bool send_delta(uint32_t frame_checksum, const Led_Codec::led_frame_view_t &frame_view, size_t max_size);
+    void send_message(uint8_t type, const struct iovec *payload_iov, int payload_iov_count, uint8_t flags, uint32_t frame_checksum);
+    void receive_ack();
+    void receive_echo();
+    void receive_available_acks();
+};
+
+// same host producer that writes frames to a server's shared memory ring instead of a socket
+class Led_Shm_Producer
+{
+public:
+    Led_Shm_Producer(std::string ring_name);
+    ~Led_Shm_Producer();
+
+    // attach to the ring created by Led_Server::set_shm_ring
+    void initialize();
+
+    // returns false (and counts a dropped frame) if the server has not consumed the ring yet
+    bool send(const std::vector<uint8_t> &client_message);
+
+    int get_send_message_count();
+    int get_dropped_count();
+
+private:
+    std::string ring_name;
+    std::unique_ptr<Led_Shm_Ring> ring;
+    int send_message_count;
+    int dropped_count;
 };
 
 #endif // ifndef __LED_CLIENT_H__
@@ -0,0 +1,50 @@
+#ifndef __LED_CODEC_H__
+#define __LED_CODEC_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_CODEC_HASH_SEED         0x9e3779b97f4a7c15ull                       // frame hash seed (golden ratio)
+
+// encode / decode "LEDS" frames (led_net_t) without owning any memory
+//   - encode_into writes a frame straight into a caller supplied buffer
+//   - encode_header_into writes just the header for gather (writev / sendmsg) sends
+//   - decode_view validates received bytes in place and points into them
+//   - get_frame_hash identifies a frame's content, to skip frames that are already applied
+//   - the led count limit is set once for the process, frames above it are refused everywhere
+class Led_Codec
+{
+public:
+    // non-owning view of a decoded frame, valid while the buffer it was decoded from is unchanged
+    typedef struct led_frame_view_t
+    {
+        uint32_t led_count;
+        const Led_Strip::led_color_t *led_colors;
+    } led_frame_view_t;
+
+    // largest led count accepted in a frame, LED_MAX_COUNT unless raised (range 1-LED_MAX_COUNT_LIMIT) -
+    // set it before clients or servers start, buffers already handed out keep their size
+    static void set_max_led_count(uint32_t max_led_count);
+    static uint32_t get_max_led_count();
+
+    // bytes needed to encode led_count colors
+    static size_t get_frame_size(uint32_t led_count);
+
+    // returns the frame size, throws if the buffer is too small
+    static size_t encode_into(const Led_Strip::led_color_t *led_colors, uint32_t led_count, uint8_t *buffer, size_t buffer_size);
+
+    // write only the led_net_t header, for colors sent straight from their own storage
+    static size_t encode_header_into(uint32_t led_count, uint8_t *buffer, size_t buffer_size);
+
+    // throws if magic, led count or size are invalid
+    static led_frame_view_t decode_view(const uint8_t *frame, size_t frame_size);
+
+    // fast non-cryptographic 64-bit hash - four independent 8 byte lanes, the same on either byte order
+    static uint64_t hash(const uint8_t *data, size_t size, uint64_t seed = LED_CODEC_HASH_SEED);
+
+    // hash of the colors seeded with the led count, equal frames hash equal however they were sent
+    static uint64_t get_frame_hash(const led_frame_view_t &view);
+};
+
+#endif // __LED_CODEC_H__
@@ -0,0 +1,61 @@
+#ifndef __LED_COMPACT_H__
+#define __LED_COMPACT_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_COMPACT_MAX_RUN         256                                         // leds per run-length entry
+#define LED_COMPACT_MAX_PALETTE     256                                         // colors a palette frame may index
+
+typedef enum
+{
+    LED_COMPACT_RAW,                                                            // colors as in led_net_t
+    LED_COMPACT_RLE,                                                            // (length, color) runs - solid fills and ranges
+    LED_COMPACT_PALETTE,                                                        // palette + 1 / 2 / 4 / 8 bit index per led
+    LED_COMPACT_COUNT
+} led_compact_encoding_t;
+
+// compact frame encodings, the cheapest one is chosen per frame
+//   - choose_encoding prices the encodings exactly from the run count and the distinct colors, the
+//     palette is only built while it could still be the smallest
+//   - decode_into validates the whole frame first, then expands it straight into the caller's colors
+class Led_Compact
+{
+public:
+    // compact payload (network order), followed by the encoded colors
+    //   RAW      - led_count colors
+    //   RLE      - led_run_t entries covering led_count leds
+    //   PALETTE  - palette_size colors, then led_count indexes of index_bits each (packed from the low bits)
+    typedef struct led_compact_t
+    {
+        uint32_t compact_led_count;
+        uint8_t compact_encoding;
+        uint8_t compact_index_bits;
+        uint16_t compact_palette_size;
+        uint8_t compact_data[0];
+    } __attribute__((packed)) led_compact_t;
+
+    typedef struct led_run_t
+    {
+        uint8_t run_length;                                                     // leds in this run - 1
+        Led_Strip::led_color_t run_color;
+    } __attribute__((packed)) led_run_t;
+
+    // cheapest encoding for the colors and its encoded size (header included)
+    static led_compact_encoding_t choose_encoding(const Led_Strip::led_color_t *led_colors, uint32_t led_count, size_t *encoded_size);
+
+    // encode with the cheapest encoding, or a given one - returns the encoded size, throws if the
+    // buffer is too small or the colors do not fit a palette
+    static size_t encode_into(const Led_Strip::led_color_t *led_colors, uint32_t led_count, uint8_t *buffer, size_t buffer_size);
+    static size_t encode_into(led_compact_encoding_t encoding, const Led_Strip::led_color_t *led_colors, uint32_t led_count,
+            uint8_t *buffer, size_t buffer_size);
+
+    // check the whole frame and return its led count, throws if anything is invalid
+    static uint32_t validate(const uint8_t *compact, size_t compact_size);
+
+    // expand into up to max_led_count colors, returns the led count - nothing is written if the frame is invalid
+    static uint32_t decode_into(const uint8_t *compact, size_t compact_size, Led_Strip::led_color_t *led_colors, uint32_t max_led_count);
+};
+
+#endif // __LED_COMPACT_H__
@@ -0,0 +1,108 @@
+#ifndef __LED_CONNECTION_H__
+#define __LED_CONNECTION_H__
+#include <chrono>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+#include "led_frame_pool.h"
+#include "led_message.h"
+
+#define LED_CONNECTION_SEND_LIMIT   (8 * LED_BUFFER_MAX_SIZE)                   // queued response bytes above which a session stops reading, a window of echoed frames
+
+// per-connection state used by the server event loop, kept for the whole session
+//   - receive side accumulates bytes in a frame pool buffer until a complete message is buffered,
+//     the buffer holds one maximum size message and goes back to the pool when the connection closes
+//   - frames too large for the buffer (strips above the default led count) are streamed instead, their
+//     colors are received straight into the session strip, which then becomes the delta base
+//   - send side queues responses and writes them when the socket is writable, the event loop stops reading
+//     while more than LED_CONNECTION_SEND_LIMIT bytes are queued so a client that never reads its acks cannot grow the queue
+class Led_Connection
+{
+public:
+    Led_Connection(int fd, Led_Frame_Pool &frame_pool);
+    ~Led_Connection();
+
+    Led_Connection(const Led_Connection&) = delete;
+    Led_Connection& operator=(const Led_Connection&) = delete;
+
+    int get_fd();
+
+    // read what is available without blocking until the receive buffer is full, returns false if the
+    // peer closed the connection - data left in the socket is read once buffered messages are consumed
+    bool receive_available();
+
+    // point at the next complete message inside the receive buffer without copying it, returns
+    // false if no complete message is buffered - the message stays valid until consume_message
+    bool peek_message(const uint8_t **message, size_t *message_size);
+    void consume_message(size_t message_size);
+
+    // streamed frames - peek_message starts the stream once the headers of a frame (LEDS, or LEDM + LEDS)
+    // larger than the buffer are buffered, other messages that large throw - peek_stream returns false
+    // until every color arrived, header and colors stay valid until consume_stream
+    bool peek_stream(const uint8_t **header, size_t *header_size, const Led_Strip::led_color_t **led_colors, uint32_t *led_count);
+    void consume_stream();
+
+    // queue a response and write as much of the queued data as the socket accepts
+    void queue_send(const std::vector<uint8_t> &data);
+    void queue_send(const uint8_t *data, size_t size);
+    void send_pending();
+    bool has_pending_send();
+    bool is_send_backlogged();
+
+    // completion based (io_uring) sessions - the event loop does the socket I/O
+    //   - received data is appended instead of read by receive_available, append_received returns how
+    //     much fit into the stream and the receive buffer - consume buffered messages before appending the rest
+    //   - queued responses are only buffered, start_send hands them out as one block which stays
+    //     untouched until complete_send reports how much of it was written
+    size_t append_received(const uint8_t *data, size_t size);
+    void set_deferred_send(bool deferred);
+    bool start_send(const uint8_t **data, size_t *size);
+    void complete_send(size_t bytes_sent);
+
+    // last frame applied on this session, delta frames are applied against it
+    //   - get_delta_base returns nullptr unless the base was applied with the given sequence
+    void set_delta_base(uint32_t sequence, const Led_Strip::led_color_t *led_colors, uint32_t led_count);
+    Led_Strip::led_color_t *get_delta_base(uint32_t sequence, uint32_t *led_count);
+    void clear_delta_base();
+
+    // start of the last timeline of this session on the server clock, continued timelines are played relative to it
+    void set_timeline_start(const std::chrono::steady_clock::time_point &start_time);
+    bool get_timeline_start(std::chrono::steady_clock::time_point *start_time);
+
+    // a connection is stalled if a partial message made no progress for LED_MESSAGE_TIMEOUT_MS,
+    // an idle session (nothing buffered) is closed after LED_SESSION_IDLE_TIMEOUT_MS
+    std::chrono::steady_clock::time_point get_deadline();
+    bool check_timeout(const std::chrono::steady_clock::time_point &now);
+
+private:
+    int fd;
+    Led_Frame_Pool::Buffer receive_buffer;
+    size_t receive_length;
+    size_t receive_offset;
+    std::vector<uint8_t> send_buffer;
+    size_t send_offset;
+    bool deferred_send;
+    bool send_in_flight;
+    std::vector<uint8_t> inflight_buffer;
+    size_t inflight_offset;
+    std::chrono::steady_clock::time_point last_activity;
+    std::vector<Led_Strip::led_color_t> delta_base;
+    uint32_t delta_base_sequence;
+    bool delta_base_valid;
+    std::chrono::steady_clock::time_point timeline_start;
+    bool timeline_valid;
+    uint8_t stream_header[LED_MSG_HEADER_SIZE + sizeof(Led_Strip::led_net_t)];
+    size_t stream_header_size;
+    size_t stream_size;                                                         // color bytes of the streamed frame
+    size_t stream_received;
+    bool streaming;
+
+    void compact_receive_buffer();
+    bool start_stream(size_t message_size);
+    size_t get_receive_space(uint8_t **receive_ptr);
+    void add_received(size_t size);
+};
+
+#endif // __LED_CONNECTION_H__
@@ -0,0 +1,49 @@
+#ifndef __LED_DELTA_H__
+#define __LED_DELTA_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_DELTA_BLOCK_SIZE        16                                          // bytes compared per step of the diff kernel (one SSE2 / NEON register)
+#define LED_DELTA_MERGE_GAP         (sizeof(Led_Delta::led_span_t) / sizeof(Led_Strip::led_color_t))    // unchanged leds cheaper to resend than to start a new span
+
+// delta frames - the leds changed since a base frame both ends already hold, as (start, length, colors) spans
+//   - find_difference is the diff kernel, equal blocks are skipped a vector register at a time
+//   - encode_into gives up (returns 0) once the delta would not be smaller than the full frame
+//   - apply validates every span before the base colors are changed
+class Led_Delta
+{
+public:
+    // delta payload (network order), followed by delta_span_count spans
+    typedef struct led_delta_t
+    {
+        uint32_t delta_base_sequence;                                           // sequence of the acknowledged frame the spans apply to
+        uint32_t delta_led_count;                                               // led count of base and resulting frame
+        uint32_t delta_span_count;
+        uint8_t delta_data[0];
+    } __attribute__((packed)) led_delta_t;
+
+    // one run of changed leds (network order), followed by span_length colors
+    typedef struct led_span_t
+    {
+        uint32_t span_start;
+        uint32_t span_length;
+        Led_Strip::led_color_t span_colors[0];
+    } __attribute__((packed)) led_span_t;
+
+    // index of the first byte at or after offset where the buffers differ, size if they are equal
+    static size_t find_difference(const uint8_t *base, const uint8_t *frame, size_t offset, size_t size);
+
+    // returns the delta size, or 0 if a full frame of led_count colors is not larger than the delta
+    static size_t encode_into(uint32_t base_sequence, const Led_Strip::led_color_t *base_colors, const Led_Strip::led_color_t *led_colors,
+            uint32_t led_count, uint8_t *buffer, size_t buffer_size);
+
+    // sequence the delta was encoded against, delta must hold at least a led_delta_t
+    static uint32_t get_base_sequence(const uint8_t *delta, size_t delta_size);
+
+    // update base_colors in place, throws if the led count or any span does not match
+    static void apply(const uint8_t *delta, size_t delta_size, Led_Strip::led_color_t *base_colors, uint32_t led_count);
+};
+
+#endif // __LED_DELTA_H__
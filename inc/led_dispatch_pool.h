@@ -0,0 +1,48 @@
+#ifndef __LED_DISPATCH_POOL_H__
+#define __LED_DISPATCH_POOL_H__
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// worker threads started once and reused to run the tasks of one batch in parallel
+//   - run hands task indexes out to the workers and the calling thread, and returns once every task finished
+//   - with no workers the tasks run on the calling thread, in order
+//   - run may only be called from one thread at a time
+class Led_Dispatch_Pool
+{
+public:
+    Led_Dispatch_Pool(size_t worker_count);
+    ~Led_Dispatch_Pool();
+
+    Led_Dispatch_Pool(const Led_Dispatch_Pool&) = delete;
+    Led_Dispatch_Pool& operator=(const Led_Dispatch_Pool&) = delete;
+
+    size_t get_worker_count();
+
+    // task(0) ... task(task_count - 1), the first exception thrown by a task is rethrown once all are done
+    void run(size_t task_count, const std::function<void(size_t)> &task);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex dispatch_mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    const std::function<void(size_t)> *batch_task;
+    size_t batch_task_count;
+    std::atomic<size_t> next_task;
+    size_t busy_count;                                                          // workers still in the current batch
+    uint64_t batch_generation;
+    bool stopping;
+    std::exception_ptr batch_error;
+
+    void run_worker();
+    void run_tasks();
+};
+
+#endif // __LED_DISPATCH_POOL_H__
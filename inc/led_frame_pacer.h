@@ -0,0 +1,60 @@
+#ifndef __LED_FRAME_PACER_H__
+#define __LED_FRAME_PACER_H__
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#define LED_PACER_LATENESS_BUCKETS  8                                           // tick lateness up to 50, 100, 200, 500, 1000, 2000, 5000 us, and more
+
+// fixed rate ticks from a timerfd for writing frames to the hardware
+//   - the rate is limited to what the strip takes, WS2812_LED_COUNT leds clocked out and latched per tick
+//   - the timer is armed by the first wait_tick, ticks follow on an absolute schedule so lateness does not add up
+//   - ticks that passed while the caller was busy are counted as missed, not delivered one by one
+//   - one thread waits for ticks, stop may be called from any thread
+class Led_Frame_Pacer
+{
+public:
+    typedef struct led_pacer_stats_t
+    {
+        int tick_count;                                                         // ticks delivered
+        int missed_tick_count;                                                  // ticks that expired before the previous one was handled
+        int coalesced_frame_count;                                              // frames replaced by a newer one before a tick latched them (filled by the owner)
+        uint32_t lateness_us_max;
+        int lateness_histogram[LED_PACER_LATENESS_BUCKETS];                     // delivered ticks by lateness bucket
+    } led_pacer_stats_t;
+
+    Led_Frame_Pacer(uint32_t refresh_rate);
+    ~Led_Frame_Pacer();
+
+    Led_Frame_Pacer(const Led_Frame_Pacer&) = delete;
+    Led_Frame_Pacer& operator=(const Led_Frame_Pacer&) = delete;
+
+    // highest refresh rate the strip takes, and the upper limit of a lateness bucket (UINT32_MAX for the last)
+    static uint32_t get_max_refresh_rate();
+    static uint32_t get_lateness_bucket_us(int bucket);
+
+    uint32_t get_refresh_rate();
+
+    // sleeps until the next tick, returns false once stopped
+    bool wait_tick();
+    void stop();
+
+    led_pacer_stats_t get_stats();
+
+private:
+    uint32_t refresh_rate;
+    uint64_t period_ns;
+    int timer_fd;
+    int wake_fd;
+    bool armed;
+    uint64_t expiration_count;
+    struct timespec first_tick;
+    std::atomic<bool> stopping;
+    std::mutex stats_mutex;
+    led_pacer_stats_t stats;
+
+    void arm_timer();
+    void add_tick(uint64_t expirations);
+};
+
+#endif // __LED_FRAME_PACER_H__
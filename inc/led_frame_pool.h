@@ -0,0 +1,71 @@
+#ifndef __LED_FRAME_POOL_H__
+#define __LED_FRAME_POOL_H__
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led_message.h"
+
+#define LED_FRAME_POOL_SLOT_COUNT   64                                          // buffers preallocated per pool
+#define LED_FRAME_POOL_SLOT_SIZE    LED_MSG_MAX_SIZE                            // the largest message (a full multi-strip frame)
+
+// preallocated, uninitialized frame buffers recycled between frames
+//   - acquire takes a free slot (hit), or allocates a buffer on the heap once every slot is in use (miss)
+//   - a buffer goes back to the pool when its handle is destroyed or released
+//   - acquire / release may be called from any thread
+class Led_Frame_Pool
+{
+public:
+    // move-only handle to one LED_FRAME_POOL_SLOT_SIZE buffer
+    class Buffer
+    {
+    public:
+        Buffer();
+        Buffer(Buffer &&other);
+        Buffer& operator=(Buffer &&other);
+        ~Buffer();
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        uint8_t *data();
+        size_t capacity();
+        bool is_pooled();
+
+        // return the buffer early, the handle is empty afterwards
+        void release();
+
+    private:
+        friend class Led_Frame_Pool;
+
+        Led_Frame_Pool *pool;
+        uint8_t *buffer;
+        bool pooled;
+    };
+
+    Led_Frame_Pool(size_t slot_count = LED_FRAME_POOL_SLOT_COUNT);
+    ~Led_Frame_Pool();
+
+    Led_Frame_Pool(const Led_Frame_Pool&) = delete;
+    Led_Frame_Pool& operator=(const Led_Frame_Pool&) = delete;
+
+    Buffer acquire();
+
+    int get_hit_count();
+    int get_miss_count();
+    size_t get_free_count();
+
+private:
+    std::unique_ptr<uint8_t[]> slots;
+    std::vector<uint8_t*> free_slots;
+    std::mutex free_lock;
+    std::atomic<int> hit_count;
+    std::atomic<int> miss_count;
+
+    void release(uint8_t *buffer, bool pooled);
+};
+
+#endif // __LED_FRAME_POOL_H__
@@ -0,0 +1,111 @@
+#ifndef __LED_MESSAGE_H__
+#define __LED_MESSAGE_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "led.h"
+#include "led_multi.h"
+
+// messages use the same 8 byte layout as led_net_t ("LEDS" + count) so a receiver
+// always reads LED_HEADER_SIZE bytes first and then knows the total message size:
+//   "LEDS" + led count          - legacy frame, echoed back in full
+//   "LEDM" + message length     - typed message with a sequence number
+#define LED_MSG_MAGIC               "LEDM"
+#define LED_MSG_HEADER_SIZE         (sizeof(Led_Message::led_msg_t))
+#define LED_MSG_MAX_SIZE            (LED_MSG_HEADER_SIZE + LED_MULTI_MAX_SIZE)                  // a multi-strip frame of LED_MAX_STRIPS full strips
+#define LED_MSG_ACK_SIZE            (LED_MSG_HEADER_SIZE + sizeof(Led_Message::led_ack_t))
+#define LED_MSG_CHECKSUM_SEED       2166136261u                                 // FNV-1a offset basis
+
+// message types
+#define LED_MSG_TYPE_FRAME          0x01                                        // msg_data holds a led_net_t frame
+#define LED_MSG_TYPE_ACK            0x02                                        // msg_data holds a led_ack_t for the frame with the same sequence
+#define LED_MSG_TYPE_DELTA          0x03                                        // msg_data holds a led_delta_t against the last frame applied on this connection
+#define LED_MSG_TYPE_COMPACT        0x04                                        // msg_data holds a led_compact_t (raw, run-length or palette colors)
+#define LED_MSG_TYPE_SAME           0x05                                        // msg_data holds a led_same_t - resend of the frame the server has applied
+#define LED_MSG_TYPE_PRESET         0x06                                        // msg_data holds a led_preset_msg_t - apply a preset from the server's store
+#define LED_MSG_TYPE_MULTI          0x07                                        // msg_data holds a led_multi_t - one led_net_t frame per strip
+#define LED_MSG_TYPE_TIMELINE       0x08                                        // msg_data holds a led_timeline_t - frames shown at offsets from the timeline start
+
+// message flags
+#define LED_MSG_FLAG_ECHO           0x01                                        // debug - reply to a frame with the full frame instead of an ack
+
+// ack status codes
+#define LED_ACK_STATUS_OK           0                                           // frame was applied
+#define LED_ACK_STATUS_INVALID      1                                           // frame failed validation and was not applied
+#define LED_ACK_STATUS_UNSUPPORTED  2                                           // message type is not supported by the server
+#define LED_ACK_STATUS_NO_BASE      3                                           // delta base / same frame / continued timeline is not known to the server
+#define LED_ACK_STATUS_NOT_FOUND    4                                           // preset is not in the server's store (or it has none)
+
+class Led_Message
+{
+public:
+    typedef struct led_msg_t
+    {
+        char msg_magic[LED_MAGIC_LEN];
+        uint32_t msg_length;                                                    // bytes following this field (network order)
+        uint8_t msg_type;
+        uint8_t msg_flags;
+        uint16_t msg_reserved;
+        uint32_t msg_sequence;                                                  // network order
+        uint8_t msg_data[0];
+    } __attribute__((packed)) led_msg_t;
+
+    // fixed size ack payload
+    typedef struct led_ack_t
+    {
+        uint32_t ack_status;                                                    // LED_ACK_STATUS_* (network order)
+        uint32_t ack_checksum;                                                  // checksum of the applied frame (network order)
+    } __attribute__((packed)) led_ack_t;
+
+    // hash only payload, the frame itself is not sent again
+    typedef struct led_same_t
+    {
+        uint64_t same_frame_hash;                                               // Led_Codec::get_frame_hash of the frame (network order)
+    } __attribute__((packed)) led_same_t;
+
+    // preset activation payload, acked with the preset id as checksum
+    typedef struct led_preset_msg_t
+    {
+        uint32_t preset_id;                                                     // network order
+    } __attribute__((packed)) led_preset_msg_t;
+
+    // check if a buffer starting with LED_HEADER_SIZE bytes holds a typed message
+    static bool is_message(const uint8_t *header);
+
+    // largest message accepted - a multi-strip frame, or a frame of Led_Codec::get_max_led_count leds if that is larger
+    static size_t get_max_message_size();
+
+    // size of a complete message given its first LED_HEADER_SIZE bytes
+    static size_t get_message_size(const uint8_t *header);
+
+    // build a message around payload
+    static std::vector<uint8_t> create(uint8_t type, uint8_t flags, uint32_t sequence, const uint8_t *payload, size_t payload_size);
+    static std::vector<uint8_t> create_frame(uint32_t sequence, const std::vector<uint8_t> &led_frame, uint8_t flags = 0);
+    static std::vector<uint8_t> create_ack(uint32_t sequence, uint32_t status, uint32_t checksum);
+
+    // build a message in a caller supplied buffer instead, returns the message size
+    static size_t encode_into(uint8_t type, uint8_t flags, uint32_t sequence, const uint8_t *payload, size_t payload_size,
+            uint8_t *buffer, size_t buffer_size);
+    static size_t encode_ack_into(uint32_t sequence, uint32_t status, uint32_t checksum, uint8_t *buffer, size_t buffer_size);
+
+    // write only the header of a payload_size message, for payloads sent from their own storage
+    static size_t encode_header_into(uint8_t type, uint8_t flags, uint32_t sequence, size_t payload_size,
+            uint8_t *buffer, size_t buffer_size);
+
+    // validate a complete message and return its header (points into message)
+    static const led_msg_t *parse(const std::vector<uint8_t> &message);
+    static const led_msg_t *parse(const uint8_t *message, size_t message_size);
+    static uint32_t get_sequence(const led_msg_t *header);
+    static size_t get_payload_size(const led_msg_t *header);
+    static const led_ack_t *get_ack(const led_msg_t *header);
+
+    // 32-bit FNV-1a checksum of a frame, returned in acks so the sender can verify what was applied,
+    // pass the previous result as hash to continue over a frame split into several pieces
+    static uint32_t checksum(const uint8_t *data, size_t size, uint32_t hash = LED_MSG_CHECKSUM_SEED);
+
+    // acks of same frame messages carry the frame hash folded to 32 bits instead of a checksum
+    static uint32_t fold_hash(uint64_t frame_hash);
+};
+
+#endif // __LED_MESSAGE_H__
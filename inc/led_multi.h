@@ -0,0 +1,59 @@
+#ifndef __LED_MULTI_H__
+#define __LED_MULTI_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_MAX_STRIPS              8                                           // strips a server drives (ids 0 - 7), and sub-frames per multi-strip frame
+#define LED_MULTI_STRIP_HEADER_SIZE (sizeof(Led_Multi::led_strip_frame_t) + sizeof(Led_Strip::led_net_t))
+#define LED_MULTI_MAX_SIZE          (sizeof(Led_Multi::led_multi_t) + (LED_MAX_STRIPS * (sizeof(Led_Multi::led_strip_frame_t) + LED_BUFFER_MAX_SIZE)))
+
+// multi-strip frames - one led_net_t sub-frame per strip, each tagged with its strip id, in a single message
+//   - decode validates the container and every sub-frame in one pass before anything is applied
+//   - the sub-frame headers are encoded apart from the colors so a sender can gather each strip from its storage
+class Led_Multi
+{
+public:
+    // multi-strip payload (network order), followed by multi_strip_count sub-frames
+    typedef struct led_multi_t
+    {
+        uint32_t multi_strip_count;
+        uint8_t multi_data[0];
+    } __attribute__((packed)) led_multi_t;
+
+    // one sub-frame (network order), followed by a led_net_t frame
+    typedef struct led_strip_frame_t
+    {
+        uint32_t strip_id;
+        uint8_t strip_frame[0];
+    } __attribute__((packed)) led_strip_frame_t;
+
+    // a strip to send, its colors are gathered from the strip storage
+    typedef struct led_strip_ref_t
+    {
+        uint32_t strip_id;
+        Led_Strip *leds;
+    } led_strip_ref_t;
+
+    // a validated sub-frame, led_frame points into the decoded payload
+    typedef struct led_strip_view_t
+    {
+        uint32_t strip_id;
+        const uint8_t *led_frame;
+        size_t frame_size;
+    } led_strip_view_t;
+
+    // write the container header / a sub-frame header (strip id + led_net_t header), returns the bytes written
+    static size_t encode_header_into(uint32_t strip_count, uint8_t *buffer, size_t buffer_size);
+    static size_t encode_strip_header_into(uint32_t strip_id, uint32_t led_count, uint8_t *buffer, size_t buffer_size);
+
+    // encode whole strips into one contiguous payload, returns the payload size
+    static size_t encode_into(const led_strip_ref_t *strips, uint32_t strip_count, uint8_t *buffer, size_t buffer_size);
+
+    // validate the payload and point a view at every sub-frame, returns the strip count -
+    // throws if anything is invalid, strip ids must be below LED_MAX_STRIPS and unique
+    static uint32_t decode(const uint8_t *multi, size_t multi_size, led_strip_view_t *strip_views, uint32_t max_strip_count);
+};
+
+#endif // __LED_MULTI_H__
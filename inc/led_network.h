@@ -4,14 +4,46 @@
 #include <chrono>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
-#define LED_MESSAGE_POLL_TIME_MS    100                                         // wait 100 milliseconds between each failed poll for received messages
+#include "led_frame_pool.h"
+
+#define LED_MESSAGE_POLL_TIME_MS    100                                         // upper bound for short internal waits (e.g. reacting to stop requests)
 #define LED_MESSAGE_TIMEOUT_MS      3000                                        // wait 3 seconds to receive messages before giving up / triggering receive failure
+#define LED_SESSION_IDLE_TIMEOUT_MS 30000                                       // close streaming sessions after 30 seconds without a message
+#define LED_KEEPALIVE_IDLE_SEC      5                                           // start TCP keepalive probes after 5 idle seconds
+#define LED_KEEPALIVE_INTERVAL_SEC  1                                           // 1 second between keepalive probes
+#define LED_KEEPALIVE_PROBE_COUNT   3                                           // drop peer after 3 unanswered probes
+#define LED_UDP_BATCH_COUNT         16                                          // datagrams moved per recvmmsg / sendmmsg call
+#define LED_UDP_MAX_SENDERS         256                                         // datagram senders tracked for stale sequence detection, silent ones are forgotten first
+#define LED_UDP_SENDER_TIMEOUT_MS   1000                                        // a sender silent this long is forgotten, its next sequence is accepted
+#define LED_UDP_SEQUENCE_WINDOW     1024                                        // frames a datagram may lag behind before it counts as a sender restart
+#define LED_EVENT_MAX_COUNT         64                                          // maximum number of ready descriptors handled per event loop wakeup
+
+typedef enum
+{
+    LED_TRANSPORT_TCP,                                                          // reliable stream, every frame applied in order
+    LED_TRANSPORT_UDP,                                                          // datagrams, stale frames dropped and newest frame wins
+    LED_TRANSPORT_UNIX,                                                         // same host stream over an AF_UNIX socket path
+    LED_TRANSPORT_COUNT
+} led_transport_t;
+
+typedef enum
+{
+    LED_IO_BACKEND_EPOLL,                                                       // readiness events, one syscall per accept / recv / send
+    LED_IO_BACKEND_URING,                                                       // io_uring, operations submitted and completed in batches
+    LED_IO_BACKEND_COUNT
+} led_io_backend_t;
+
+class Led_Uring;
 
 class Led_Network
 {
 public:
-    Led_Network();
+    Led_Network(led_transport_t transport = LED_TRANSPORT_TCP);
     virtual ~Led_Network();
 
     int get_send_message_count();
@@ -20,6 +52,20 @@ public:
     void inc_receive_message_count();
     void start_network();
     void stop_network();
+    led_transport_t get_transport();
+
+    // select the event loop backend before initialize, io_uring falls back to epoll if the
+    // kernel does not support it - get_io_backend reports the backend actually in use
+    void set_io_backend(led_io_backend_t io_backend);
+    led_io_backend_t get_io_backend();
+
+    // frame buffers taken from the preallocated pool vs. allocated because every slot was in use,
+    // a steady state session only ever adds hits
+    int get_frame_pool_hit_count();
+    int get_frame_pool_miss_count();
+
+    // validate a received LED_HEADER_SIZE header and return the size of the complete message
+    static size_t get_message_size(const uint8_t *header);
 
 protected:
     int socket_fd;
@@ -27,14 +73,51 @@ protected:
     std::atomic<int> send_message_count;
     std::atomic<int> receive_message_count;
     std::atomic<bool> stop_requested;
+    int epoll_fd;
+    int wake_fd;
+    led_transport_t transport;
+    led_io_backend_t io_backend;
+    std::unique_ptr<Led_Uring> uring;
+    Led_Frame_Pool frame_pool;
 
     void create_socket();
     void close_socket();
     void make_socket_nonblocking(int config_socket);
-    bool check_tcp_timeout(const std::chrono::time_point<std::chrono::high_resolution_clock>& start);
+    void enable_keepalive(int config_socket);
+
+    // send_all / receive_all give up once a single deadline for the whole message passes,
+    // wait_socket blocks until the socket is ready, the deadline passes or stop_network is called
+    std::chrono::steady_clock::time_point get_message_deadline();
+    bool check_tcp_timeout(const std::chrono::steady_clock::time_point &deadline);
+    void wait_socket(int config_socket, short events, const std::chrono::steady_clock::time_point &deadline);
     void send_all(int dst_socket, const std::vector<uint8_t> &led_frame);
+    void send_all(int dst_socket, const uint8_t *message, size_t message_size);
+
+    // gather send of one message split over iov_count pieces, iov is advanced while sending -
+    // returns how many sendmsg calls moved data with MSG_ZEROCOPY in send_flags (one completion each)
+    int send_all(int dst_socket, struct iovec *iov, int iov_count, int send_flags = 0);
     std::vector<uint8_t> receive_all(int src_socket);
 
+    // receive one complete message into buffer without allocating, returns the message size
+    size_t receive_into(int src_socket, uint8_t *buffer, size_t buffer_size);
+
+    // batched datagram transfer - send to the connected peer, receive up to buffers.size() datagrams
+    // and return how many were read (0 if none were waiting)
+    void send_datagrams(int dst_socket, const std::vector<std::vector<uint8_t>> &messages);
+    int receive_datagrams(int src_socket, std::vector<std::vector<uint8_t>> &buffers, std::vector<size_t> &sizes,
+            std::vector<struct sockaddr_storage> &src_addrs);
+
+    // epoll event loop shared by listening / client sockets, wake_fd interrupts wait_events
+    // (also creates the io_uring when that backend is selected)
+    void create_event_loop();
+    void close_event_loop();
+    void add_event_fd(int fd, uint32_t events);
+    void modify_event_fd(int fd, uint32_t events);
+    void remove_event_fd(int fd);
+    int wait_events(struct epoll_event *events, int max_events, int timeout_ms);
+    void wake_event_loop();
+    void clear_wake_event();
+
 };
 
 #endif // __LED_NETWORK_H__
@@ -0,0 +1,57 @@
+#ifndef __LED_PLAYOUT_QUEUE_H__
+#define __LED_PLAYOUT_QUEUE_H__
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_PLAYOUT_QUEUE_SIZE      128                                         // frames queued for playout (two seconds at 60 frames per second)
+#define LED_PLAYOUT_LATE_US         2000                                        // a frame shown later than this after its time counts as late
+
+// bounded queue of frames waiting for the time they are shown
+//   - frames are decoded into strips preallocated per slot when queued, the storage is reused
+//   - push never blocks, a full queue or a frame before the last queued one is refused
+//   - wait_frame sleeps until the oldest frame is due, if later frames are due as well only the
+//     newest is returned and the ones it overtook are reported as skipped
+//   - one thread pushes and clears, one thread waits for frames
+class Led_Playout_Queue
+{
+public:
+    Led_Playout_Queue(size_t capacity);
+
+    Led_Playout_Queue(const Led_Playout_Queue&) = delete;
+    Led_Playout_Queue& operator=(const Led_Playout_Queue&) = delete;
+
+    size_t get_capacity();
+    size_t get_size();
+
+    // throws if the frame is invalid, returns false if it was not queued
+    bool push(const std::chrono::steady_clock::time_point &play_time, const uint8_t *led_frame, size_t frame_size);
+
+    // drop every queued frame, returns how many were dropped
+    size_t clear();
+
+    // copy the next due frame into leds (reusing its storage), returns false once stopped
+    bool wait_frame(Led_Strip &leds, std::chrono::steady_clock::time_point *play_time, size_t *skipped_count);
+    void stop();
+
+private:
+    typedef struct led_playout_slot_t
+    {
+        std::chrono::steady_clock::time_point play_time;
+        Led_Strip leds;
+    } led_playout_slot_t;
+
+    std::vector<led_playout_slot_t> slots;
+    size_t head;
+    size_t count;
+    bool stopping;
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+};
+
+#endif // __LED_PLAYOUT_QUEUE_H__
@@ -0,0 +1,72 @@
+#ifndef __LED_PRESET_STORE_H__
+#define __LED_PRESET_STORE_H__
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_PRESET_MAGIC            "LEDP"
+#define LED_PRESET_VERSION          1
+#define LED_PRESET_NAME_LEN         32                                          // bytes of a preset name, zero padded
+
+// library of saved scenes in one read only memory mapped file, keyed by id and name
+//   - header, index sorted by id, then each preset as a led_net_t ("LEDS") frame
+//   - opening maps the file and checks the header only, presets are found and validated when used
+//   - frames are applied straight from the mapping, nothing is copied or parsed up front
+class Led_Preset_Store
+{
+public:
+    // file layout (network order)
+    typedef struct led_preset_header_t
+    {
+        char preset_magic[LED_MAGIC_LEN];
+        uint32_t preset_version;
+        uint32_t preset_count;
+        uint32_t preset_reserved;
+    } __attribute__((packed)) led_preset_header_t;
+
+    typedef struct led_preset_entry_t
+    {
+        uint32_t entry_id;
+        uint32_t entry_offset;                                                  // frame position from the start of the file
+        uint32_t entry_size;
+        char entry_name[LED_PRESET_NAME_LEN];
+    } __attribute__((packed)) led_preset_entry_t;
+
+    // a scene saved with Led_Strip::save_all_leds, added to a new store by create
+    typedef struct led_preset_source_t
+    {
+        uint32_t preset_id;
+        std::string preset_name;
+        std::string file_path;
+    } led_preset_source_t;
+
+    // map an existing store, throws if it can not be opened or the header is invalid
+    Led_Preset_Store(std::string file_path);
+    ~Led_Preset_Store();
+
+    Led_Preset_Store(const Led_Preset_Store&) = delete;
+    Led_Preset_Store& operator=(const Led_Preset_Store&) = delete;
+
+    // write a store from saved scene files, ids must be unique
+    static void create(const std::string &file_path, const std::vector<led_preset_source_t> &presets);
+
+    uint32_t get_preset_count();
+
+    // frame of a preset (points into the mapping), false if there is no such preset -
+    // throws if the entry or its frame is invalid
+    bool find_preset(uint32_t preset_id, const uint8_t **frame, size_t *frame_size);
+    bool find_preset(const std::string &preset_name, uint32_t *preset_id);
+
+private:
+    std::string store_path;
+    const uint8_t *store_map;
+    size_t store_size;
+    uint32_t preset_count;
+
+    const led_preset_entry_t *get_entries();
+};
+
+#endif // __LED_PRESET_STORE_H__
@@ -0,0 +1,76 @@
+#ifndef __LED_PRU_SIM_H__
+#define __LED_PRU_SIM_H__
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "led.h"
+#include "share.h"
+
+#if DEBUG_NO_SHMEM
+// PRU side of the shared memory handshake (see share.h) on the SHARED_MEM_MAP_FILE mapping, emulates
+// the hardware where there is none
+//   - a thread polls the start word, marks the frame busy, copies its buffer out and marks it done
+//   - a frame keeps its buffer busy as long as the WS2812 strip takes to clock it out and latch it,
+//     led count * WS2812_LED_BIT_COUNT bits of bit_ns each, then reset_us
+//   - frames flipped to are timestamped when first seen, also while another frame is clocked out
+//   - map after the PruMem writing to it, PruMem truncates the file when it is created
+class Led_Pru_Sim
+{
+public:
+    typedef struct led_pru_sim_stats_t
+    {
+        int frame_count;                                                        // frames clocked out and latched
+        int dropped_count;                                                      // frames replaced by a newer flip before they were taken (counted from sequence 1)
+        uint32_t frame_us;                                                      // clock out and latch time of the last frame
+        double refresh_rate;                                                    // frames per second the strip takes at that frame time
+        double queued_us_avg;                                                   // flip to start of clock out
+        uint32_t queued_us_max;
+        double latency_us_avg;                                                  // flip to latch
+        uint32_t latency_us_max;
+    } led_pru_sim_stats_t;
+
+    Led_Pru_Sim(uint32_t bit_ns = WS2812_BIT_NS, uint32_t reset_us = WS2812_RESET_US);
+    ~Led_Pru_Sim();
+
+    Led_Pru_Sim(const Led_Pru_Sim&) = delete;
+    Led_Pru_Sim& operator=(const Led_Pru_Sim&) = delete;
+
+    // frames taken from a buffer, and frames finished
+    int get_start_count();
+    int get_frame_count();
+
+    // colors of the last frame finished
+    std::vector<Led_Strip::led_color_t> get_shown_leds();
+
+    led_pru_sim_stats_t get_stats();
+
+private:
+    uint32_t bit_ns;
+    uint32_t reset_us;
+    int shared_mem_fd;
+    volatile uint32_t *shared_mem_map;
+    std::atomic<bool> running;
+    std::atomic<int> start_count;
+    std::atomic<int> frame_count;
+    std::mutex shown_mutex;
+    std::vector<Led_Strip::led_color_t> shown_leds;
+    led_pru_sim_stats_t stats;
+    uint64_t queued_us_total;
+    uint64_t latency_us_total;
+    uint32_t last_sequence;
+    uint32_t seen_word;
+    std::chrono::steady_clock::time_point seen_time;
+    std::thread pru_thread;
+
+    void run_pru();
+    void watch_start_word();
+    void add_frame_stats(uint32_t start_word, const std::chrono::steady_clock::time_point &flip_time,
+            const std::chrono::steady_clock::time_point &start_time, uint32_t frame_us);
+};
+#endif
+
+#endif // __LED_PRU_SIM_H__
@@ -1,48 +1,227 @@
 #ifndef __LED_SERVER_H__
 #define __LED_SERVER_H__
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <stdlib.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <future>
+#include <thread>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
 
 #include "led.h"
 #include "led_network.h"
+#include "led_codec.h"
+#include "led_connection.h"
+#include "led_shm_ring.h"
+#include "led_uring.h"
+#include "led_preset_store.h"
+#include "led_multi.h"
+#include "led_dispatch_pool.h"
+#include "led_timeline.h"
+#include "led_playout_queue.h"
+#include "led_triple_buffer.h"
+#include "led_frame_pacer.h"
+#include "pru_mem.h"
+
+#define LED_DISPATCH_MIN_STRIPS     4                                           // strips in a multi-strip frame before they are applied in parallel
+#define LED_ACCEPT_BACKOFF_MS       100                                         // pause before accepting again after accept failed (out of descriptors / memory)
 
 class Led_Server : public Led_Network
 {
 public:
-    Led_Server(int port);
+    Led_Server(int port, led_transport_t transport = LED_TRANSPORT_TCP);
+
+    // listen on an AF_UNIX socket path for same host producers
+    Led_Server(std::string socket_path);
     ~Led_Server() override;
 
+    // also consume frames written by local producers to the named shared memory ring
+    // (call before initialize, the server creates and removes the segment)
+    void set_shm_ring(std::string ring_name);
+
+    // serve presets from a store written by Led_Preset_Store::create (call before initialize,
+    // initialize maps the file)
+    void set_preset_store(std::string file_path);
+
+    // threads that apply the strips of a multi-strip frame along with the event loop (call before initialize),
+    // 0 applies them one after another - defaults to one less than the cores, up to LED_MAX_STRIPS - 1
+    void set_dispatch_thread_count(int thread_count);
+    int get_dispatch_thread_count();
+
+    // write the newest frame of strip 0 to the PRU shared memory from an output thread (call before initialize,
+    // initialize maps the memory) - frames published while the output is busy collapse to the latest one
+    void set_pru_output(bool enable);
+
+    // write the PRU output on a fixed schedule of refresh_rate ticks per second instead of as frames arrive
+    // (call before initialize, 0 turns pacing off) - each tick latches the newest frame, the rest are coalesced
+    void set_output_rate(uint32_t refresh_rate);
+
     void initialize();
 
     void start_server();
     void stop_server();
     bool get_server_is_running();
 
+    // connections accepted since the server was created, closed ones included
+    int get_accepted_count();
+    int get_dropped_count();
+
+    // frames equal to the one already applied (by content hash) - not decoded / written again
+    int get_duplicate_frame_count();
+
+    // frames written to one strip output, duplicates not included
+    int get_strip_frame_count(uint32_t strip_id);
+
+    // timeline frames shown more than LED_PLAYOUT_LATE_US after their time, and frames never shown
+    // (queue full, overtaken by a later due frame, or replaced by a new timeline)
+    int get_playout_late_count();
+    int get_playout_dropped_count();
+
+    // frames written to the PRU shared memory, and frames replaced by a newer one before they were written
+    int get_output_frame_count();
+    int get_output_overwritten_count();
+
+    // frames cut to WS2812_LED_COUNT leds before the PRU write, the strip is longer than the PRU drives
+    int get_output_truncated_count();
+
+    // tick lateness, missed ticks and coalesced frames of a paced output (all 0 without pacing)
+    Led_Frame_Pacer::led_pacer_stats_t get_output_pacer_stats();
+
 private:
+    // applied state of one strip output - strips are applied from the event loop, the shm consumer and dispatch threads
+    typedef struct led_strip_output_t
+    {
+        std::mutex applied_mutex;
+        uint64_t applied_hash = 0;
+        bool applied_valid = false;
+        std::atomic<int> frame_count{0};
+    } led_strip_output_t;
+
+    // newest sequence of one datagram sender (address and port)
+    typedef struct led_datagram_sender_t
+    {
+        uint32_t sequence;
+        std::chrono::steady_clock::time_point last_seen;
+    } led_datagram_sender_t;
+
     struct sockaddr_in server_addr;
     int server_port;
+    std::string server_path;
     std::atomic<bool> server_is_running;
+    std::map<int, std::unique_ptr<Led_Connection>> client_connections;
+    std::atomic<int> accepted_count;
+    std::atomic<int> dropped_count;
+    std::atomic<int> duplicate_frame_count;
+    led_strip_output_t strip_outputs[LED_MAX_STRIPS];                            // single strip frames go to strip 0
+    int dispatch_thread_count;
+    std::unique_ptr<Led_Dispatch_Pool> dispatch_pool;
+    std::vector<std::vector<uint8_t>> datagram_buffers;
+    std::map<uint64_t, led_datagram_sender_t> datagram_senders;
+    std::string shm_ring_name;
+    std::unique_ptr<Led_Shm_Ring> shm_ring;
+    std::thread shm_thread;
+    std::string preset_store_path;
+    std::unique_ptr<Led_Preset_Store> preset_store;
+    std::unique_ptr<Led_Playout_Queue> playout_queue;
+    std::thread playout_thread;
+    std::atomic<int> playout_late_count;
+    std::atomic<int> playout_dropped_count;
+    bool pru_output_enabled;
+    std::unique_ptr<PruMem> pru_mem;
+    std::unique_ptr<Led_Triple_Buffer> output_frames;
+    uint32_t output_rate;
+    std::unique_ptr<Led_Frame_Pacer> output_pacer;
+    std::thread output_thread;
+    std::atomic<int> output_frame_count;
+    std::atomic<int> output_truncated_count;
+    std::map<int, int> uring_operations;
+    std::set<int> uring_closing_fds;                                            // shut down, closed by their last completion
+    std::set<int> uring_paused_fds;                                             // send backlogged, no receive armed
+    bool accept_paused;                                                         // resumed when a client closes or the backoff passed
+    std::chrono::steady_clock::time_point accept_resume_time;
+    bool uring_accept_armed;
+    bool uring_wake_armed;
 
     void bind_socket();
+    void run_epoll_loop();
+    void run_uring_loop();
+    void accept_clients();
+    void pause_accept();
+    void resume_accept();
+    void receive_frame_datagrams();
+    void forget_datagram_senders(const std::chrono::steady_clock::time_point &now);
+    void consume_shm_ring();
+    void stop_shm_consumer();
+    void run_playout();
+    void stop_playout();
+    void run_output();
+    void run_paced_output();
+    void write_output(const Led_Codec::led_frame_view_t &view);
+    void stop_output();
+    void handle_client(int client_fd, uint32_t events);
+    void handle_received(Led_Connection &connection);
+    void handle_message(Led_Connection &connection, const uint8_t *message, size_t message_size);
+    void handle_stream(Led_Connection &connection, const uint8_t *header, size_t header_size,
+            const Led_Strip::led_color_t *led_colors, uint32_t led_count);
+    Led_Codec::led_frame_view_t apply_frame(const uint8_t *led_frame, size_t frame_size, uint32_t strip_id = 0);
+    void apply_view(const Led_Codec::led_frame_view_t &view, uint32_t strip_id = 0);
+    void apply_strips(const Led_Multi::led_strip_view_t *strip_views, uint32_t strip_count);
+    bool is_applied_frame(uint64_t frame_hash);
+    void update_client_events(Led_Connection &connection);
+    int get_next_timeout_ms();
+    void close_stalled_clients();
+    void close_client(int client_fd);
+    void close_all_clients();
+
+    // io_uring backend - completions replace readiness events, the connection does no socket I/O
+    void handle_uring_completion(const struct io_uring_cqe &cqe);
+    void add_uring_client(int client_fd);
+    void handle_uring_receive(int client_fd, const struct io_uring_cqe &cqe);
+    void handle_uring_send(int client_fd, const struct io_uring_cqe &cqe);
+    void start_uring_receive(int client_fd);
+    void start_uring_send(Led_Connection &connection);
+    void finish_uring_operations();
 };
 
 class Led_Server_Nonblocking
 {
 public:
-    Led_Server_Nonblocking(int port);
+    Led_Server_Nonblocking(int port, led_transport_t transport = LED_TRANSPORT_TCP);
+    Led_Server_Nonblocking(std::string socket_path);
     ~Led_Server_Nonblocking();
 
+    void set_shm_ring(std::string ring_name);
+    void set_preset_store(std::string file_path);
+    void set_dispatch_thread_count(int thread_count);
+    void set_pru_output(bool enable);
+    void set_output_rate(uint32_t refresh_rate);
+    void set_io_backend(led_io_backend_t io_backend);
+    led_io_backend_t get_io_backend();
     void initialize();
     void start_server();
     void stop_server();
 
     bool get_server_is_running();
+    int get_accepted_count();
+    int get_dropped_count();
+    int get_duplicate_frame_count();
+    int get_strip_frame_count(uint32_t strip_id);
+    int get_playout_late_count();
+    int get_playout_dropped_count();
+    int get_output_frame_count();
+    int get_output_overwritten_count();
+    int get_output_truncated_count();
+    Led_Frame_Pacer::led_pacer_stats_t get_output_pacer_stats();
     int get_send_message_count();
     int get_receive_message_count();
+    int get_frame_pool_hit_count();
+    int get_frame_pool_miss_count();
 
 private:
     Led_Server server;
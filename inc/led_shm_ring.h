@@ -0,0 +1,68 @@
+#ifndef __LED_SHM_RING_H__
+#define __LED_SHM_RING_H__
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_SHM_RING_MAGIC          0x5244454c                                  // "LEDR"
+#define LED_SHM_RING_SLOT_COUNT     16                                          // frames buffered between producer and consumer (power of 2)
+#define LED_SHM_RING_SLOT_SIZE      LED_BUFFER_MAX_SIZE                         // each slot holds one led_net_t frame
+#define LED_SHM_CACHE_LINE_SIZE     64
+
+// lock-free single producer / single consumer ring of LED frames in a named /dev/shm segment
+//   - the producer only writes write_index, the consumer only writes read_index
+//   - the consumer sleeps on a futex (wake_sequence) only when the ring is empty
+class Led_Shm_Ring
+{
+public:
+    typedef struct led_shm_slot_t
+    {
+        uint32_t frame_size;
+        uint8_t frame[LED_SHM_RING_SLOT_SIZE];
+    } led_shm_slot_t;
+
+    typedef struct led_shm_ring_t
+    {
+        uint32_t ring_magic;
+        uint32_t slot_count;
+        uint32_t slot_size;
+        alignas(LED_SHM_CACHE_LINE_SIZE) std::atomic<uint32_t> write_index;
+        alignas(LED_SHM_CACHE_LINE_SIZE) std::atomic<uint32_t> read_index;
+        alignas(LED_SHM_CACHE_LINE_SIZE) std::atomic<uint32_t> consumer_waiting;
+        std::atomic<uint32_t> wake_sequence;
+        alignas(LED_SHM_CACHE_LINE_SIZE) led_shm_slot_t slots[LED_SHM_RING_SLOT_COUNT];
+    } led_shm_ring_t;
+
+    // the consumer creates (and later removes) the segment, the producer attaches to it
+    Led_Shm_Ring(std::string name, bool create);
+    ~Led_Shm_Ring();
+
+    Led_Shm_Ring(const Led_Shm_Ring&) = delete;
+    Led_Shm_Ring& operator=(const Led_Shm_Ring&) = delete;
+
+    // producer - returns false without blocking if every slot is full
+    bool write_frame(const uint8_t *frame, size_t frame_size);
+
+    // consumer - returns false if the ring is empty
+    bool read_frame(std::vector<uint8_t> &frame);
+
+    // consumer - read get_wake_sequence() before checking for frames / stop conditions, then
+    // wait_frame sleeps until a frame is written, wake() is called or timeout_ms passes (-1 waits forever)
+    uint32_t get_wake_sequence();
+    void wait_frame(uint32_t wake_sequence, int timeout_ms);
+    void wake();
+
+    bool is_empty();
+
+private:
+    std::string ring_name;
+    bool ring_owner;
+    int ring_fd;
+    led_shm_ring_t *ring;
+};
+
+#endif // __LED_SHM_RING_H__
@@ -0,0 +1,61 @@
+#ifndef __LED_TIMELINE_H__
+#define __LED_TIMELINE_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led.h"
+
+#define LED_TIMELINE_MAX_FRAMES     64                                          // frames per timeline message
+#define LED_TIMELINE_FRAME_HEADER_SIZE (sizeof(Led_Timeline::led_timeline_frame_t) + sizeof(Led_Strip::led_net_t))
+
+#define LED_TIMELINE_FLAG_CONTINUE  0x01                                        // offsets continue the previous timeline of the session instead of starting a new one
+
+// timeline frames - led_net_t frames tagged with the time they are shown, sent ahead in one message
+//   - offsets are microseconds from the start of the timeline, the receiver starts it on its own clock when
+//     the first message arrives, so network jitter does not reach the strip
+//   - longer animations are sent as several messages, the following ones continue the first
+//   - decode validates every frame in one pass before anything is queued, offsets may not go backwards
+class Led_Timeline
+{
+public:
+    // timeline payload (network order), followed by timeline_frame_count frames
+    typedef struct led_timeline_t
+    {
+        uint32_t timeline_frame_count;
+        uint32_t timeline_flags;                                                // LED_TIMELINE_FLAG_*
+        uint8_t timeline_data[0];
+    } __attribute__((packed)) led_timeline_t;
+
+    // one frame (network order), followed by a led_net_t frame
+    typedef struct led_timeline_frame_t
+    {
+        uint32_t frame_offset_us;
+        uint8_t frame_data[0];
+    } __attribute__((packed)) led_timeline_frame_t;
+
+    // a frame to send, encoded from the strip storage
+    typedef struct led_timeline_ref_t
+    {
+        uint32_t offset_us;
+        Led_Strip *leds;
+    } led_timeline_ref_t;
+
+    // a validated frame, led_frame points into the decoded payload
+    typedef struct led_timeline_view_t
+    {
+        uint32_t offset_us;
+        const uint8_t *led_frame;
+        size_t frame_size;
+    } led_timeline_view_t;
+
+    // bytes a frame of led_count leds takes in a timeline
+    static size_t get_frame_size(uint32_t led_count);
+
+    // encode frames into one contiguous payload, returns the payload size - throws if they do not fit
+    static size_t encode_into(const led_timeline_ref_t *frames, uint32_t frame_count, uint32_t flags, uint8_t *buffer, size_t buffer_size);
+
+    // validate the payload and point a view at every frame, returns the frame count - throws if anything is invalid
+    static uint32_t decode(const uint8_t *timeline, size_t timeline_size, uint32_t *flags, led_timeline_view_t *frame_views, uint32_t max_frame_count);
+};
+
+#endif // __LED_TIMELINE_H__
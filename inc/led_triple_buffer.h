@@ -0,0 +1,53 @@
+#ifndef __LED_TRIPLE_BUFFER_H__
+#define __LED_TRIPLE_BUFFER_H__
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+#include "led.h"
+#include "led_codec.h"
+
+#define LED_TRIPLE_BUFFER_NEW       0x4                                         // set in the ready index while its frame was not taken yet
+
+// newest frame handed from the network side to one output thread without locks
+//   - publish copies a frame into the back buffer and swaps it with the ready buffer in one atomic exchange
+//   - take swaps the ready buffer with the front buffer if a newer frame was published, frames
+//     published meanwhile are overwritten instead of queued - a burst collapses to the latest one
+//   - the consumer sleeps on a futex (wake_sequence) only when nothing new is ready
+//   - publish may only be called by one thread at a time, take / wait_frame by one other thread
+class Led_Triple_Buffer
+{
+public:
+    Led_Triple_Buffer();
+
+    Led_Triple_Buffer(const Led_Triple_Buffer&) = delete;
+    Led_Triple_Buffer& operator=(const Led_Triple_Buffer&) = delete;
+
+    // producer - never blocks, the buffer storage is reused once it is large enough
+    void publish(const Led_Codec::led_frame_view_t &view);
+
+    // consumer - returns false if no frame was published since the last take, the view stays valid until the next take
+    bool take(Led_Codec::led_frame_view_t *view);
+
+    // consumer - read get_wake_sequence() before checking for frames / stop conditions, then
+    // wait_frame sleeps until a frame is published, wake() is called or timeout_ms passes (-1 waits forever)
+    uint32_t get_wake_sequence();
+    void wait_frame(uint32_t wake_sequence, int timeout_ms);
+    void wake();
+
+    // frames published and frames overwritten before the consumer took them
+    int get_publish_count();
+    int get_overwritten_count();
+
+private:
+    std::vector<Led_Strip::led_color_t> buffers[3];
+    uint32_t back_index;                                                        // owned by the producer
+    uint32_t front_index;                                                       // owned by the consumer
+    std::atomic<uint32_t> ready_index;
+    std::atomic<uint32_t> wake_sequence;
+    std::atomic<uint32_t> consumer_waiting;
+    std::atomic<int> publish_count;
+    std::atomic<int> overwritten_count;
+};
+
+#endif // __LED_TRIPLE_BUFFER_H__
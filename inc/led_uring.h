@@ -0,0 +1,76 @@
+#ifndef __LED_URING_H__
+#define __LED_URING_H__
+#include <deque>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+#include "led_message.h"
+
+#define LED_URING_QUEUE_DEPTH       256                                         // submission queue entries, completion queue is twice this size
+#define LED_URING_BUFFER_COUNT      64                                          // receive buffers handed to the kernel
+#define LED_URING_BUFFER_SIZE       LED_MSG_MAX_SIZE                            // one complete typed frame message per receive buffer
+#define LED_URING_BUFFER_GROUP      0                                           // buffer group id selected by receive operations
+#define LED_URING_USER_DATA_NONE    0                                           // user data of internal operations, callers should not use it
+
+// minimal io_uring wrapper on the raw syscalls (liburing is not required)
+//   - operations are queued in the mapped submission ring and submitted together by submit_and_wait
+//   - completions are read from the mapped completion ring without a syscall, completions moved aside to
+//     make room for submissions (completion ring overflowed) are returned first
+//   - receives select their buffer from a frame pool provided to the kernel once, a buffer is
+//     returned to the pool with release_buffer after its data was consumed
+class Led_Uring
+{
+public:
+    // throws if the kernel does not support io_uring or a required feature
+    Led_Uring(unsigned queue_depth = LED_URING_QUEUE_DEPTH);
+    ~Led_Uring();
+
+    Led_Uring(const Led_Uring&) = delete;
+    Led_Uring& operator=(const Led_Uring&) = delete;
+
+    void prep_accept(int fd, uint64_t user_data);
+    void prep_recv(int fd, uint64_t user_data);
+    void prep_send(int fd, const void *data, size_t size, uint64_t user_data);
+    void prep_poll(int fd, uint32_t poll_events, uint64_t user_data);
+    void prep_cancel(uint64_t target_user_data, uint64_t user_data);
+
+    // submit every queued operation and wait up to timeout_ms (-1 forever) for wait_count completions
+    // with a single syscall, returns the number of operations submitted
+    int submit_and_wait(unsigned wait_count, int timeout_ms);
+
+    // copy the next completion, returns false if none is waiting
+    bool get_completion(struct io_uring_cqe &cqe);
+
+    // frame pool - data received into a selected buffer, and returning it to the kernel
+    const uint8_t *get_buffer(const struct io_uring_cqe &cqe);
+    void release_buffer(const struct io_uring_cqe &cqe);
+
+private:
+    int ring_fd;
+    void *ring_ptr;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned sqe_tail;
+    std::deque<struct io_uring_cqe> reaped_completions;
+    std::vector<uint8_t> buffer_pool;
+
+    struct io_uring_sqe *get_sqe();
+    bool is_submission_full();
+    void reap_completions();
+    void prep_provide_buffers(uint8_t *buffers, unsigned count, unsigned first_id, uint8_t sqe_flags);
+    void close_ring();
+};
+
+#endif // __LED_URING_H__
@@ -10,18 +10,30 @@ public:
     PruMem(const void *addr);
     ~PruMem();
 
-    void write_mem_led_colors(uint32_t size, const char *buff);
-    void write_mem_led_count(uint8_t led_count);
+    // count and colors go to the buffer the PRU is not clocking out - waits only while the PRU still clocks
+    // out that buffer (both buffers busy), throws if it does not finish within SHARED_MEM_WAIT_TIMEOUT_US
+    // one aligned 32-bit store per led (see SHARED_MEM_LED_WORD), up to WS2812_LED_COUNT leds
+    void write_mem_led_colors(const Led_Strip::led_color_t *led_colors, uint32_t led_count);
+    void write_mem_led_count(uint32_t led_count);
+
+    // flip the PRU to the written buffer with one store, the count and colors are visible to the PRU first
     void write_mem_led_start();
     void write_mem_led_stop();
 
+    // frames that had to wait for the PRU to finish a buffer
+    int get_wait_count();
+
 private:
     const void *physical_addr;
     int shared_mem_fd;
     volatile uint32_t* shared_mem_map;
+    uint32_t frame_sequence;
+    int write_buffer;                                                           // buffer of the frame being written, -1 before the first write
+    int wait_count;
 
     void allocate_mem(const void *physical_addr);
     void deallocate_mem();
+    volatile uint32_t *get_write_buffer();
 };
 
 #endif
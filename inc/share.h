@@ -11,12 +11,34 @@
 #define SHARED_MEM_START_ADDR 0x4a310000
 #endif
 
-#define SHARED_MEM_LED_BEGIN_WRITE_OFFSET 0x0
-#define SHARED_MEM_LED_COUNT_OFFSET       0x1
-#define SHARED_MEM_LED_START_OFFSET       0x2
+// offsets in 32-bit words - handshake words, then two frame buffers the host and the PRU take turns on
+//   - the host writes a frame into the buffer the PRU is not clocking out, then flips to it with a single
+//     store of ((sequence << 1) | buffer) to the start word, sequence counts from 1 so 0 means no frame
+//   - the PRU copies a new start word to the busy word, reads the start word again (a newer frame replaces
+//     it) and clocks that buffer out, then copies it to the done word once the reset latch passed
+//   - the host only waits while the PRU clocks out the one buffer not holding the frame flipped to last
+#define SHARED_MEM_LED_BEGIN_WRITE_OFFSET 0x0 // start word, written by the host
+#define SHARED_MEM_LED_BUSY_OFFSET        0x1 // start word of the frame being clocked out, written by the PRU
+#define SHARED_MEM_LED_DONE_OFFSET        0x2 // start word of the last frame clocked out, written by the PRU
+#define SHARED_MEM_LED_BUFFER_OFFSET      0x4 // first frame buffer
 #define WS2812_LED_COUNT                  150 // 150 leds
 #define WS2812_LED_BIT_COUNT              24  // 24 bits per led - 8 bits each red/green/blue
+#define WS2812_BIT_NS                     1250 // 1.25 us per bit
+#define WS2812_RESET_US                   50  // line held low after the last bit to latch the frame
+#define WS2812_FRAME_US                   (WS2812_LED_COUNT * WS2812_LED_BIT_COUNT * WS2812_BIT_NS / 1000 + WS2812_RESET_US) // clock out and latch all leds
 
-#define SHARED_MEM_SIZE       ((WS2812_LED_COUNT + SHARED_MEM_LED_START_OFFSET) * sizeof(uint32_t))
+// offsets in a frame buffer - led count, then one word per led
+#define SHARED_MEM_LED_COUNT_OFFSET       0x0
+#define SHARED_MEM_LED_START_OFFSET       0x1
+#define SHARED_MEM_LED_BUFFER_SIZE        (SHARED_MEM_LED_START_OFFSET + WS2812_LED_COUNT)
+#define SHARED_MEM_LED_BUFFER_COUNT       2
+
+#define SHARED_MEM_POLL_US                20     // host / simulated PRU poll interval while waiting for the other side
+#define SHARED_MEM_WAIT_TIMEOUT_US        100000 // host gives up on a PRU that never finishes a frame
+
+// led word - bits 23-0 are clocked out msb first in WS2812 order (green, red, blue)
+#define SHARED_MEM_LED_WORD(red, green, blue) (((uint32_t)(green) << 16) | ((uint32_t)(red) << 8) | (uint32_t)(blue))
+
+#define SHARED_MEM_SIZE       ((SHARED_MEM_LED_BUFFER_OFFSET + SHARED_MEM_LED_BUFFER_COUNT * SHARED_MEM_LED_BUFFER_SIZE) * sizeof(uint32_t))
 
 #endif // ifdef __SHARE_H__
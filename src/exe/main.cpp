@@ -12,7 +12,9 @@
 #include <unistd.h>
 #include "debug.h"
 #include "led.h"
+#include "led_codec.h"
 #include "led_server.h"
+#include "led_pru_sim.h"
 #include "led_client.h"
 #include "share.h"
 
@@ -30,6 +32,14 @@ int port_num = DEFAULT_PORT_NUM;
 bool client_mode = false;
 bool server_mode = false;
 bool port_set = false;
+led_transport_t transport = LED_TRANSPORT_TCP;
+std::string socket_path;
+std::string shm_ring_name;
+std::string preset_store_path;
+bool pru_output = false;
+uint32_t output_rate = 0;
+int64_t preset_id = -1;
+led_io_backend_t io_backend = LED_IO_BACKEND_EPOLL;
 
 uint8_t led_count = 0;
 uint8_t red_value = 0;
@@ -85,7 +95,7 @@ int main(int argc, char *argv[])
 
         leds->print_all_leds();
     }
-    else
+    else if (preset_id < 0)
     {
         // require arg
         usage(argv[0]);
@@ -100,6 +110,49 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    // unix socket path replaces IP / port
+    if (transport == LED_TRANSPORT_UNIX && port_set)
+    {
+        printf("Can't use both port and unix socket path\n");
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (!client_mode && !server_mode && (!socket_path.empty() || !shm_ring_name.empty()))
+    {
+        printf("Can't set unix socket path or shared memory ring unless using client or server mode\n");
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (preset_id >= 0 && (!client_mode || !shm_ring_name.empty()))
+    {
+        printf("Can't activate a preset unless sending to a server in client mode\n");
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (!preset_store_path.empty() && !server_mode)
+    {
+        printf("Can't serve a preset store unless using server mode\n");
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (output_rate > 0 && !pru_output)
+    {
+        printf("Can't set an output rate without PRU output\n");
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (pru_output && !server_mode)
+    {
+        printf("Can't write PRU output unless using server mode\n");
+        usage(argv[0]);
+        return -1;
+    }
+
     // trying to use both client+server
     if (client_mode && server_mode)
     {
@@ -108,22 +161,82 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    if (client_mode)
+    if (client_mode && !shm_ring_name.empty())
     {
-        Led_Client client(ip_addr, port_num);
+        Led_Shm_Producer producer(shm_ring_name);
         std::vector<uint8_t> data = leds->get_led_net_frame();
+        printf("Client Mode (shared memory)\n");
+
+        producer.initialize();
+        if (!producer.send(data))
+        {
+            fprintf(stderr, "Shared memory ring %s is full\n", shm_ring_name.c_str());
+            return -1;
+        }
+    }
+    else if (client_mode)
+    {
+        std::unique_ptr<Led_Client> client;
         printf("Client Mode\n");
 
-        client.initialize();
-        client.send(data);
+        if (transport == LED_TRANSPORT_UNIX)
+        {
+            client = std::unique_ptr<Led_Client>(new Led_Client(socket_path));
+        }
+        else
+        {
+            client = std::unique_ptr<Led_Client>(new Led_Client(ip_addr, port_num, transport));
+        }
+
+        client->initialize();
+        if (preset_id >= 0)
+        {
+            client->activate_preset((uint32_t)preset_id);
+        }
+        else
+        {
+            client->send(*leds);
+        }
     }
     else if (server_mode)
     {
-        Led_Server server(port_num);
+        std::unique_ptr<Led_Server> server;
         dbg_notice("Using server Mode\n");
 
-        server.initialize();
-        server.start_server();
+        if (transport == LED_TRANSPORT_UNIX)
+        {
+            server = std::unique_ptr<Led_Server>(new Led_Server(socket_path));
+        }
+        else
+        {
+            server = std::unique_ptr<Led_Server>(new Led_Server(port_num, transport));
+        }
+
+        if (!shm_ring_name.empty())
+        {
+            server->set_shm_ring(shm_ring_name);
+        }
+
+        if (!preset_store_path.empty())
+        {
+            server->set_preset_store(preset_store_path);
+        }
+
+        server->set_pru_output(pru_output);
+        server->set_output_rate(output_rate);
+        server->set_io_backend(io_backend);
+        server->initialize();
+
+#if DEBUG_NO_SHMEM
+        // no PRU behind the debug file, simulate one once the server mapped it
+        std::unique_ptr<Led_Pru_Sim> pru_sim;
+        if (pru_output)
+        {
+            pru_sim = std::unique_ptr<Led_Pru_Sim>(new Led_Pru_Sim());
+        }
+#endif
+
+        server->start_server();
     }
 
     return 0;
@@ -131,12 +244,21 @@ int main(int argc, char *argv[])
 
 void usage(const char *executable_name)
 {
-    fprintf(stderr, "usage: %s [-d] [-s] [-c <IP>] [-p <port>] [[-n led_count] [-r value] [-g value] [-b value] OR [-l input_file]]\n", executable_name);
+    fprintf(stderr, "usage: %s [-d] [-s] [-c <IP>] [-p <port> | -x <path>] [-u] [-m <name>] [-i] [-o [-R <rate>]] [-N <count>] [-P <store>] [-a <id> | [-n led_count] [-r value] [-g value] [-b value] OR [-l input_file]]]\n", executable_name);
     fprintf(stderr, "        -h               - print this help text\n");
     fprintf(stderr, "        -d <mode>        - set debug logging mode (0-%d)\n", (DEBUG_MODE_COUNT-1));
     fprintf(stderr, "        -s               - run in server mode\n");
     fprintf(stderr, "        -c <IP>          - send client configuration to server at IP address\n");
     fprintf(stderr, "        -p <port>        - port for client connect destination / port for server to listen on (default 1632)\n");
+    fprintf(stderr, "        -x <path>        - connect / listen on unix socket path instead of port (client IP is ignored)\n");
+    fprintf(stderr, "        -m <name>        - server also reads frames from shared memory ring /dev/shm/<name>, client writes to it\n");
+    fprintf(stderr, "        -u               - send / receive frames as UDP datagrams (newest frame wins)\n");
+    fprintf(stderr, "        -i               - server uses io_uring instead of epoll when the kernel supports it\n");
+    fprintf(stderr, "        -o               - server writes the newest frame to PRU shared memory (%s)\n", SHARED_MEM_MAP_FILE);
+    fprintf(stderr, "        -R <rate>        - server writes the PRU output rate times per second (1-%u), not as frames arrive\n", Led_Frame_Pacer::get_max_refresh_rate());
+    fprintf(stderr, "        -N <count>       - accept frames of up to count leds (default %d, maximum %d)\n", LED_MAX_COUNT, LED_MAX_COUNT_LIMIT);
+    fprintf(stderr, "        -P <store>       - server applies presets from store file (mapped, read when a preset is used)\n");
+    fprintf(stderr, "        -a <id>          - client activates preset id on the server instead of sending LEDs\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "    Configure LEDs manually\n");
     fprintf(stderr, "        -n <led_count>   - number of LEDs connected\n");
@@ -152,7 +274,7 @@ void usage(const char *executable_name)
 int parse_args(int argc, char *argv[])
 {
     int opt; 
-    const char *short_opt = "hsd:n:c:r:g:b:l:";
+    const char *short_opt = "hsuiod:n:c:p:x:m:R:N:P:a:r:g:b:l:";
     struct option long_opt[] =
     {
         {"help",          no_argument,       NULL, 'h'},
@@ -160,6 +282,15 @@ int parse_args(int argc, char *argv[])
         {"debug",         required_argument, NULL, 'd'},
         {"client",        required_argument, NULL, 'c'},
         {"port",          required_argument, NULL, 'p'},
+        {"unix",          required_argument, NULL, 'x'},
+        {"udp",           no_argument,       NULL, 'u'},
+        {"shm",           required_argument, NULL, 'm'},
+        {"io-uring",      no_argument,       NULL, 'i'},
+        {"output",        no_argument,       NULL, 'o'},
+        {"rate",          required_argument, NULL, 'R'},
+        {"max-leds",      required_argument, NULL, 'N'},
+        {"presets",       required_argument, NULL, 'P'},
+        {"preset",        required_argument, NULL, 'a'},
         {"count",         required_argument, NULL, 'n'},
         {"red",           required_argument, NULL, 'r'},
         {"green",         required_argument, NULL, 'g'},
@@ -212,6 +343,86 @@ int parse_args(int argc, char *argv[])
                 dbg_notice("using port %d", port_num);
                 break;
 
+            // unix socket path for client/server mode
+            case 'x':
+                if (transport == LED_TRANSPORT_UDP)
+                {
+                    fprintf(stderr, "Option -%c can't be used with -u\n", opt);
+                    return -1;
+                }
+                transport = LED_TRANSPORT_UNIX;
+                socket_path = std::string(optarg);
+                dbg_notice("using unix socket %s", socket_path.c_str());
+                break;
+
+            // shared memory ring for same host client/server
+            case 'm':
+                shm_ring_name = std::string("/") + std::string(optarg);
+                dbg_notice("using shared memory ring %s", shm_ring_name.c_str());
+                break;
+
+            // datagram transport for client/server mode
+            case 'u':
+                if (transport == LED_TRANSPORT_UNIX)
+                {
+                    fprintf(stderr, "Option -%c can't be used with -x <path>\n", opt);
+                    return -1;
+                }
+                transport = LED_TRANSPORT_UDP;
+                dbg_notice("using UDP transport");
+                break;
+
+            // completion based server event loop
+            case 'i':
+                io_backend = LED_IO_BACKEND_URING;
+                dbg_notice("using io_uring backend");
+                break;
+
+            // frames reach the leds through the PRU
+            case 'o':
+                pru_output = true;
+                dbg_notice("using PRU output");
+                break;
+
+            // fixed output rate of the PRU writes
+            case 'R':
+                if (!isdigit(optarg[0]) || atoi(optarg) < 1 || (uint32_t)atoi(optarg) > Led_Frame_Pacer::get_max_refresh_rate())
+                {
+                    fprintf(stderr, "Argument for -%c must be an integer in range 1-%u\n", opt, Led_Frame_Pacer::get_max_refresh_rate());
+                    return -1;
+                }
+                output_rate = atoi(optarg);
+                dbg_notice("using output rate %u", output_rate);
+                break;
+
+            // led count limit of client and server, frames of larger strips are streamed
+            case 'N':
+                if (!isdigit(optarg[0]) || atoi(optarg) < 1 || atoi(optarg) > LED_MAX_COUNT_LIMIT)
+                {
+                    fprintf(stderr, "Argument for -%c must be an integer in range 1-%d\n", opt, LED_MAX_COUNT_LIMIT);
+                    return -1;
+                }
+                Led_Codec::set_max_led_count(atoi(optarg));
+                dbg_notice("set led count limit: %d", atoi(optarg));
+                break;
+
+            // preset store served by the server
+            case 'P':
+                preset_store_path = std::string(optarg);
+                dbg_notice("using preset store %s", preset_store_path.c_str());
+                break;
+
+            // preset activated by the client
+            case 'a':
+                if (!isdigit(optarg[0]) || strtoll(optarg, NULL, 10) > UINT32_MAX)
+                {
+                    fprintf(stderr, "Argument for -%c must be in range 0-%u\n", opt, UINT32_MAX);
+                    return -1;
+                }
+                preset_id = strtoll(optarg, NULL, 10);
+                dbg_notice("activate preset %" PRId64, preset_id);
+                break;
+
             // led count
             case 'n':
                 uint32_t leds_value;
@@ -6,6 +6,17 @@
 
 void dbg_verbose_print_vector(const std::vector<uint8_t> &client_message)
 {
+    dbg_verbose_print_buffer(client_message.data(), client_message.size());
+}
+
+void dbg_verbose_print_buffer(const uint8_t *client_message, size_t size)
+{
+    // formatting the dump is expensive, skip unless verbose logging is enabled
+    if (debug_mode < DEBUG_VERBOSE)
+    {
+        return;
+    }
+
     // byte count
     fprintf(stderr, "%s::%d - %s(VERBOSE) -                         PRINT VECTOR\n",__FILE__,__LINE__,__FUNCTION__);
     fprintf(stderr, "%s::%d - %s(VERBOSE) - ",__FILE__,__LINE__,__FUNCTION__);
@@ -17,10 +28,10 @@ void dbg_verbose_print_vector(const std::vector<uint8_t> &client_message)
     fprintf(stderr, "\n");
 
     // value
-    for (int x = 0; x < client_message.size(); x+=0x10)
+    for (int x = 0; x < size; x+=0x10)
     {
         fprintf(stderr, "%s::%d - %s(VERBOSE) - %02X: ",__FILE__,__LINE__,__FUNCTION__, (x & 0xFF));
-        for (int y = 0; (y < 0x10) && ((x+y) < client_message.size()); y++)
+        for (int y = 0; (y < 0x10) && ((x+y) < size); y++)
         {
             fprintf(stderr, "%02X ", (client_message[x+y] & 0xFF) );
         }
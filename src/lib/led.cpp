@@ -14,12 +14,13 @@
 #include "debug.h"
 #include "share.h"
 #include "led.h"
+#include "led_codec.h"
+#include "led_compact.h"
 
 // loaded LED file must start with this string
 const std::string Led_Strip::led_magic = std::string(LED_MAGIC);
 const Led_Strip::led_color_t Led_Strip::led_color_white = {255, 255, 255};
 const int Led_Strip::led_file_min_len = (led_magic.length() + sizeof(led_color_t));
-const int Led_Strip::led_file_max_len = (Led_Strip::led_file_min_len + (WS2812_LED_COUNT*sizeof(led_color_t)));
 
 Led_Strip::Led_Strip(int led_count_arg)
     : led_strip(led_count_arg, led_color_white)
@@ -58,6 +59,11 @@ int Led_Strip::get_led_count()
     return led_strip.size();
 }
 
+const Led_Strip::led_color_t *Led_Strip::get_led_colors()
+{
+    return led_strip.data();
+}
+
 std::unique_ptr<Led_Strip::led_color_t> Led_Strip::get_led_color(uint32_t led_index)
 {
     std::unique_ptr<led_color_t> return_led = std::unique_ptr<led_color_t>(new led_color_t);;
@@ -224,6 +230,11 @@ Led_Strip& Led_Strip::print_all_leds()
     return *this;
 }
 
+size_t Led_Strip::get_led_file_max_len()
+{
+    return led_magic.length() + (Led_Codec::get_max_led_count() * sizeof(led_color_t));
+}
+
 Led_Strip& Led_Strip::load_all_leds(const char *file_path)
 {
     std::streampos file_size = 0;
@@ -244,9 +255,9 @@ Led_Strip& Led_Strip::load_all_leds(const char *file_path)
     std::cout << "file_size = " << file_size << std::endl;
 
     // reject if file length not in range
-    if (file_size < led_file_min_len || file_size > led_file_max_len)
+    if (file_size < led_file_min_len || (size_t)file_size > get_led_file_max_len())
     {
-        err_str << "Led_Strip data file not in range (" << led_file_min_len << " - " << led_file_max_len << ")";
+        err_str << "Led_Strip data file not in range (" << led_file_min_len << " - " << get_led_file_max_len() << ")";
         throw std::runtime_error(err_str.str());
     }
 
@@ -352,93 +363,38 @@ int Led_Strip::get_led_net_frame_size()
 std::vector<uint8_t> Led_Strip::get_led_net_frame()
 {
     std::vector<uint8_t> led_frame_data(get_led_net_frame_size());
-    uint32_t net_led_count = htonl(get_led_count());
-    char magic_str[] = LED_MAGIC;
-    uint8_t *frame_ptr;
-
-    if (led_frame_data.size() < get_led_net_frame_size())
-    {
-        std::string err = "Failed to allocate space for frame";
-        dbg_error("%s", err.c_str());
-        throw std::runtime_error(err);
-    }
 
-    // copy magic string
-    frame_ptr = led_frame_data.data();
-    memcpy(frame_ptr, magic_str, LED_MAGIC_LEN);
-
-    // copy led count
-    frame_ptr += LED_MAGIC_LEN;
-    memcpy(frame_ptr, &net_led_count, sizeof(net_led_count));
-
-    // copy led rgb values
-    frame_ptr += sizeof(net_led_count);
-    memcpy(frame_ptr, led_strip.data(), (led_strip.size() * sizeof(led_color_t)));
+    encode_into(led_frame_data.data(), led_frame_data.size());
 
     return led_frame_data;
 }
 
 Led_Strip& Led_Strip::set_leds_from_net_frame(std::vector<uint8_t> &net_frame)
 {
-    uint32_t led_count;
-    char magic_str[] = LED_MAGIC;
-    led_net_t *net_frame_ptr;
-    int remaining_bytes;
-    int expected_remaining_bytes;
-    std::vector<led_color_t> copied_led_strip;
-
-    // check if frame is too small
-    if (net_frame.size() < sizeof(led_net_t))
-    {
-        std::ostringstream err_str;
-        err_str << "Network frame too small, received " << net_frame.size() << " bytes (expected " << sizeof(led_net_t) << ")";
-        dbg_error("%s", err_str.str().c_str());
-        throw std::runtime_error(err_str.str());
-    }
-
-    // reinterpret vector data as led_net_t
-    net_frame_ptr = reinterpret_cast<led_net_t*>(net_frame.data());
-
-    // check for LEDS magic value
-    for (int i = 0; i < LED_MAGIC_LEN; i++)
-    {
-        if (net_frame_ptr->led_magic[i] != magic_str[i])
-        {
-            std::string err = "Failed to validate net frame magic value";
-            dbg_error("%s", err.c_str());
-            throw std::runtime_error(err);
-        }
-    }
-
-    // convert led count back to host format
-    led_count = ntohl(net_frame_ptr->net_led_count);
+    return set_leds_from_frame(net_frame.data(), net_frame.size());
+}
 
-    // check if led count matches given the number bytes remaining in net_frame
-    remaining_bytes = net_frame.size() - sizeof(led_net_t);
-    expected_remaining_bytes = led_count * sizeof(led_color_t);
+size_t Led_Strip::encode_into(uint8_t *buffer, size_t buffer_size)
+{
+    return Led_Codec::encode_into(led_strip.data(), led_strip.size(), buffer, buffer_size);
+}
 
-    if (remaining_bytes != expected_remaining_bytes)
-    {
-        std::ostringstream err_str;
-        err_str << "Network frame size did not match, " << remaining_bytes << " bytes remaining in frame (expected " << expected_remaining_bytes << ")";
-        dbg_error("%s", err_str.str().c_str());
-        throw std::runtime_error(err_str.str());
-    }
+Led_Strip& Led_Strip::set_leds_from_frame(const uint8_t *net_frame, size_t frame_size)
+{
+    // validates the frame, throws before this strip is modified
+    Led_Codec::led_frame_view_t view = Led_Codec::decode_view(net_frame, frame_size);
 
-    // allocate space for new led configuration
-    copied_led_strip.resize(led_count);
-    if (copied_led_strip.size() != led_count)
-    {
-        std::string err = "Failed to allocate space for led colors";
-        dbg_error("%s", err.c_str());
-        throw std::runtime_error(err);
-    }
+    // copy straight from the received bytes into the strip
+    led_strip.assign(view.led_colors, view.led_colors + view.led_count);
 
-    // copy from net_frame to new led configuration
-    memcpy(copied_led_strip.data(), net_frame_ptr->raw_led_data, led_count*sizeof(led_color_t));
+    return *this;
+}
 
-    // update this->led_strip to configuration copied from net_frame
-    led_strip = copied_led_strip;
+Led_Strip& Led_Strip::set_leds_from_compact(const uint8_t *compact, size_t compact_size)
+{
+    // validates the frame, throws before this strip is modified
+    led_strip.resize(Led_Compact::validate(compact, compact_size));
+    Led_Compact::decode_into(compact, compact_size, led_strip.data(), led_strip.size());
 
     return *this;
 }
@@ -7,17 +7,101 @@
 #include <iostream>
 #include <cstring>
 #include <chrono>
+#include <algorithm>
 #include <thread>
 #include <errno.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <endian.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 
 #include "debug.h"
 #include "led_client.h"
 #include "led.h"
+#include "led_message.h"
+#include "led_codec.h"
+#include "led_delta.h"
+#include "led_compact.h"
 
-Led_Client::Led_Client(std::string ip, int port)
-    : Led_Network()
+
+static uint32_t get_frame_checksum(const struct iovec *frame_iov, int frame_iov_count)
+{
+    uint32_t frame_checksum = LED_MSG_CHECKSUM_SEED;
+
+    // checksummed where the pieces are stored
+    for (int i = 0; i < frame_iov_count; i++)
+    {
+        frame_checksum = Led_Message::checksum(static_cast<const uint8_t*>(frame_iov[i].iov_base), frame_iov[i].iov_len, frame_checksum);
+    }
+
+    return frame_checksum;
+}
+
+Led_Client::Led_Client(std::string ip, int port, led_transport_t transport)
+    : Led_Network(transport)
     , server_ip(ip)
     , server_port(port)
+    , streaming(false)
+    , window_size(LED_PIPELINE_DEFAULT_WINDOW)
+    , sent_sequence(0)
+    , acked_sequence(0)
+    , echo(false)
+    , last_ack_status(LED_ACK_STATUS_OK)
+    , rejected_count(0)
+    , outstanding_checksums(LED_PIPELINE_MAX_WINDOW)
+    , zerocopy(false)
+    , zerocopy_min_size(LED_ZEROCOPY_MIN_SIZE)
+    , zerocopy_enabled(false)
+    , zerocopy_started(0)
+    , zerocopy_completed(0)
+    , zerocopy_send_count(0)
+    , zerocopy_copied_count(0)
+    , delta(false)
+    , delta_base_sequence(0)
+    , delta_base_valid(false)
+    , delta_frame_count(0)
+    , keyframe_count(0)
+    , compact(false)
+    , compact_frame_count(0)
+    , dedup(false)
+    , applied_hash(0)
+    , applied_hash_valid(false)
+    , same_frame_count(0)
+{
+}
+
+Led_Client::Led_Client(std::string socket_path)
+    : Led_Network(LED_TRANSPORT_UNIX)
+    , server_port(0)
+    , server_path(socket_path)
+    , streaming(false)
+    , window_size(LED_PIPELINE_DEFAULT_WINDOW)
+    , sent_sequence(0)
+    , acked_sequence(0)
+    , echo(false)
+    , last_ack_status(LED_ACK_STATUS_OK)
+    , rejected_count(0)
+    , outstanding_checksums(LED_PIPELINE_MAX_WINDOW)
+    , zerocopy(false)
+    , zerocopy_min_size(LED_ZEROCOPY_MIN_SIZE)
+    , zerocopy_enabled(false)
+    , zerocopy_started(0)
+    , zerocopy_completed(0)
+    , zerocopy_send_count(0)
+    , zerocopy_copied_count(0)
+    , delta(false)
+    , delta_base_sequence(0)
+    , delta_base_valid(false)
+    , delta_frame_count(0)
+    , keyframe_count(0)
+    , compact(false)
+    , compact_frame_count(0)
+    , dedup(false)
+    , applied_hash(0)
+    , applied_hash_valid(false)
+    , same_frame_count(0)
 {
 }
 
@@ -31,15 +115,30 @@ void Led_Client::initialize()
     {
         dbg_notice("Initialize client");
 
-        // create TCP socket
+        // create TCP or UDP socket
         create_socket();
 
-        // bind socket to server IPv4 address / port
+        // bind socket to server IPv4 address / port (sets the default datagram destination for UDP) or socket path
         bind_socket();
 
         // set maximum time to wait for server response
         set_socket_timeout();
 
+        // completion ids restart with every socket
+        zerocopy_enabled = false;
+        zerocopy_started = 0;
+        zerocopy_completed = 0;
+        if (zerocopy && transport == LED_TRANSPORT_TCP)
+        {
+            enable_zerocopy();
+        }
+
+        // detect a dead server while a streaming session is idle
+        if (streaming && transport == LED_TRANSPORT_TCP)
+        {
+            enable_keepalive(socket_fd);
+        }
+
         // Update socket init status
         socket_initialized = true;
     }
@@ -47,6 +146,13 @@ void Led_Client::initialize()
 
 void Led_Client::bind_socket()
 {
+    // same host server on a socket path
+    if (transport == LED_TRANSPORT_UNIX)
+    {
+        bind_unix_socket();
+        return;
+    }
+
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = inet_addr(server_ip.c_str());
     server_addr.sin_port = htons(server_port);
@@ -83,6 +189,44 @@ void Led_Client::bind_socket()
     dbg_notice("Successfully bind socket");
 }
 
+void Led_Client::bind_unix_socket()
+{
+    struct sockaddr_un server_unix_addr = {};
+
+    if (server_path.empty() || server_path.length() >= sizeof(server_unix_addr.sun_path))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client socket path length " << server_path.length() << " out of range (1-" << (sizeof(server_unix_addr.sun_path) - 1) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (socket_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client bind received invalid socket descriptor: " << socket_fd;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    server_unix_addr.sun_family = AF_UNIX;
+    strncpy(server_unix_addr.sun_path, server_path.c_str(), sizeof(server_unix_addr.sun_path) - 1);
+
+    // connect to server
+    if (connect(socket_fd, (struct sockaddr*)&server_unix_addr, sizeof(server_unix_addr)) < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client failed to connect to " << server_path << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_notice("Successfully connected to %s", server_path.c_str());
+}
+
 void Led_Client::set_socket_timeout()
 {  
     // timeout after 3 seconds if connect fails
@@ -111,20 +255,986 @@ void Led_Client::set_socket_timeout()
     dbg_notice("set timeout to 3 seconds");
 }
 
+void Led_Client::enable_zerocopy()
+{
+    int opt = 1;
+
+    // not an error - sends are copied as before
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) < 0)
+    {
+        dbg_notice("zero copy not supported, copying sends: %s (%d)", strerror(errno), errno);
+        return;
+    }
+
+    zerocopy_enabled = true;
+}
+
+void Led_Client::wait_zerocopy_completions()
+{
+    uint8_t control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    const struct sock_extended_err *ee;
+    auto deadline = get_message_deadline();
+
+    // completions are queued on the socket error queue, each one covers a range of send ids
+    while (zerocopy_completed != zerocopy_started)
+    {
+        if (check_tcp_timeout(deadline))
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Client timed out waiting for " << (zerocopy_started - zerocopy_completed) << " zero copy completions";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(socket_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                // a queued completion is reported as POLLERR
+                wait_socket(socket_fd, 0, deadline);
+                continue;
+            }
+
+            std::ostringstream err_str;
+
+            err_str << "Led_Client failed to read zero copy completion: " << strerror(errno) << " (" << errno << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                    && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+
+            ee = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY || ee->ee_errno != 0)
+            {
+                continue;
+            }
+
+            // ee_info to ee_data is the inclusive range of completed send ids
+            zerocopy_completed += ee->ee_data - ee->ee_info + 1;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zerocopy_copied_count++;
+            }
+        }
+    }
+}
+
+void Led_Client::set_delta(bool enable)
+{
+    delta = enable;
+}
+
+bool Led_Client::get_delta()
+{
+    return delta;
+}
+
+int Led_Client::get_delta_frame_count()
+{
+    return delta_frame_count;
+}
+
+int Led_Client::get_keyframe_count()
+{
+    return keyframe_count;
+}
+
+void Led_Client::set_compact(bool enable)
+{
+    compact = enable;
+}
+
+bool Led_Client::get_compact()
+{
+    return compact;
+}
+
+int Led_Client::get_compact_frame_count()
+{
+    return compact_frame_count;
+}
+
+void Led_Client::set_dedup(bool enable)
+{
+    dedup = enable;
+    applied_hash_valid = false;
+}
+
+bool Led_Client::get_dedup()
+{
+    return dedup;
+}
+
+int Led_Client::get_same_frame_count()
+{
+    return same_frame_count;
+}
+
+void Led_Client::set_zerocopy(bool enable, size_t min_size)
+{
+    zerocopy = enable;
+    zerocopy_min_size = min_size;
+}
+
+bool Led_Client::get_zerocopy()
+{
+    return zerocopy;
+}
+
+int Led_Client::get_zerocopy_send_count()
+{
+    return zerocopy_send_count;
+}
+
+int Led_Client::get_zerocopy_copied_count()
+{
+    return zerocopy_copied_count;
+}
+
+void Led_Client::set_streaming(bool enable)
+{
+    streaming = enable;
+}
+
+bool Led_Client::get_streaming()
+{
+    return streaming;
+}
+
+void Led_Client::close_connection()
+{
+    close_socket();
+    socket_initialized = false;
+
+    // unacknowledged frames are lost with the connection, the next session starts with a keyframe
+    acked_sequence = sent_sequence;
+    delta_base_valid = false;
+}
+
+void Led_Client::set_echo(bool enable)
+{
+    echo = enable;
+}
+
+bool Led_Client::get_echo()
+{
+    return echo;
+}
+
+uint32_t Led_Client::get_last_ack_status()
+{
+    return last_ack_status;
+}
+
+int Led_Client::get_rejected_count()
+{
+    return rejected_count;
+}
+
+void Led_Client::set_window_size(int window_size_arg)
+{
+    if (window_size_arg < 1 || window_size_arg > LED_PIPELINE_MAX_WINDOW)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client window size " << window_size_arg << " out of range (1-" << LED_PIPELINE_MAX_WINDOW << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    window_size = window_size_arg;
+}
+
+int Led_Client::get_window_size()
+{
+    return window_size;
+}
+
+int Led_Client::get_outstanding_count()
+{
+    return (int)(sent_sequence - acked_sequence);
+}
+
+uint32_t Led_Client::get_acked_sequence()
+{
+    return acked_sequence;
+}
+
+uint32_t Led_Client::send_pipelined(const std::vector<uint8_t> &client_message)
+{
+    struct iovec frame_iov;
+
+    frame_iov.iov_base = const_cast<uint8_t*>(client_message.data());
+    frame_iov.iov_len = client_message.size();
+
+    return send_pipelined_frame(&frame_iov, 1);
+}
+
+uint32_t Led_Client::send_pipelined(Led_Strip &leds)
+{
+    uint8_t frame_header[sizeof(Led_Strip::led_net_t)];
+    struct iovec frame_iov[2];
+    Led_Codec::led_frame_view_t frame_view;
+
+    frame_iov[0].iov_base = frame_header;
+    frame_iov[0].iov_len = Led_Codec::encode_header_into(leds.get_led_count(), frame_header, sizeof(frame_header));
+    frame_iov[1].iov_base = const_cast<Led_Strip::led_color_t*>(leds.get_led_colors());
+    frame_iov[1].iov_len = leds.get_led_count() * sizeof(Led_Strip::led_color_t);
+
+    frame_view.led_count = leds.get_led_count();
+    frame_view.led_colors = leds.get_led_colors();
+
+    return send_pipelined_frame(frame_iov, 2, &frame_view);
+}
+
+uint32_t Led_Client::send_pipelined_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view)
+{
+    Led_Frame_Pool::Buffer compact_buffer;
+    struct iovec compact_iov;
+
+    // pipelining requires the session to stay open
+    initialize();
+
+    // collect acks that already arrived, then wait only if the window is full
+    receive_available_acks();
+    while (get_outstanding_count() >= window_size)
+    {
+        receive_ack();
+    }
+
+    // compact frames need no base, they can be pipelined like full frames
+    compact_iov.iov_len = 0;
+    if (frame_view != nullptr && compact)
+    {
+        compact_iov.iov_len = encode_compact(*frame_view, compact_buffer);
+        compact_iov.iov_base = compact_buffer.data();
+    }
+
+    if (compact_iov.iov_len > 0)
+    {
+        send_message(LED_MSG_TYPE_COMPACT, &compact_iov, 1, 0, get_frame_checksum(frame_iov, frame_iov_count));
+        compact_frame_count++;
+    }
+    else
+    {
+        send_message(LED_MSG_TYPE_FRAME, frame_iov, frame_iov_count, 0, get_frame_checksum(frame_iov, frame_iov_count));
+    }
+
+    return sent_sequence;
+}
+
+void Led_Client::flush()
+{
+    // wait for every frame in flight to be acknowledged
+    while (get_outstanding_count() > 0)
+    {
+        receive_ack();
+    }
+}
+
+void Led_Client::send_message(uint8_t type, const struct iovec *payload_iov, int payload_iov_count, uint8_t flags, uint32_t frame_checksum)
+{
+    uint8_t message_header[LED_MSG_HEADER_SIZE];
+    struct iovec message_iov[1 + LED_FRAME_MAX_IOV];
+    size_t payload_size = 0;
+
+    if (payload_iov_count > LED_FRAME_MAX_IOV)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client frame split into " << payload_iov_count << " pieces (maximum " << LED_FRAME_MAX_IOV << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    // the payload is sent where it is stored, only the header is encoded here
+    for (int i = 0; i < payload_iov_count; i++)
+    {
+        payload_size += payload_iov[i].iov_len;
+        message_iov[i + 1] = payload_iov[i];
+    }
+
+    // the ack carries the checksum of the frame the server applied
+    sent_sequence++;
+    outstanding_checksums[sent_sequence % LED_PIPELINE_MAX_WINDOW] = frame_checksum;
+
+    message_iov[0].iov_base = message_header;
+    message_iov[0].iov_len = Led_Message::encode_header_into(type, flags, sent_sequence, payload_size,
+            message_header, sizeof(message_header));
+
+    if (!zerocopy_enabled || (LED_MSG_HEADER_SIZE + payload_size) < zerocopy_min_size)
+    {
+        send_all(socket_fd, message_iov, payload_iov_count + 1);
+        return;
+    }
+
+    zerocopy_started += send_all(socket_fd, message_iov, payload_iov_count + 1, MSG_ZEROCOPY);
+    zerocopy_send_count++;
+
+    // the caller may change the frame as soon as send returns
+    wait_zerocopy_completions();
+}
+
+size_t Led_Client::encode_compact(const Led_Codec::led_frame_view_t &frame_view, Led_Frame_Pool::Buffer &compact_buffer)
+{
+    size_t compact_size;
+
+    // the server expands compact frames into a frame buffer, larger strips are streamed as plain frames
+    if (Led_Codec::get_frame_size(frame_view.led_count) > LED_FRAME_POOL_SLOT_SIZE)
+    {
+        return 0;
+    }
+
+    compact_buffer = frame_pool.acquire();
+    compact_size = Led_Compact::encode_into(frame_view.led_colors, frame_view.led_count, compact_buffer.data(), compact_buffer.capacity());
+
+    // raw colors are sent as a plain frame, straight from the strip
+    if (reinterpret_cast<const Led_Compact::led_compact_t*>(compact_buffer.data())->compact_encoding == LED_COMPACT_RAW)
+    {
+        return 0;
+    }
+
+    return compact_size;
+}
+
+bool Led_Client::send_same(uint64_t frame_hash)
+{
+    Led_Message::led_same_t same;
+    struct iovec same_iov;
+
+    same.same_frame_hash = htobe64(frame_hash);
+    same_iov.iov_base = &same;
+    same_iov.iov_len = sizeof(same);
+
+    // the ack confirms the hash of the frame the server shows
+    send_message(LED_MSG_TYPE_SAME, &same_iov, 1, 0, Led_Message::fold_hash(frame_hash));
+    receive_ack();
+
+    // another sender changed the strip - send the frame itself
+    if (last_ack_status == LED_ACK_STATUS_NO_BASE)
+    {
+        return false;
+    }
+
+    same_frame_count++;
+
+    return true;
+}
+
+bool Led_Client::send_delta(uint32_t frame_checksum, const Led_Codec::led_frame_view_t &frame_view, size_t max_size)
+{
+    Led_Frame_Pool::Buffer delta_buffer;
+    struct iovec delta_iov;
+
+    // first frame of a session, or the strip was resized
+    if (!delta_base_valid || delta_base.size() != frame_view.led_count)
+    {
+        return false;
+    }
+
+    delta_buffer = frame_pool.acquire();
+    delta_iov.iov_base = delta_buffer.data();
+    delta_iov.iov_len = Led_Delta::encode_into(delta_base_sequence, delta_base.data(), frame_view.led_colors, frame_view.led_count,
+            delta_buffer.data(), std::min(delta_buffer.capacity(), max_size));
+
+    // too many changes - not smaller than the full (or compact) frame
+    if (delta_iov.iov_len == 0)
+    {
+        return false;
+    }
+
+    send_message(LED_MSG_TYPE_DELTA, &delta_iov, 1, 0, frame_checksum);
+    delta_frame_count++;
+
+    return true;
+}
+
+void Led_Client::receive_ack()
+{
+    Led_Frame_Pool::Buffer response_buffer = frame_pool.acquire();
+    size_t response_size = receive_into(socket_fd, response_buffer.data(), response_buffer.capacity());
+    const Led_Message::led_msg_t *msg_header = Led_Message::parse(response_buffer.data(), response_size);
+    const Led_Message::led_ack_t *ack = Led_Message::get_ack(msg_header);
+    uint32_t sequence = Led_Message::get_sequence(msg_header);
+    uint32_t expected_checksum;
+
+    // server acknowledges in order, sequence must be the next outstanding frame
+    if (sequence != acked_sequence + 1 || get_outstanding_count() == 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client received ack " << sequence << " (expected " << (acked_sequence + 1) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    expected_checksum = outstanding_checksums[sequence % LED_PIPELINE_MAX_WINDOW];
+    acked_sequence = sequence;
+    last_ack_status = ntohl(ack->ack_status);
+
+    // not a rejected frame - the delta is resent as a keyframe
+    if (last_ack_status == LED_ACK_STATUS_NO_BASE)
+    {
+        dbg_notice("delta frame %u has no base on the server", sequence);
+        return;
+    }
+
+    if (last_ack_status != LED_ACK_STATUS_OK)
+    {
+        dbg_error("frame %u rejected by server (status %u)", sequence, last_ack_status);
+        rejected_count++;
+        return;
+    }
+
+    // applied frame must match what was sent
+    if (ntohl(ack->ack_checksum) != expected_checksum)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client ack " << sequence << " checksum " << std::hex << ntohl(ack->ack_checksum)
+            << " did not match sent frame " << expected_checksum;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_verbose("frame %u acknowledged", sequence);
+}
+
+void Led_Client::receive_echo()
+{
+    // debug mode - a streamed frame is echoed in full, larger than any pool buffer
+    std::vector<uint8_t> response = receive_all(socket_fd);
+    const Led_Message::led_msg_t *msg_header = Led_Message::parse(response);
+    uint32_t sequence = Led_Message::get_sequence(msg_header);
+
+    if (sequence != acked_sequence + 1 || get_outstanding_count() == 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client received response " << sequence << " (expected " << (acked_sequence + 1) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // the server acks instead of echoing frames it rejected
+    if (msg_header->msg_type == LED_MSG_TYPE_ACK)
+    {
+        last_ack_status = ntohl(Led_Message::get_ack(msg_header)->ack_status);
+        dbg_error("frame %u rejected by server (status %u)", sequence, last_ack_status);
+        acked_sequence = sequence;
+        rejected_count++;
+        return;
+    }
+
+    if (msg_header->msg_type != LED_MSG_TYPE_FRAME)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client expected echo of frame " << (acked_sequence + 1) << ", received type " << (int)msg_header->msg_type << " sequence " << sequence;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // validate the echoed frame in place, only decoded into a strip for printing
+    Led_Codec::decode_view(msg_header->msg_data, Led_Message::get_payload_size(msg_header));
+    if (debug_mode >= DEBUG_VERBOSE)
+    {
+        Led_Strip response_leds(0);
+
+        response_leds.set_leds_from_frame(msg_header->msg_data, Led_Message::get_payload_size(msg_header));
+        response_leds.print_all_leds();
+    }
+
+    acked_sequence = sequence;
+    last_ack_status = LED_ACK_STATUS_OK;
+}
+
+void Led_Client::receive_available_acks()
+{
+    struct pollfd poll_fd = {};
+
+    poll_fd.fd = socket_fd;
+    poll_fd.events = POLLIN;
+
+    // read acks without waiting while data is ready
+    while (get_outstanding_count() > 0 && poll(&poll_fd, 1, 0) > 0)
+    {
+        receive_ack();
+    }
+}
+
 void Led_Client::send(std::vector<uint8_t> &client_message)
 {
-    Led_Strip response_leds(1);
+    struct iovec frame_iov;
+
+    // datagrams are not acknowledged - the server only applies the newest frame
+    if (transport == LED_TRANSPORT_UDP)
+    {
+        initialize();
+        send_batch(std::vector<std::vector<uint8_t>>(1, client_message));
+        return;
+    }
+
+    dbg_verbose_print_vector(client_message);
+    frame_iov.iov_base = client_message.data();
+    frame_iov.iov_len = client_message.size();
+    send_frame(&frame_iov, 1);
+}
+
+void Led_Client::send(Led_Strip &leds)
+{
+    uint8_t frame_header[sizeof(Led_Strip::led_net_t)];
+    struct iovec frame_iov[2];
+    Led_Codec::led_frame_view_t frame_view;
+
+    // datagrams are sent from one contiguous frame
+    if (transport == LED_TRANSPORT_UDP)
+    {
+        std::vector<uint8_t> client_message = leds.get_led_net_frame();
+
+        send(client_message);
+        return;
+    }
+
+    frame_iov[0].iov_base = frame_header;
+    frame_iov[0].iov_len = Led_Codec::encode_header_into(leds.get_led_count(), frame_header, sizeof(frame_header));
+    frame_iov[1].iov_base = const_cast<Led_Strip::led_color_t*>(leds.get_led_colors());
+    frame_iov[1].iov_len = leds.get_led_count() * sizeof(Led_Strip::led_color_t);
+
+    // deltas are encoded against the colors of the previously sent strip
+    frame_view.led_count = leds.get_led_count();
+    frame_view.led_colors = leds.get_led_colors();
+    send_frame(frame_iov, 2, &frame_view);
+}
+
+void Led_Client::send_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view)
+{
+    // connect on first send, or again after the previous connection was closed
+    initialize();
+
+    // responses would interleave with acks of pipelined frames
+    flush();
 
     // send to server
     dbg_notice("send LEDs to server");
-    dbg_verbose_print_vector(client_message);
-    send_all(socket_fd, client_message);
+    try
+    {
+        exchange_frame(frame_iov, frame_iov_count, frame_view);
+    }
+    catch (const std::runtime_error& e)
+    {
+        // server may have closed an idle session - reconnect once and resend
+        if (!streaming)
+        {
+            throw;
+        }
+
+        dbg_notice("streaming session lost, reconnecting: %s", e.what());
+        close_connection();
+        initialize();
+        exchange_frame(frame_iov, frame_iov_count, frame_view);
+    }
+
+    // one frame per connection unless streaming
+    if (!streaming)
+    {
+        close_connection();
+    }
+
+    if (last_ack_status != LED_ACK_STATUS_OK)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client frame rejected by server (status " << last_ack_status << ")";
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_notice("exit");
+}
+
+void Led_Client::activate_preset(uint32_t preset_id)
+{
+    Led_Message::led_preset_msg_t preset;
+    struct iovec preset_iov;
+
+    preset.preset_id = htonl(preset_id);
+    preset_iov.iov_base = &preset;
+    preset_iov.iov_len = sizeof(preset);
+
+    initialize();
+    flush();
+
+    // the ack carries the preset id instead of a frame checksum
+    dbg_notice("activate preset %u", preset_id);
+    send_message(LED_MSG_TYPE_PRESET, &preset_iov, 1, 0, preset_id);
+    receive_ack();
+
+    // the strip now shows colors this client never sent
+    delta_base_valid = false;
+    applied_hash_valid = false;
+
+    if (!streaming)
+    {
+        close_connection();
+    }
+
+    if (last_ack_status != LED_ACK_STATUS_OK)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client preset " << preset_id << " rejected by server (status " << last_ack_status << ")";
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+void Led_Client::send_strips(const std::vector<Led_Multi::led_strip_ref_t> &strips)
+{
+    uint8_t multi_header[sizeof(Led_Multi::led_multi_t)];
+    uint8_t strip_headers[LED_MAX_STRIPS][LED_MULTI_STRIP_HEADER_SIZE];
+    struct iovec multi_iov[LED_FRAME_MAX_IOV];
+    int iov_count = 0;
+    size_t multi_size = 0;
+
+    if (transport == LED_TRANSPORT_UDP || strips.empty() || strips.size() > LED_MAX_STRIPS)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client multi-strip frame of " << strips.size() << " strips (range 1-" << LED_MAX_STRIPS
+            << ", not over UDP)";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    // only the headers are encoded, the colors are gathered from every strip
+    multi_iov[iov_count].iov_base = multi_header;
+    multi_iov[iov_count].iov_len = Led_Multi::encode_header_into(strips.size(), multi_header, sizeof(multi_header));
+    iov_count++;
+    for (size_t i = 0; i < strips.size(); i++)
+    {
+        multi_iov[iov_count].iov_base = strip_headers[i];
+        multi_iov[iov_count].iov_len = Led_Multi::encode_strip_header_into(strips[i].strip_id, strips[i].leds->get_led_count(),
+                strip_headers[i], sizeof(strip_headers[i]));
+        iov_count++;
+
+        multi_iov[iov_count].iov_base = const_cast<Led_Strip::led_color_t*>(strips[i].leds->get_led_colors());
+        multi_iov[iov_count].iov_len = strips[i].leds->get_led_count() * sizeof(Led_Strip::led_color_t);
+        iov_count++;
+    }
+
+    // only single strip frames are streamed, a multi-strip frame has to fit the server's receive buffer
+    for (int i = 0; i < iov_count; i++)
+    {
+        multi_size += multi_iov[i].iov_len;
+    }
+    if (multi_size > LED_MULTI_MAX_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client multi-strip frame of " << multi_size << " bytes (maximum " << LED_MULTI_MAX_SIZE
+            << ", send larger strips on their own)";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    initialize();
+    flush();
+
+    dbg_notice("send %zu strips to server", strips.size());
+    send_message(LED_MSG_TYPE_MULTI, multi_iov, iov_count, 0, get_frame_checksum(multi_iov, iov_count));
+    receive_ack();
+
+    // strip 0 may have changed, the single strip base and hash no longer apply
+    delta_base_valid = false;
+    applied_hash_valid = false;
+
+    if (!streaming)
+    {
+        close_connection();
+    }
+
+    if (last_ack_status != LED_ACK_STATUS_OK)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client multi-strip frame rejected by server (status " << last_ack_status << ")";
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+void Led_Client::send_timeline(const std::vector<Led_Timeline::led_timeline_ref_t> &frames, bool continue_timeline)
+{
+    size_t max_timeline_size = LED_FRAME_POOL_SLOT_SIZE - LED_MSG_HEADER_SIZE;
+    uint32_t rejected_status = LED_ACK_STATUS_OK;
+    size_t first_frame = 0;
+
+    if (transport == LED_TRANSPORT_UDP || frames.empty())
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client timeline of " << frames.size() << " frames (at least 1, not over UDP)";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    initialize();
+    flush();
+
+    while (first_frame < frames.size())
+    {
+        Led_Frame_Pool::Buffer timeline_buffer;
+        struct iovec timeline_iov;
+        size_t timeline_size = sizeof(Led_Timeline::led_timeline_t);
+        size_t frame_count = 0;
+
+        // as many frames as fit one receive buffer on the server
+        while (first_frame + frame_count < frames.size() && frame_count < LED_TIMELINE_MAX_FRAMES
+                && timeline_size + Led_Timeline::get_frame_size(frames[first_frame + frame_count].leds->get_led_count()) <= max_timeline_size)
+        {
+            timeline_size += Led_Timeline::get_frame_size(frames[first_frame + frame_count].leds->get_led_count());
+            frame_count++;
+        }
+
+        if (frame_count == 0)
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Client timeline frame " << first_frame << " of " << frames[first_frame].leds->get_led_count()
+                << " leds does not fit a " << max_timeline_size << " byte timeline";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::invalid_argument(err_str.str());
+        }
+
+        // the following messages continue the first one
+        timeline_buffer = frame_pool.acquire();
+        timeline_iov.iov_base = timeline_buffer.data();
+        timeline_iov.iov_len = Led_Timeline::encode_into(&frames[first_frame], frame_count,
+                (continue_timeline || first_frame > 0) ? LED_TIMELINE_FLAG_CONTINUE : 0, timeline_buffer.data(), timeline_buffer.capacity());
+
+        while (get_outstanding_count() >= window_size)
+        {
+            receive_ack();
+            if (last_ack_status != LED_ACK_STATUS_OK)
+            {
+                rejected_status = last_ack_status;
+            }
+        }
+
+        dbg_notice("send timeline of %zu frames to server", frame_count);
+        send_message(LED_MSG_TYPE_TIMELINE, &timeline_iov, 1, 0, Led_Message::checksum(timeline_buffer.data(), timeline_iov.iov_len));
+        first_frame += frame_count;
+    }
+
+    while (get_outstanding_count() > 0)
+    {
+        receive_ack();
+        if (last_ack_status != LED_ACK_STATUS_OK)
+        {
+            rejected_status = last_ack_status;
+        }
+    }
+
+    // the strip changes while the timeline plays, the single strip base and hash no longer apply
+    delta_base_valid = false;
+    applied_hash_valid = false;
+
+    if (!streaming)
+    {
+        close_connection();
+    }
+
+    if (rejected_status != LED_ACK_STATUS_OK)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Client timeline rejected by server (status " << rejected_status << ")";
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+void Led_Client::send_batch(const std::vector<std::vector<uint8_t>> &client_messages)
+{
+    std::vector<std::vector<uint8_t>> datagrams;
+
+    initialize();
+
+    if (transport != LED_TRANSPORT_UDP)
+    {
+        for (const std::vector<uint8_t> &client_message : client_messages)
+        {
+            send_pipelined(client_message);
+        }
+        flush();
+        return;
+    }
+
+    // sequence each frame so the server can drop stale / reordered datagrams
+    datagrams.reserve(client_messages.size());
+    for (const std::vector<uint8_t> &client_message : client_messages)
+    {
+        sent_sequence++;
+        datagrams.push_back(Led_Message::create_frame(sent_sequence, client_message));
+    }
+
+    send_datagrams(socket_fd, datagrams);
+
+    // no acks for datagrams
+    acked_sequence = sent_sequence;
+}
+
+void Led_Client::exchange_frame(const struct iovec *frame_iov, int frame_iov_count, const Led_Codec::led_frame_view_t *frame_view)
+{
+    uint32_t frame_checksum;
+    bool use_delta = (frame_view != nullptr && delta && !echo);
+    bool use_dedup = (frame_view != nullptr && dedup && !echo);
+    uint64_t frame_hash = 0;
+    Led_Frame_Pool::Buffer compact_buffer;
+    struct iovec compact_iov;
+
+    // an unchanged strip is only confirmed by its hash
+    if (use_dedup)
+    {
+        frame_hash = Led_Codec::get_frame_hash(*frame_view);
+        if (applied_hash_valid && frame_hash == applied_hash && send_same(frame_hash))
+        {
+            return;
+        }
+    }
+
+    frame_checksum = get_frame_checksum(frame_iov, frame_iov_count);
+
+    // a delta is only sent if it is smaller than the compact frame as well
+    compact_iov.iov_len = 0;
+    if (frame_view != nullptr && compact && !echo)
+    {
+        compact_iov.iov_len = encode_compact(*frame_view, compact_buffer);
+        compact_iov.iov_base = compact_buffer.data();
+    }
+
+    if (!use_delta || !send_delta(frame_checksum, *frame_view, compact_iov.iov_len > 0 ? compact_iov.iov_len : SIZE_MAX))
+    {
+        if (compact_iov.iov_len > 0)
+        {
+            send_message(LED_MSG_TYPE_COMPACT, &compact_iov, 1, 0, frame_checksum);
+            compact_frame_count++;
+        }
+        else
+        {
+            send_message(LED_MSG_TYPE_FRAME, frame_iov, frame_iov_count, echo ? LED_MSG_FLAG_ECHO : 0, frame_checksum);
+        }
+
+        if (use_delta)
+        {
+            keyframe_count++;
+        }
+    }
 
     // get response from server
     dbg_notice("get server response");
-    std::vector<uint8_t> response_data = receive_all(socket_fd);
-    response_leds.set_leds_from_net_frame(response_data);
-    response_leds.print_all_leds();
+    if (echo)
+    {
+        receive_echo();
+    }
+    else
+    {
+        receive_ack();
+    }
 
-    dbg_notice("exit");
+    // the server lost its base - resend in full
+    if (last_ack_status == LED_ACK_STATUS_NO_BASE)
+    {
+        if (compact_iov.iov_len > 0)
+        {
+            send_message(LED_MSG_TYPE_COMPACT, &compact_iov, 1, 0, frame_checksum);
+            compact_frame_count++;
+        }
+        else
+        {
+            send_message(LED_MSG_TYPE_FRAME, frame_iov, frame_iov_count, 0, frame_checksum);
+        }
+        keyframe_count++;
+        receive_ack();
+    }
+
+    // following resends of this strip are sent as its hash
+    if (use_dedup)
+    {
+        applied_hash = frame_hash;
+        applied_hash_valid = (last_ack_status == LED_ACK_STATUS_OK);
+    }
+
+    if (!use_delta)
+    {
+        return;
+    }
+
+    // next delta is encoded against what the server applied
+    if (last_ack_status == LED_ACK_STATUS_OK)
+    {
+        delta_base.assign(frame_view->led_colors, frame_view->led_colors + frame_view->led_count);
+        delta_base_sequence = acked_sequence;
+        delta_base_valid = true;
+    }
+    else
+    {
+        delta_base_valid = false;
+    }
+}
+
+Led_Shm_Producer::Led_Shm_Producer(std::string ring_name_arg)
+    : ring_name(ring_name_arg)
+    , send_message_count(0)
+    , dropped_count(0)
+{
+}
+
+Led_Shm_Producer::~Led_Shm_Producer()
+{
+}
+
+void Led_Shm_Producer::initialize()
+{
+    if (!ring)
+    {
+        dbg_notice("Initialize shared memory producer");
+        ring = std::unique_ptr<Led_Shm_Ring>(new Led_Shm_Ring(ring_name, false));
+    }
+}
+
+bool Led_Shm_Producer::send(const std::vector<uint8_t> &client_message)
+{
+    initialize();
+
+    if (!ring->write_frame(client_message.data(), client_message.size()))
+    {
+        dbg_notice("shared memory ring %s is full, frame dropped", ring_name.c_str());
+        dropped_count++;
+        return false;
+    }
+
+    send_message_count++;
+    return true;
+}
+
+int Led_Shm_Producer::get_send_message_count()
+{
+    return send_message_count;
+}
+
+int Led_Shm_Producer::get_dropped_count()
+{
+    return dropped_count;
 }
@@ -0,0 +1,211 @@
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <arpa/inet.h>
+#include <endian.h>
+
+#include "debug.h"
+#include "led_codec.h"
+
+#define LED_CODEC_HASH_PRIME_1      11400714785074694791ull
+#define LED_CODEC_HASH_PRIME_2      14029467366897019727ull
+#define LED_CODEC_HASH_PRIME_3      1609587929392839161ull
+#define LED_CODEC_HASH_LANES        4
+
+static std::atomic<uint32_t> max_led_count(LED_MAX_COUNT);
+
+static inline uint64_t rotate_left(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// little endian load, the hash must match between client and server
+static inline uint64_t load_word(const uint8_t *data)
+{
+    uint64_t word;
+
+    memcpy(&word, data, sizeof(word));
+
+    return le64toh(word);
+}
+
+static inline uint64_t mix_word(uint64_t hash, uint64_t word)
+{
+    hash += word * LED_CODEC_HASH_PRIME_2;
+    hash = rotate_left(hash, 31);
+
+    return hash * LED_CODEC_HASH_PRIME_1;
+}
+
+void Led_Codec::set_max_led_count(uint32_t max_led_count_arg)
+{
+    if (max_led_count_arg < 1 || max_led_count_arg > LED_MAX_COUNT_LIMIT)
+    {
+        std::ostringstream err_str;
+
+        err_str << "led count limit " << max_led_count_arg << " out of range (1-" << LED_MAX_COUNT_LIMIT << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    max_led_count.store(max_led_count_arg);
+}
+
+uint32_t Led_Codec::get_max_led_count()
+{
+    return max_led_count.load(std::memory_order_relaxed);
+}
+
+size_t Led_Codec::get_frame_size(uint32_t led_count)
+{
+    return sizeof(Led_Strip::led_net_t) + (led_count * sizeof(Led_Strip::led_color_t));
+}
+
+size_t Led_Codec::encode_into(const Led_Strip::led_color_t *led_colors, uint32_t led_count, uint8_t *buffer, size_t buffer_size)
+{
+    size_t frame_size = get_frame_size(led_count);
+    size_t header_size;
+
+    if (buffer_size < frame_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "frame buffer too small - " << buffer_size << " bytes (need " << frame_size << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // header and colors written in place, nothing is zero filled first
+    header_size = encode_header_into(led_count, buffer, buffer_size);
+    memcpy(&buffer[header_size], led_colors, led_count * sizeof(Led_Strip::led_color_t));
+
+    return frame_size;
+}
+
+size_t Led_Codec::encode_header_into(uint32_t led_count, uint8_t *buffer, size_t buffer_size)
+{
+    Led_Strip::led_net_t *net_frame = reinterpret_cast<Led_Strip::led_net_t*>(buffer);
+    char magic_str[] = LED_MAGIC;
+
+    if (buffer_size < sizeof(Led_Strip::led_net_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "frame header buffer too small - " << buffer_size << " bytes (need " << sizeof(Led_Strip::led_net_t) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    memcpy(net_frame->led_magic, magic_str, LED_MAGIC_LEN);
+    net_frame->net_led_count = htonl(led_count);
+
+    return sizeof(Led_Strip::led_net_t);
+}
+
+Led_Codec::led_frame_view_t Led_Codec::decode_view(const uint8_t *frame, size_t frame_size)
+{
+    const Led_Strip::led_net_t *net_frame = reinterpret_cast<const Led_Strip::led_net_t*>(frame);
+    led_frame_view_t view;
+    size_t remaining_bytes;
+    size_t expected_remaining_bytes;
+    char magic_str[] = LED_MAGIC;
+
+    // check if frame is too small
+    if (frame_size < sizeof(Led_Strip::led_net_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Network frame too small, received " << frame_size << " bytes (expected " << sizeof(Led_Strip::led_net_t) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // check for LEDS magic value
+    if (memcmp(net_frame->led_magic, magic_str, LED_MAGIC_LEN) != 0)
+    {
+        std::string err = "Failed to validate net frame magic value";
+        dbg_error("%s", err.c_str());
+        throw std::runtime_error(err);
+    }
+
+    // messages may be larger than one strip (multi-strip frames), the count is bounded on its own
+    view.led_count = ntohl(net_frame->net_led_count);
+    if (view.led_count > get_max_led_count())
+    {
+        std::ostringstream err_str;
+
+        err_str << "Network frame led count " << view.led_count << " out of range (0-" << get_max_led_count() << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // check if led count matches given the number bytes remaining in frame
+    remaining_bytes = frame_size - sizeof(Led_Strip::led_net_t);
+    expected_remaining_bytes = (size_t)view.led_count * sizeof(Led_Strip::led_color_t);
+
+    if (remaining_bytes != expected_remaining_bytes)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Network frame size did not match, " << remaining_bytes << " bytes remaining in frame (expected " << expected_remaining_bytes << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    view.led_colors = net_frame->raw_led_data;
+
+    return view;
+}
+
+uint64_t Led_Codec::hash(const uint8_t *data, size_t size, uint64_t seed)
+{
+    uint64_t lanes[LED_CODEC_HASH_LANES];
+    uint64_t hash;
+    size_t offset = 0;
+
+    // independent lanes keep several multiplies in flight
+    for (int i = 0; i < LED_CODEC_HASH_LANES; i++)
+    {
+        lanes[i] = seed + (i * LED_CODEC_HASH_PRIME_3);
+    }
+
+    for (; offset + (LED_CODEC_HASH_LANES * sizeof(uint64_t)) <= size; offset += LED_CODEC_HASH_LANES * sizeof(uint64_t))
+    {
+        for (int i = 0; i < LED_CODEC_HASH_LANES; i++)
+        {
+            lanes[i] = mix_word(lanes[i], load_word(&data[offset + (i * sizeof(uint64_t))]));
+        }
+    }
+
+    hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18) + size;
+
+    // remaining words, then the tail bytes zero padded to a word
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+    {
+        hash = mix_word(hash, load_word(&data[offset])) + LED_CODEC_HASH_PRIME_3;
+    }
+
+    if (offset < size)
+    {
+        uint8_t tail[sizeof(uint64_t)] = { 0 };
+
+        memcpy(tail, &data[offset], size - offset);
+        hash = mix_word(hash, load_word(tail)) + LED_CODEC_HASH_PRIME_3;
+    }
+
+    // final avalanche, every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= LED_CODEC_HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= LED_CODEC_HASH_PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+uint64_t Led_Codec::get_frame_hash(const led_frame_view_t &view)
+{
+    return hash(reinterpret_cast<const uint8_t*>(view.led_colors), (size_t)view.led_count * sizeof(Led_Strip::led_color_t),
+            LED_CODEC_HASH_SEED ^ view.led_count);
+}
@@ -0,0 +1,490 @@
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <algorithm>
+#include <arpa/inet.h>
+
+#include "debug.h"
+#include "led_compact.h"
+#include "led_delta.h"
+
+#define LED_COMPACT_HASH_SIZE       512                                         // palette lookup slots, twice the largest palette
+#define LED_COMPACT_HASH_SHIFT      23                                          // 32 - log2(LED_COMPACT_HASH_SIZE)
+
+// distinct colors of a frame, filled by the pricing pass and reused by the palette encoder
+typedef struct led_palette_table_t
+{
+    uint32_t keys[LED_COMPACT_HASH_SIZE];                                       // color key + marker bit, 0 for an empty slot
+    uint8_t indexes[LED_COMPACT_HASH_SIZE];
+    uint32_t colors[LED_COMPACT_MAX_PALETTE];
+    uint32_t size;
+    bool incomplete;                                                            // more colors than a palette can hold, or not worth pricing
+} led_palette_table_t;
+
+typedef struct led_compact_cost_t
+{
+    uint32_t run_count;
+    uint32_t index_bits;
+    size_t encoded_size[LED_COMPACT_COUNT];
+} led_compact_cost_t;
+
+static uint32_t get_color_key(const Led_Strip::led_color_t &led_color)
+{
+    return 0x01000000u | ((uint32_t)led_color.red << 16) | ((uint32_t)led_color.green << 8) | led_color.blue;
+}
+
+// index of the color in the palette, added if new - -1 once the palette is full
+static int lookup_palette(led_palette_table_t *palette, uint32_t key)
+{
+    uint32_t slot = (key * 2654435761u) >> LED_COMPACT_HASH_SHIFT;
+
+    while (palette->keys[slot] != 0)
+    {
+        if (palette->keys[slot] == key)
+        {
+            return palette->indexes[slot];
+        }
+
+        slot = (slot + 1) & (LED_COMPACT_HASH_SIZE - 1);
+    }
+
+    if (palette->size >= LED_COMPACT_MAX_PALETTE)
+    {
+        palette->incomplete = true;
+        return -1;
+    }
+
+    palette->keys[slot] = key;
+    palette->indexes[slot] = (uint8_t)palette->size;
+    palette->colors[palette->size] = key;
+
+    return (int)palette->size++;
+}
+
+static uint32_t get_index_bits(uint32_t palette_size)
+{
+    uint32_t index_bits = 1;
+
+    while ((1u << index_bits) < palette_size)
+    {
+        index_bits *= 2;
+    }
+
+    return index_bits;
+}
+
+static size_t get_index_size(uint32_t led_count, uint32_t index_bits)
+{
+    return (((size_t)led_count * index_bits) + 7) / 8;
+}
+
+// first led at or after start that differs from the next one (led_count - 1 at the end of the strip) - the strip
+// is diffed against itself shifted by one led, so equal neighbours are skipped a vector block at a time
+static uint32_t find_run_end(const Led_Strip::led_color_t *led_colors, uint32_t led_count, uint32_t start)
+{
+    const uint8_t *led_bytes = reinterpret_cast<const uint8_t*>(led_colors);
+
+    // single led runs (gradients, patterns) are not worth a kernel call
+    if (start + 1 >= led_count || get_color_key(led_colors[start]) != get_color_key(led_colors[start + 1]))
+    {
+        return std::min(start, led_count - 1);
+    }
+
+    return Led_Delta::find_difference(led_bytes, led_bytes + sizeof(Led_Strip::led_color_t), (size_t)start * sizeof(Led_Strip::led_color_t),
+            (size_t)(led_count - 1) * sizeof(Led_Strip::led_color_t)) / sizeof(Led_Strip::led_color_t);
+}
+
+// exact size of every encoding - runs are counted first, the palette is only built while it could
+// still be smaller than raw / run-length (never for solid fills and ranges) unless full_palette is set
+static void get_costs(const Led_Strip::led_color_t *led_colors, uint32_t led_count, bool full_palette,
+        led_palette_table_t *palette, led_compact_cost_t *cost)
+{
+    uint32_t key;
+    uint32_t previous_key = 0;
+    uint32_t run_start = 0;
+    uint32_t run_end;
+    size_t palette_size;
+    size_t palette_limit = SIZE_MAX;
+
+    // runs longer than a run entry take several
+    cost->run_count = 0;
+    while (run_start < led_count)
+    {
+        run_end = find_run_end(led_colors, led_count, run_start) + 1;
+        cost->run_count += (run_end - run_start + LED_COMPACT_MAX_RUN - 1) / LED_COMPACT_MAX_RUN;
+        run_start = run_end;
+    }
+
+    cost->encoded_size[LED_COMPACT_RAW] = sizeof(Led_Compact::led_compact_t) + ((size_t)led_count * sizeof(Led_Strip::led_color_t));
+    cost->encoded_size[LED_COMPACT_RLE] = sizeof(Led_Compact::led_compact_t) + ((size_t)cost->run_count * sizeof(Led_Compact::led_run_t));
+    cost->encoded_size[LED_COMPACT_PALETTE] = SIZE_MAX;
+    cost->index_bits = 1;
+
+    palette->size = 0;
+    palette->incomplete = true;
+    if (!full_palette)
+    {
+        palette_limit = std::min(cost->encoded_size[LED_COMPACT_RAW], cost->encoded_size[LED_COMPACT_RLE]);
+    }
+
+    // even a single color palette would not be smaller
+    if (sizeof(Led_Compact::led_compact_t) + sizeof(Led_Strip::led_color_t) + get_index_size(led_count, 1) >= palette_limit)
+    {
+        return;
+    }
+
+    memset(palette->keys, 0, sizeof(palette->keys));
+    palette->incomplete = false;
+    previous_key = 0;
+
+    for (uint32_t i = 0; i < led_count; i++)
+    {
+        key = get_color_key(led_colors[i]);
+
+        // colors repeated within a run need no lookup
+        if (key == previous_key)
+        {
+            continue;
+        }
+
+        previous_key = key;
+        palette_size = palette->size;
+        if (lookup_palette(palette, key) < 0)
+        {
+            return;
+        }
+
+        // each new color adds to the palette and may widen the indexes
+        if (palette->size != palette_size
+                && sizeof(Led_Compact::led_compact_t) + ((size_t)palette->size * sizeof(Led_Strip::led_color_t))
+                + get_index_size(led_count, get_index_bits(palette->size)) >= palette_limit)
+        {
+            palette->incomplete = true;
+            return;
+        }
+    }
+
+    cost->index_bits = get_index_bits(palette->size);
+    cost->encoded_size[LED_COMPACT_PALETTE] = sizeof(Led_Compact::led_compact_t)
+        + ((size_t)palette->size * sizeof(Led_Strip::led_color_t)) + get_index_size(led_count, cost->index_bits);
+}
+
+// the cheapest encoding - ties go to the one cheaper to decode (raw, then rle)
+static led_compact_encoding_t get_cheapest(const led_compact_cost_t &cost)
+{
+    led_compact_encoding_t encoding = LED_COMPACT_RAW;
+
+    for (int i = LED_COMPACT_RAW + 1; i < LED_COMPACT_COUNT; i++)
+    {
+        if (cost.encoded_size[i] < cost.encoded_size[encoding])
+        {
+            encoding = (led_compact_encoding_t)i;
+        }
+    }
+
+    return encoding;
+}
+
+static size_t encode_encoding(led_compact_encoding_t encoding, const Led_Strip::led_color_t *led_colors, uint32_t led_count,
+        led_palette_table_t *palette, const led_compact_cost_t &cost, uint8_t *buffer, size_t buffer_size)
+{
+    Led_Compact::led_compact_t *compact = reinterpret_cast<Led_Compact::led_compact_t*>(buffer);
+    size_t encoded_size = cost.encoded_size[encoding];
+
+    if (encoding == LED_COMPACT_PALETTE && palette->incomplete)
+    {
+        std::ostringstream err_str;
+
+        err_str << "frame has more than " << LED_COMPACT_MAX_PALETTE << " colors, palette encoding not possible";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (buffer_size < encoded_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "compact buffer too small - " << buffer_size << " bytes (need " << encoded_size << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    compact->compact_led_count = htonl(led_count);
+    compact->compact_encoding = (uint8_t)encoding;
+    compact->compact_index_bits = 0;
+    compact->compact_palette_size = 0;
+
+    if (encoding == LED_COMPACT_RAW)
+    {
+        memcpy(compact->compact_data, led_colors, (size_t)led_count * sizeof(Led_Strip::led_color_t));
+    }
+    else if (encoding == LED_COMPACT_RLE)
+    {
+        Led_Compact::led_run_t *run = reinterpret_cast<Led_Compact::led_run_t*>(compact->compact_data);
+        uint32_t run_start = 0;
+        uint32_t run_end;
+        uint32_t run_length;
+
+        while (run_start < led_count)
+        {
+            run_end = find_run_end(led_colors, led_count, run_start) + 1;
+            for (; run_start < run_end; run_start += run_length)
+            {
+                run_length = std::min(run_end - run_start, (uint32_t)LED_COMPACT_MAX_RUN);
+                run->run_length = (uint8_t)(run_length - 1);
+                run->run_color = led_colors[run_start];
+                run++;
+            }
+        }
+    }
+    else
+    {
+        Led_Strip::led_color_t *palette_colors = reinterpret_cast<Led_Strip::led_color_t*>(compact->compact_data);
+        uint8_t *indexes = &compact->compact_data[palette->size * sizeof(Led_Strip::led_color_t)];
+        uint32_t index_bits = cost.index_bits;
+        uint32_t key;
+        uint32_t previous_key = 0;
+        uint32_t index = 0;
+        size_t bit_offset;
+
+        compact->compact_index_bits = (uint8_t)index_bits;
+        compact->compact_palette_size = htons((uint16_t)palette->size);
+
+        for (uint32_t i = 0; i < palette->size; i++)
+        {
+            palette_colors[i].red = (uint8_t)(palette->colors[i] >> 16);
+            palette_colors[i].green = (uint8_t)(palette->colors[i] >> 8);
+            palette_colors[i].blue = (uint8_t)palette->colors[i];
+        }
+
+        memset(indexes, 0, get_index_size(led_count, index_bits));
+        for (uint32_t i = 0; i < led_count; i++)
+        {
+            key = get_color_key(led_colors[i]);
+            if (key != previous_key)
+            {
+                index = (uint32_t)lookup_palette(palette, key);
+                previous_key = key;
+            }
+
+            // index_bits divides 8, an index never straddles two bytes
+            bit_offset = (size_t)i * index_bits;
+            indexes[bit_offset / 8] |= (uint8_t)(index << (bit_offset % 8));
+        }
+    }
+
+    return encoded_size;
+}
+
+
+led_compact_encoding_t Led_Compact::choose_encoding(const Led_Strip::led_color_t *led_colors, uint32_t led_count, size_t *encoded_size)
+{
+    led_palette_table_t palette;
+    led_compact_cost_t cost;
+    led_compact_encoding_t encoding;
+
+    get_costs(led_colors, led_count, false, &palette, &cost);
+    encoding = get_cheapest(cost);
+
+    if (encoded_size != nullptr)
+    {
+        *encoded_size = cost.encoded_size[encoding];
+    }
+
+    return encoding;
+}
+
+size_t Led_Compact::encode_into(const Led_Strip::led_color_t *led_colors, uint32_t led_count, uint8_t *buffer, size_t buffer_size)
+{
+    led_palette_table_t palette;
+    led_compact_cost_t cost;
+
+    get_costs(led_colors, led_count, false, &palette, &cost);
+
+    return encode_encoding(get_cheapest(cost), led_colors, led_count, &palette, cost, buffer, buffer_size);
+}
+
+size_t Led_Compact::encode_into(led_compact_encoding_t encoding, const Led_Strip::led_color_t *led_colors, uint32_t led_count,
+        uint8_t *buffer, size_t buffer_size)
+{
+    led_palette_table_t palette;
+    led_compact_cost_t cost;
+
+    if (encoding >= LED_COMPACT_COUNT)
+    {
+        std::ostringstream err_str;
+
+        err_str << "unknown compact encoding " << (int)encoding;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    get_costs(led_colors, led_count, encoding == LED_COMPACT_PALETTE, &palette, &cost);
+
+    return encode_encoding(encoding, led_colors, led_count, &palette, cost, buffer, buffer_size);
+}
+
+uint32_t Led_Compact::validate(const uint8_t *compact, size_t compact_size)
+{
+    const led_compact_t *compact_header = reinterpret_cast<const led_compact_t*>(compact);
+    uint32_t led_count;
+    size_t data_size;
+    size_t expected_size = 0;
+
+    if (compact_size < sizeof(led_compact_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "compact frame too small, received " << compact_size << " bytes (expected at least " << sizeof(led_compact_t) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    led_count = ntohl(compact_header->compact_led_count);
+    data_size = compact_size - sizeof(led_compact_t);
+
+    if (compact_header->compact_encoding == LED_COMPACT_RAW)
+    {
+        expected_size = (size_t)led_count * sizeof(Led_Strip::led_color_t);
+    }
+    else if (compact_header->compact_encoding == LED_COMPACT_RLE)
+    {
+        const led_run_t *runs = reinterpret_cast<const led_run_t*>(compact_header->compact_data);
+        size_t covered_count = 0;
+
+        if ((data_size % sizeof(led_run_t)) != 0)
+        {
+            std::ostringstream err_str;
+
+            err_str << "compact rle frame truncated, " << (data_size % sizeof(led_run_t)) << " bytes after the last run";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        for (size_t i = 0; i < (data_size / sizeof(led_run_t)); i++)
+        {
+            covered_count += (size_t)runs[i].run_length + 1;
+        }
+
+        if (covered_count != led_count)
+        {
+            std::ostringstream err_str;
+
+            err_str << "compact rle runs cover " << covered_count << " leds (frame has " << led_count << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        expected_size = data_size;
+    }
+    else if (compact_header->compact_encoding == LED_COMPACT_PALETTE)
+    {
+        uint32_t palette_size = ntohs(compact_header->compact_palette_size);
+        uint32_t index_bits = compact_header->compact_index_bits;
+        const uint8_t *indexes = &compact_header->compact_data[palette_size * sizeof(Led_Strip::led_color_t)];
+        size_t bit_offset;
+
+        if (palette_size == 0 || palette_size > LED_COMPACT_MAX_PALETTE
+                || (index_bits != 1 && index_bits != 2 && index_bits != 4 && index_bits != 8) || (1u << index_bits) < palette_size)
+        {
+            std::ostringstream err_str;
+
+            err_str << "compact palette of " << palette_size << " colors with " << index_bits << " bit indexes is invalid";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        expected_size = ((size_t)palette_size * sizeof(Led_Strip::led_color_t)) + get_index_size(led_count, index_bits);
+
+        // a full palette leaves no index out of range
+        if (expected_size == data_size && (1u << index_bits) != palette_size)
+        {
+            for (uint32_t i = 0; i < led_count; i++)
+            {
+                bit_offset = (size_t)i * index_bits;
+                if (((indexes[bit_offset / 8] >> (bit_offset % 8)) & ((1u << index_bits) - 1)) >= palette_size)
+                {
+                    std::ostringstream err_str;
+
+                    err_str << "compact palette index of led " << i << " out of range (" << palette_size << " colors)";
+                    dbg_error("%s", err_str.str().c_str());
+                    throw std::runtime_error(err_str.str());
+                }
+            }
+        }
+    }
+    else
+    {
+        std::ostringstream err_str;
+
+        err_str << "unknown compact encoding " << (int)compact_header->compact_encoding;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (data_size != expected_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "compact frame size did not match, received " << compact_size << " bytes (expected "
+            << (sizeof(led_compact_t) + expected_size) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return led_count;
+}
+
+uint32_t Led_Compact::decode_into(const uint8_t *compact, size_t compact_size, Led_Strip::led_color_t *led_colors, uint32_t max_led_count)
+{
+    const led_compact_t *compact_header = reinterpret_cast<const led_compact_t*>(compact);
+    uint32_t led_count = validate(compact, compact_size);
+
+    if (led_count > max_led_count)
+    {
+        std::ostringstream err_str;
+
+        err_str << "compact frame has " << led_count << " leds, room for " << max_led_count;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (compact_header->compact_encoding == LED_COMPACT_RAW)
+    {
+        memcpy(led_colors, compact_header->compact_data, (size_t)led_count * sizeof(Led_Strip::led_color_t));
+    }
+    else if (compact_header->compact_encoding == LED_COMPACT_RLE)
+    {
+        const led_run_t *run = reinterpret_cast<const led_run_t*>(compact_header->compact_data);
+        uint32_t i = 0;
+        uint32_t run_end;
+
+        while (i < led_count)
+        {
+            run_end = i + run->run_length + 1;
+            for (; i < run_end; i++)
+            {
+                led_colors[i] = run->run_color;
+            }
+
+            run++;
+        }
+    }
+    else
+    {
+        const Led_Strip::led_color_t *palette_colors = reinterpret_cast<const Led_Strip::led_color_t*>(compact_header->compact_data);
+        uint32_t palette_size = ntohs(compact_header->compact_palette_size);
+        uint32_t index_bits = compact_header->compact_index_bits;
+        uint32_t index_mask = (1u << index_bits) - 1;
+        const uint8_t *indexes = &compact_header->compact_data[palette_size * sizeof(Led_Strip::led_color_t)];
+        size_t bit_offset;
+
+        for (uint32_t i = 0; i < led_count; i++)
+        {
+            bit_offset = (size_t)i * index_bits;
+            led_colors[i] = palette_colors[(indexes[bit_offset / 8] >> (bit_offset % 8)) & index_mask];
+        }
+    }
+
+    return led_count;
+}
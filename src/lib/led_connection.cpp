@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "debug.h"
+#include "led.h"
+#include "led_codec.h"
+#include "led_network.h"
+#include "led_connection.h"
+
+
+Led_Connection::Led_Connection(int fd_arg, Led_Frame_Pool &frame_pool)
+    : fd(fd_arg)
+    , receive_buffer(frame_pool.acquire())
+    , receive_length(0)
+    , receive_offset(0)
+    , send_offset(0)
+    , deferred_send(false)
+    , send_in_flight(false)
+    , inflight_offset(0)
+    , last_activity(std::chrono::steady_clock::now())
+    , delta_base_sequence(0)
+    , delta_base_valid(false)
+    , timeline_valid(false)
+    , stream_header_size(0)
+    , stream_size(0)
+    , stream_received(0)
+    , streaming(false)
+{
+}
+
+Led_Connection::~Led_Connection()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+int Led_Connection::get_fd()
+{
+    return fd;
+}
+
+bool Led_Connection::receive_available()
+{
+    uint8_t *receive_ptr;
+    size_t receive_space;
+    ssize_t bytes_recv;
+
+    compact_receive_buffer();
+
+    // leave remaining data in the socket once the buffer is full, the level triggered event
+    // loop reports it again after the buffered messages were handled
+    while ((receive_space = get_receive_space(&receive_ptr)) > 0)
+    {
+        bytes_recv = recv(fd, receive_ptr, receive_space, 0);
+        if (bytes_recv == 0)
+        {
+            // peer closed connection
+            return false;
+        }
+
+        if (bytes_recv < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // everything available was read
+                return true;
+            }
+
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream err_str;
+
+            err_str << "Led_Connection failed to receive on " << fd << ": " << strerror(errno) << " (" << errno << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        add_received(bytes_recv);
+    }
+
+    return true;
+}
+
+size_t Led_Connection::get_receive_space(uint8_t **receive_ptr)
+{
+    // the colors of a streamed frame go straight into the session strip, following messages into the buffer
+    if (streaming && stream_received < stream_size)
+    {
+        *receive_ptr = reinterpret_cast<uint8_t*>(delta_base.data()) + stream_received;
+        return stream_size - stream_received;
+    }
+
+    *receive_ptr = receive_buffer.data() + receive_length;
+
+    return receive_buffer.capacity() - receive_length;
+}
+
+void Led_Connection::add_received(size_t size)
+{
+    if (streaming && stream_received < stream_size)
+    {
+        stream_received += size;
+    }
+    else
+    {
+        receive_length += size;
+    }
+    last_activity = std::chrono::steady_clock::now();
+}
+
+bool Led_Connection::peek_message(const uint8_t **message, size_t *message_size)
+{
+    size_t buffered_length = receive_length - receive_offset;
+
+    // wait for complete header, and for a streamed frame to be consumed
+    if (buffered_length < LED_HEADER_SIZE || streaming)
+    {
+        return false;
+    }
+
+    // validates header, throws on invalid message
+    *message_size = Led_Network::get_message_size(receive_buffer.data() + receive_offset);
+    if (*message_size > receive_buffer.capacity())
+    {
+        start_stream(*message_size);
+        return false;
+    }
+
+    if (buffered_length < *message_size)
+    {
+        return false;
+    }
+
+    *message = receive_buffer.data() + receive_offset;
+
+    return true;
+}
+
+void Led_Connection::consume_message(size_t message_size)
+{
+    // following (pipelined) messages are read in place, nothing is moved
+    receive_offset += message_size;
+    if (receive_offset >= receive_length)
+    {
+        receive_offset = 0;
+        receive_length = 0;
+    }
+}
+
+bool Led_Connection::start_stream(size_t message_size)
+{
+    const uint8_t *message = receive_buffer.data() + receive_offset;
+    size_t buffered_length = receive_length - receive_offset;
+    size_t header_size = sizeof(Led_Strip::led_net_t);
+    Led_Codec::led_frame_view_t view;
+
+    // only plain frames are streamed, anything else has to fit the buffer
+    if (Led_Message::is_message(message))
+    {
+        if (buffered_length < LED_MSG_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        if (reinterpret_cast<const Led_Message::led_msg_t*>(message)->msg_type != LED_MSG_TYPE_FRAME)
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Connection received a " << message_size << " byte message of type "
+                << (int)reinterpret_cast<const Led_Message::led_msg_t*>(message)->msg_type
+                << " (maximum " << receive_buffer.capacity() << " bytes unless it is a frame)";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+        header_size += LED_MSG_HEADER_SIZE;
+    }
+
+    if (buffered_length < header_size)
+    {
+        return false;
+    }
+
+    // magic, led count limit and size are checked before any color arrives, throws on an invalid frame
+    view = Led_Codec::decode_view(message + header_size - sizeof(Led_Strip::led_net_t), message_size - header_size + sizeof(Led_Strip::led_net_t));
+
+    memcpy(stream_header, message, header_size);
+    stream_header_size = header_size;
+    stream_size = view.led_count * sizeof(Led_Strip::led_color_t);
+
+    // the session strip is overwritten, it is no delta base until the frame is complete
+    delta_base_valid = false;
+    delta_base.resize(view.led_count);
+
+    // the message is larger than the buffer, so everything buffered after its headers belongs to it
+    stream_received = buffered_length - header_size;
+    memcpy(delta_base.data(), message + header_size, stream_received);
+    receive_offset = 0;
+    receive_length = 0;
+    streaming = true;
+
+    dbg_notice("Led_Connection %d streaming a frame of %u leds", fd, view.led_count);
+
+    return true;
+}
+
+bool Led_Connection::peek_stream(const uint8_t **header, size_t *header_size, const Led_Strip::led_color_t **led_colors, uint32_t *led_count)
+{
+    if (!streaming || stream_received < stream_size)
+    {
+        return false;
+    }
+
+    *header = stream_header;
+    *header_size = stream_header_size;
+    *led_colors = delta_base.data();
+    *led_count = delta_base.size();
+
+    return true;
+}
+
+void Led_Connection::consume_stream()
+{
+    streaming = false;
+    stream_size = 0;
+    stream_received = 0;
+}
+
+void Led_Connection::compact_receive_buffer()
+{
+    // only the tail of a partial message is ever moved to the front
+    if (receive_offset > 0)
+    {
+        receive_length -= receive_offset;
+        memmove(receive_buffer.data(), receive_buffer.data() + receive_offset, receive_length);
+        receive_offset = 0;
+    }
+}
+
+void Led_Connection::queue_send(const std::vector<uint8_t> &data)
+{
+    queue_send(data.data(), data.size());
+}
+
+void Led_Connection::queue_send(const uint8_t *data, size_t size)
+{
+    send_buffer.insert(send_buffer.end(), data, data + size);
+
+    // written once the event loop submits it
+    if (!deferred_send)
+    {
+        send_pending();
+    }
+}
+
+void Led_Connection::send_pending()
+{
+    ssize_t bytes_sent;
+
+    while (send_offset < send_buffer.size())
+    {
+        // MSG_NOSIGNAL - a client closing early must not raise SIGPIPE in the server
+        bytes_sent = send(fd, &send_buffer[send_offset], send_buffer.size() - send_offset, MSG_NOSIGNAL);
+        if (bytes_sent < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // wait for socket to become writable
+                return;
+            }
+
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream err_str;
+
+            err_str << "Led_Connection failed to send on " << fd << ": " << strerror(errno) << " (" << errno << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        send_offset += bytes_sent;
+        last_activity = std::chrono::steady_clock::now();
+    }
+
+    // everything sent - reuse buffer
+    send_buffer.clear();
+    send_offset = 0;
+}
+
+bool Led_Connection::has_pending_send()
+{
+    return (send_offset < send_buffer.size() || inflight_offset < inflight_buffer.size());
+}
+
+bool Led_Connection::is_send_backlogged()
+{
+    return ((send_buffer.size() - send_offset) + (inflight_buffer.size() - inflight_offset) > LED_CONNECTION_SEND_LIMIT);
+}
+
+size_t Led_Connection::append_received(const uint8_t *data, size_t size)
+{
+    uint8_t *receive_ptr;
+    size_t receive_space;
+    size_t append_size = 0;
+
+    compact_receive_buffer();
+
+    // a partial message never exceeds the buffer (larger frames are streamed), so consuming complete messages always frees space
+    while (append_size < size && (receive_space = get_receive_space(&receive_ptr)) > 0)
+    {
+        receive_space = std::min(size - append_size, receive_space);
+        memcpy(receive_ptr, data + append_size, receive_space);
+        add_received(receive_space);
+        append_size += receive_space;
+    }
+
+    return append_size;
+}
+
+void Led_Connection::set_deferred_send(bool deferred)
+{
+    deferred_send = deferred;
+}
+
+bool Led_Connection::start_send(const uint8_t **data, size_t *size)
+{
+    // one send at a time, responses queued meanwhile go out with the next one
+    if (send_in_flight)
+    {
+        return false;
+    }
+
+    // previous block completed - take everything queued since
+    if (inflight_offset == inflight_buffer.size())
+    {
+        if (send_buffer.empty())
+        {
+            return false;
+        }
+
+        inflight_buffer.swap(send_buffer);
+        inflight_offset = 0;
+        send_buffer.clear();
+    }
+
+    *data = &inflight_buffer[inflight_offset];
+    *size = inflight_buffer.size() - inflight_offset;
+    send_in_flight = true;
+
+    return true;
+}
+
+void Led_Connection::complete_send(size_t bytes_sent)
+{
+    send_in_flight = false;
+    inflight_offset += bytes_sent;
+    last_activity = std::chrono::steady_clock::now();
+
+    // everything sent - reuse buffer
+    if (inflight_offset >= inflight_buffer.size())
+    {
+        inflight_buffer.clear();
+        inflight_offset = 0;
+    }
+}
+
+void Led_Connection::set_delta_base(uint32_t sequence, const Led_Strip::led_color_t *led_colors, uint32_t led_count)
+{
+    // storage is reused once it reached the strip size
+    if (led_colors != delta_base.data())
+    {
+        delta_base.assign(led_colors, led_colors + led_count);
+    }
+    delta_base_sequence = sequence;
+    delta_base_valid = true;
+}
+
+Led_Strip::led_color_t *Led_Connection::get_delta_base(uint32_t sequence, uint32_t *led_count)
+{
+    if (!delta_base_valid || sequence != delta_base_sequence)
+    {
+        return nullptr;
+    }
+
+    *led_count = delta_base.size();
+
+    return delta_base.data();
+}
+
+void Led_Connection::clear_delta_base()
+{
+    delta_base_valid = false;
+}
+
+void Led_Connection::set_timeline_start(const std::chrono::steady_clock::time_point &start_time)
+{
+    timeline_start = start_time;
+    timeline_valid = true;
+}
+
+bool Led_Connection::get_timeline_start(std::chrono::steady_clock::time_point *start_time)
+{
+    if (!timeline_valid)
+    {
+        return false;
+    }
+
+    *start_time = timeline_start;
+
+    return true;
+}
+
+std::chrono::steady_clock::time_point Led_Connection::get_deadline()
+{
+    // in the middle of a message or response
+    if (receive_length > receive_offset || (streaming && stream_received < stream_size) || has_pending_send())
+    {
+        return last_activity + std::chrono::milliseconds(LED_MESSAGE_TIMEOUT_MS);
+    }
+
+    // waiting for the next message of a streaming session
+    return last_activity + std::chrono::milliseconds(LED_SESSION_IDLE_TIMEOUT_MS);
+}
+
+bool Led_Connection::check_timeout(const std::chrono::steady_clock::time_point &now)
+{
+    return (now >= get_deadline());
+}
@@ -0,0 +1,221 @@
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "debug.h"
+#include "led_codec.h"
+#include "led_delta.h"
+
+// compiled to SSE2 on x86 and NEON on ARM, no intrinsics needed
+typedef uint8_t led_delta_block_t __attribute__((vector_size(LED_DELTA_BLOCK_SIZE)));
+
+
+size_t Led_Delta::find_difference(const uint8_t *base, const uint8_t *frame, size_t offset, size_t size)
+{
+    led_delta_block_t base_block;
+    led_delta_block_t frame_block;
+    led_delta_block_t diff_block;
+    uint64_t diff_lanes[LED_DELTA_BLOCK_SIZE / sizeof(uint64_t)];
+    uint64_t diff;
+
+    // whole blocks - one xor per block, the lanes are only tested for zero
+    while (offset + LED_DELTA_BLOCK_SIZE <= size)
+    {
+        // unaligned loads, strips are not aligned to the block size
+        memcpy(&base_block, &base[offset], LED_DELTA_BLOCK_SIZE);
+        memcpy(&frame_block, &frame[offset], LED_DELTA_BLOCK_SIZE);
+        diff_block = base_block ^ frame_block;
+        memcpy(diff_lanes, &diff_block, LED_DELTA_BLOCK_SIZE);
+
+        diff = 0;
+        for (size_t i = 0; i < (LED_DELTA_BLOCK_SIZE / sizeof(uint64_t)); i++)
+        {
+            diff |= diff_lanes[i];
+        }
+
+        if (diff != 0)
+        {
+            break;
+        }
+
+        offset += LED_DELTA_BLOCK_SIZE;
+    }
+
+    // locate the byte inside the changed block, or check the tail shorter than a block
+    while (offset < size && base[offset] == frame[offset])
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+size_t Led_Delta::encode_into(uint32_t base_sequence, const Led_Strip::led_color_t *base_colors, const Led_Strip::led_color_t *led_colors,
+        uint32_t led_count, uint8_t *buffer, size_t buffer_size)
+{
+    led_delta_t *delta = reinterpret_cast<led_delta_t*>(buffer);
+    const uint8_t *base_bytes = reinterpret_cast<const uint8_t*>(base_colors);
+    const uint8_t *frame_bytes = reinterpret_cast<const uint8_t*>(led_colors);
+    size_t byte_count = (size_t)led_count * sizeof(Led_Strip::led_color_t);
+    size_t frame_size = Led_Codec::get_frame_size(led_count);
+    size_t delta_size = sizeof(led_delta_t);
+    size_t span_size;
+    uint32_t span_count = 0;
+    uint32_t start;
+    uint32_t end = 0;
+    uint32_t next;
+
+    if (buffer_size < delta_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "delta buffer too small - " << buffer_size << " bytes (need at least " << delta_size << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    while (true)
+    {
+        start = find_difference(base_bytes, frame_bytes, (size_t)end * sizeof(Led_Strip::led_color_t), byte_count) / sizeof(Led_Strip::led_color_t);
+        if (start >= led_count)
+        {
+            break;
+        }
+
+        // extend the span over changed leds, and over unchanged gaps shorter than a span header
+        end = start + 1;
+        while (end < led_count)
+        {
+            if (memcmp(&base_colors[end], &led_colors[end], sizeof(Led_Strip::led_color_t)) != 0)
+            {
+                end++;
+                continue;
+            }
+
+            next = find_difference(base_bytes, frame_bytes, (size_t)end * sizeof(Led_Strip::led_color_t), byte_count) / sizeof(Led_Strip::led_color_t);
+            if (next >= led_count || (next - end) > LED_DELTA_MERGE_GAP)
+            {
+                break;
+            }
+
+            end = next + 1;
+        }
+
+        // a keyframe is sent instead once the delta is not smaller
+        span_size = sizeof(led_span_t) + ((size_t)(end - start) * sizeof(Led_Strip::led_color_t));
+        if (delta_size + span_size >= frame_size || delta_size + span_size > buffer_size)
+        {
+            return 0;
+        }
+
+        led_span_t *span = reinterpret_cast<led_span_t*>(&buffer[delta_size]);
+        span->span_start = htonl(start);
+        span->span_length = htonl(end - start);
+        memcpy(span->span_colors, &led_colors[start], (size_t)(end - start) * sizeof(Led_Strip::led_color_t));
+
+        delta_size += span_size;
+        span_count++;
+    }
+
+    // an unchanged strip is still worth sending as an empty delta
+    if (delta_size >= frame_size)
+    {
+        return 0;
+    }
+
+    delta->delta_base_sequence = htonl(base_sequence);
+    delta->delta_led_count = htonl(led_count);
+    delta->delta_span_count = htonl(span_count);
+
+    return delta_size;
+}
+
+uint32_t Led_Delta::get_base_sequence(const uint8_t *delta, size_t delta_size)
+{
+    if (delta_size < sizeof(led_delta_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "delta frame too small, received " << delta_size << " bytes (expected at least " << sizeof(led_delta_t) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return ntohl(reinterpret_cast<const led_delta_t*>(delta)->delta_base_sequence);
+}
+
+void Led_Delta::apply(const uint8_t *delta, size_t delta_size, Led_Strip::led_color_t *base_colors, uint32_t led_count)
+{
+    const led_delta_t *delta_header = reinterpret_cast<const led_delta_t*>(delta);
+    const led_span_t *span;
+    uint32_t span_count;
+    uint32_t start;
+    uint32_t length;
+    size_t offset;
+
+    // also checks the minimum size
+    get_base_sequence(delta, delta_size);
+
+    if (ntohl(delta_header->delta_led_count) != led_count)
+    {
+        std::ostringstream err_str;
+
+        err_str << "delta frame led count " << ntohl(delta_header->delta_led_count) << " does not match base frame (" << led_count << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // validate every span first, a bad delta leaves the base untouched
+    span_count = ntohl(delta_header->delta_span_count);
+    offset = sizeof(led_delta_t);
+    for (uint32_t i = 0; i < span_count; i++)
+    {
+        if (delta_size - offset < sizeof(led_span_t))
+        {
+            std::ostringstream err_str;
+
+            err_str << "delta frame truncated in span " << i << " of " << span_count;
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        span = reinterpret_cast<const led_span_t*>(&delta[offset]);
+        start = ntohl(span->span_start);
+        length = ntohl(span->span_length);
+        offset += sizeof(led_span_t);
+
+        if (start > led_count || length > (led_count - start)
+                || (delta_size - offset) < ((size_t)length * sizeof(Led_Strip::led_color_t)))
+        {
+            std::ostringstream err_str;
+
+            err_str << "delta span " << start << "+" << length << " out of range (" << led_count << " leds, "
+                << (delta_size - offset) << " bytes remaining)";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        offset += (size_t)length * sizeof(Led_Strip::led_color_t);
+    }
+
+    if (offset != delta_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "delta frame size did not match, " << (delta_size - offset) << " bytes after the last span";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    offset = sizeof(led_delta_t);
+    for (uint32_t i = 0; i < span_count; i++)
+    {
+        span = reinterpret_cast<const led_span_t*>(&delta[offset]);
+        start = ntohl(span->span_start);
+        length = ntohl(span->span_length);
+
+        memcpy(&base_colors[start], span->span_colors, (size_t)length * sizeof(Led_Strip::led_color_t));
+        offset += sizeof(led_span_t) + ((size_t)length * sizeof(Led_Strip::led_color_t));
+    }
+}
@@ -0,0 +1,141 @@
+#include "debug.h"
+#include "led_dispatch_pool.h"
+
+
+Led_Dispatch_Pool::Led_Dispatch_Pool(size_t worker_count)
+    : batch_task(nullptr)
+    , batch_task_count(0)
+    , next_task(0)
+    , busy_count(0)
+    , batch_generation(0)
+    , stopping(false)
+{
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        workers.push_back(std::thread(&Led_Dispatch_Pool::run_worker, this));
+    }
+
+    dbg_notice("started %zu dispatch workers", worker_count);
+}
+
+Led_Dispatch_Pool::~Led_Dispatch_Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex);
+
+        stopping = true;
+    }
+    work_ready.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+size_t Led_Dispatch_Pool::get_worker_count()
+{
+    return workers.size();
+}
+
+void Led_Dispatch_Pool::run(size_t task_count, const std::function<void(size_t)> &task)
+{
+    std::exception_ptr error;
+
+    if (task_count == 0)
+    {
+        return;
+    }
+
+    // a single task or no workers - nothing to hand out
+    if (task_count == 1 || workers.empty())
+    {
+        for (size_t i = 0; i < task_count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex);
+
+        batch_task = &task;
+        batch_task_count = task_count;
+        next_task.store(0);
+        busy_count = workers.size();
+        batch_error = nullptr;
+        batch_generation++;
+    }
+    work_ready.notify_all();
+
+    // the caller takes tasks as well instead of only waiting
+    run_tasks();
+
+    {
+        std::unique_lock<std::mutex> lock(dispatch_mutex);
+
+        work_done.wait(lock, [this] { return busy_count == 0; });
+        batch_task = nullptr;
+        error = batch_error;
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void Led_Dispatch_Pool::run_worker()
+{
+    uint64_t seen_generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(dispatch_mutex);
+
+            work_ready.wait(lock, [&] { return stopping || batch_generation != seen_generation; });
+            if (stopping)
+            {
+                return;
+            }
+            seen_generation = batch_generation;
+        }
+
+        run_tasks();
+
+        {
+            std::lock_guard<std::mutex> lock(dispatch_mutex);
+
+            busy_count--;
+            if (busy_count == 0)
+            {
+                work_done.notify_one();
+            }
+        }
+    }
+}
+
+void Led_Dispatch_Pool::run_tasks()
+{
+    size_t task_index;
+
+    // tasks are claimed one at a time, a slow task does not hold up the others
+    while ((task_index = next_task.fetch_add(1)) < batch_task_count)
+    {
+        try
+        {
+            (*batch_task)(task_index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(dispatch_mutex);
+
+            if (!batch_error)
+            {
+                batch_error = std::current_exception();
+            }
+        }
+    }
+}
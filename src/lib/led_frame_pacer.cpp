@@ -0,0 +1,201 @@
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "debug.h"
+#include "share.h"
+#include "led_frame_pacer.h"
+
+
+static const uint32_t lateness_bucket_us[LED_PACER_LATENESS_BUCKETS] = {50, 100, 200, 500, 1000, 2000, 5000, UINT32_MAX};
+
+static uint64_t timespec_to_ns(const struct timespec &time)
+{
+    return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+Led_Frame_Pacer::Led_Frame_Pacer(uint32_t refresh_rate)
+    : refresh_rate(refresh_rate)
+    , period_ns(0)
+    , timer_fd(-1)
+    , wake_fd(-1)
+    , armed(false)
+    , expiration_count(0)
+    , first_tick()
+    , stopping(false)
+    , stats()
+{
+    if (refresh_rate < 1 || refresh_rate > get_max_refresh_rate())
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Frame_Pacer refresh rate " << refresh_rate << " out of range (1-" << get_max_refresh_rate()
+                << " for " << WS2812_LED_COUNT << " leds)";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+    period_ns = 1000000000ULL / refresh_rate;
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (timer_fd < 0 || wake_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Frame_Pacer failed to create timer: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        if (timer_fd >= 0)
+        {
+            close(timer_fd);
+        }
+        if (wake_fd >= 0)
+        {
+            close(wake_fd);
+        }
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+Led_Frame_Pacer::~Led_Frame_Pacer()
+{
+    close(timer_fd);
+    close(wake_fd);
+}
+
+uint32_t Led_Frame_Pacer::get_max_refresh_rate()
+{
+    return 1000000 / WS2812_FRAME_US;
+}
+
+uint32_t Led_Frame_Pacer::get_lateness_bucket_us(int bucket)
+{
+    if (bucket < 0 || bucket >= LED_PACER_LATENESS_BUCKETS)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Frame_Pacer lateness bucket " << bucket << " out of range (0-" << (LED_PACER_LATENESS_BUCKETS - 1) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    return lateness_bucket_us[bucket];
+}
+
+uint32_t Led_Frame_Pacer::get_refresh_rate()
+{
+    return refresh_rate;
+}
+
+void Led_Frame_Pacer::arm_timer()
+{
+    struct itimerspec timer_spec = {};
+    uint64_t first_ns;
+
+    // absolute schedule - tick n is due at first_tick + n periods whenever it is handled
+    clock_gettime(CLOCK_MONOTONIC, &first_tick);
+    first_ns = timespec_to_ns(first_tick) + period_ns;
+    first_tick.tv_sec = first_ns / 1000000000ULL;
+    first_tick.tv_nsec = first_ns % 1000000000ULL;
+
+    timer_spec.it_value = first_tick;
+    timer_spec.it_interval.tv_sec = period_ns / 1000000000ULL;
+    timer_spec.it_interval.tv_nsec = period_ns % 1000000000ULL;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_spec, nullptr) < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Frame_Pacer failed to arm timer: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+    armed = true;
+}
+
+void Led_Frame_Pacer::add_tick(uint64_t expirations)
+{
+    struct timespec now;
+    uint64_t due_ns;
+    uint64_t now_ns;
+    uint32_t lateness_us;
+    int bucket;
+
+    // lateness of the newest expired tick
+    expiration_count += expirations;
+    due_ns = timespec_to_ns(first_tick) + (expiration_count - 1) * period_ns;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_ns = timespec_to_ns(now);
+    lateness_us = (now_ns > due_ns) ? (now_ns - due_ns) / 1000 : 0;
+
+    for (bucket = 0; lateness_us > lateness_bucket_us[bucket]; bucket++)
+    {
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    stats.tick_count++;
+    stats.missed_tick_count += expirations - 1;
+    stats.lateness_us_max = std::max(stats.lateness_us_max, lateness_us);
+    stats.lateness_histogram[bucket]++;
+}
+
+bool Led_Frame_Pacer::wait_tick()
+{
+    struct pollfd poll_fds[2] = {{timer_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+    uint64_t expirations;
+
+    if (!armed)
+    {
+        arm_timer();
+    }
+
+    while (!stopping.load())
+    {
+        if (poll(poll_fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream err_str;
+
+            err_str << "Led_Frame_Pacer failed to wait for tick: " << strerror(errno) << " (" << errno << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        // the count of expirations since the last read, more than one means ticks were missed
+        if ((poll_fds[0].revents & POLLIN) && read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+        {
+            add_tick(expirations);
+            return !stopping.load();
+        }
+    }
+
+    return false;
+}
+
+void Led_Frame_Pacer::stop()
+{
+    uint64_t wake_value = 1;
+
+    stopping.store(true);
+    if (write(wake_fd, &wake_value, sizeof(wake_value)) < 0)
+    {
+        dbg_error("Led_Frame_Pacer failed to wake waiting thread: %s (%d)", strerror(errno), errno);
+    }
+}
+
+Led_Frame_Pacer::led_pacer_stats_t Led_Frame_Pacer::get_stats()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    return stats;
+}
@@ -0,0 +1,147 @@
+#include "debug.h"
+#include "led_frame_pool.h"
+
+
+Led_Frame_Pool::Buffer::Buffer()
+    : pool(nullptr)
+    , buffer(nullptr)
+    , pooled(false)
+{
+}
+
+Led_Frame_Pool::Buffer::Buffer(Buffer &&other)
+    : pool(other.pool)
+    , buffer(other.buffer)
+    , pooled(other.pooled)
+{
+    other.pool = nullptr;
+    other.buffer = nullptr;
+    other.pooled = false;
+}
+
+Led_Frame_Pool::Buffer& Led_Frame_Pool::Buffer::operator=(Buffer &&other)
+{
+    if (this != &other)
+    {
+        release();
+
+        pool = other.pool;
+        buffer = other.buffer;
+        pooled = other.pooled;
+
+        other.pool = nullptr;
+        other.buffer = nullptr;
+        other.pooled = false;
+    }
+
+    return *this;
+}
+
+Led_Frame_Pool::Buffer::~Buffer()
+{
+    release();
+}
+
+uint8_t *Led_Frame_Pool::Buffer::data()
+{
+    return buffer;
+}
+
+size_t Led_Frame_Pool::Buffer::capacity()
+{
+    return (buffer != nullptr) ? LED_FRAME_POOL_SLOT_SIZE : 0;
+}
+
+bool Led_Frame_Pool::Buffer::is_pooled()
+{
+    return pooled;
+}
+
+void Led_Frame_Pool::Buffer::release()
+{
+    if (buffer != nullptr)
+    {
+        pool->release(buffer, pooled);
+        pool = nullptr;
+        buffer = nullptr;
+        pooled = false;
+    }
+}
+
+Led_Frame_Pool::Led_Frame_Pool(size_t slot_count)
+    : slots(new uint8_t[slot_count * LED_FRAME_POOL_SLOT_SIZE])                // not value initialized - no zero fill
+    , hit_count(0)
+    , miss_count(0)
+{
+    // hand out the lowest slots first
+    free_slots.reserve(slot_count);
+    for (size_t i = slot_count; i > 0; i--)
+    {
+        free_slots.push_back(&slots[(i - 1) * LED_FRAME_POOL_SLOT_SIZE]);
+    }
+}
+
+Led_Frame_Pool::~Led_Frame_Pool()
+{
+}
+
+Led_Frame_Pool::Buffer Led_Frame_Pool::acquire()
+{
+    Buffer frame_buffer;
+
+    frame_buffer.pool = this;
+
+    {
+        std::lock_guard<std::mutex> guard(free_lock);
+
+        if (!free_slots.empty())
+        {
+            frame_buffer.buffer = free_slots.back();
+            frame_buffer.pooled = true;
+            free_slots.pop_back();
+        }
+    }
+
+    if (frame_buffer.pooled)
+    {
+        hit_count++;
+        return frame_buffer;
+    }
+
+    // every slot is in use - fall back to the heap, freed again on release
+    dbg_verbose("frame pool exhausted, allocating buffer");
+    frame_buffer.buffer = new uint8_t[LED_FRAME_POOL_SLOT_SIZE];
+    miss_count++;
+
+    return frame_buffer;
+}
+
+void Led_Frame_Pool::release(uint8_t *buffer, bool pooled)
+{
+    if (!pooled)
+    {
+        delete[] buffer;
+        return;
+    }
+
+    // capacity was reserved for every slot, push_back never allocates
+    std::lock_guard<std::mutex> guard(free_lock);
+    free_slots.push_back(buffer);
+}
+
+int Led_Frame_Pool::get_hit_count()
+{
+    return hit_count.load();
+}
+
+int Led_Frame_Pool::get_miss_count()
+{
+    return miss_count.load();
+}
+
+size_t Led_Frame_Pool::get_free_count()
+{
+    std::lock_guard<std::mutex> guard(free_lock);
+
+    return free_slots.size();
+}
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "debug.h"
+#include "led_codec.h"
+#include "led_message.h"
+
+
+bool Led_Message::is_message(const uint8_t *header)
+{
+    char magic_str[] = LED_MSG_MAGIC;
+
+    return (memcmp(header, magic_str, LED_MAGIC_LEN) == 0);
+}
+
+size_t Led_Message::get_max_message_size()
+{
+    return LED_MSG_HEADER_SIZE + std::max(LED_MULTI_MAX_SIZE, Led_Codec::get_frame_size(Led_Codec::get_max_led_count()));
+}
+
+size_t Led_Message::get_message_size(const uint8_t *header)
+{
+    const led_msg_t *msg_header = reinterpret_cast<const led_msg_t*>(header);
+    uint32_t msg_length = ntohl(msg_header->msg_length);
+
+    // length covers type/flags/sequence at minimum and must fit the receive limit
+    if (msg_length < (LED_MSG_HEADER_SIZE - LED_HEADER_SIZE) || msg_length > (get_max_message_size() - LED_HEADER_SIZE))
+    {
+        std::ostringstream err_str;
+
+        err_str << "message length was invalid - receive " << msg_length
+            << " (range " << (LED_MSG_HEADER_SIZE - LED_HEADER_SIZE) << "-" << (get_max_message_size() - LED_HEADER_SIZE) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return LED_HEADER_SIZE + msg_length;
+}
+
+size_t Led_Message::encode_into(uint8_t type, uint8_t flags, uint32_t sequence, const uint8_t *payload, size_t payload_size,
+        uint8_t *buffer, size_t buffer_size)
+{
+    size_t header_size;
+
+    if (LED_MSG_HEADER_SIZE + payload_size > buffer_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "message buffer too small - " << buffer_size << " bytes (need " << (LED_MSG_HEADER_SIZE + payload_size) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    header_size = encode_header_into(type, flags, sequence, payload_size, buffer, buffer_size);
+    if (payload_size > 0)
+    {
+        memcpy(&buffer[header_size], payload, payload_size);
+    }
+
+    return header_size + payload_size;
+}
+
+size_t Led_Message::encode_header_into(uint8_t type, uint8_t flags, uint32_t sequence, size_t payload_size,
+        uint8_t *buffer, size_t buffer_size)
+{
+    led_msg_t *msg_header = reinterpret_cast<led_msg_t*>(buffer);
+    size_t message_size = LED_MSG_HEADER_SIZE + payload_size;
+    char magic_str[] = LED_MSG_MAGIC;
+
+    if (message_size > get_max_message_size())
+    {
+        std::ostringstream err_str;
+
+        err_str << "message is too long - " << message_size << " bytes (maximum " << get_max_message_size() << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (buffer_size < LED_MSG_HEADER_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "message header buffer too small - " << buffer_size << " bytes (need " << LED_MSG_HEADER_SIZE << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    memcpy(msg_header->msg_magic, magic_str, LED_MAGIC_LEN);
+    msg_header->msg_length = htonl(message_size - LED_HEADER_SIZE);
+    msg_header->msg_type = type;
+    msg_header->msg_flags = flags;
+    msg_header->msg_reserved = 0;
+    msg_header->msg_sequence = htonl(sequence);
+
+    return LED_MSG_HEADER_SIZE;
+}
+
+size_t Led_Message::encode_ack_into(uint32_t sequence, uint32_t status, uint32_t checksum, uint8_t *buffer, size_t buffer_size)
+{
+    led_ack_t ack;
+
+    ack.ack_status = htonl(status);
+    ack.ack_checksum = htonl(checksum);
+
+    return encode_into(LED_MSG_TYPE_ACK, 0, sequence, reinterpret_cast<const uint8_t*>(&ack), sizeof(ack), buffer, buffer_size);
+}
+
+std::vector<uint8_t> Led_Message::create(uint8_t type, uint8_t flags, uint32_t sequence, const uint8_t *payload, size_t payload_size)
+{
+    std::vector<uint8_t> message(LED_MSG_HEADER_SIZE + payload_size);
+
+    encode_into(type, flags, sequence, payload, payload_size, message.data(), message.size());
+
+    return message;
+}
+
+std::vector<uint8_t> Led_Message::create_frame(uint32_t sequence, const std::vector<uint8_t> &led_frame, uint8_t flags)
+{
+    return create(LED_MSG_TYPE_FRAME, flags, sequence, led_frame.data(), led_frame.size());
+}
+
+std::vector<uint8_t> Led_Message::create_ack(uint32_t sequence, uint32_t status, uint32_t checksum)
+{
+    std::vector<uint8_t> message(LED_MSG_ACK_SIZE);
+
+    encode_ack_into(sequence, status, checksum, message.data(), message.size());
+
+    return message;
+}
+
+const Led_Message::led_msg_t *Led_Message::parse(const std::vector<uint8_t> &message)
+{
+    return parse(message.data(), message.size());
+}
+
+const Led_Message::led_msg_t *Led_Message::parse(const uint8_t *message, size_t message_size)
+{
+    if (message_size < LED_MSG_HEADER_SIZE || !is_message(message))
+    {
+        std::ostringstream err_str;
+
+        err_str << "invalid message - " << message_size << " bytes without a valid " << LED_MSG_MAGIC << " header";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (get_message_size(message) != message_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "message size did not match - " << message_size << " bytes (expected " << get_message_size(message) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return reinterpret_cast<const led_msg_t*>(message);
+}
+
+uint32_t Led_Message::get_sequence(const led_msg_t *header)
+{
+    return ntohl(header->msg_sequence);
+}
+
+size_t Led_Message::get_payload_size(const led_msg_t *header)
+{
+    return ntohl(header->msg_length) - (LED_MSG_HEADER_SIZE - LED_HEADER_SIZE);
+}
+
+const Led_Message::led_ack_t *Led_Message::get_ack(const led_msg_t *header)
+{
+    if (header->msg_type != LED_MSG_TYPE_ACK || get_payload_size(header) != sizeof(led_ack_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "invalid ack - message type " << (int)header->msg_type << " with " << get_payload_size(header) << " byte payload";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return reinterpret_cast<const led_ack_t*>(header->msg_data);
+}
+
+uint32_t Led_Message::checksum(const uint8_t *data, size_t size, uint32_t hash)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+uint32_t Led_Message::fold_hash(uint64_t frame_hash)
+{
+    return (uint32_t)(frame_hash ^ (frame_hash >> 32));
+}
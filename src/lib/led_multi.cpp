@@ -0,0 +1,157 @@
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "debug.h"
+#include "led_codec.h"
+#include "led_multi.h"
+
+static_assert(LED_MAX_STRIPS <= 32, "decode tracks the strip ids seen in a 32-bit mask");
+
+
+size_t Led_Multi::encode_header_into(uint32_t strip_count, uint8_t *buffer, size_t buffer_size)
+{
+    led_multi_t *multi = reinterpret_cast<led_multi_t*>(buffer);
+
+    if (strip_count < 1 || strip_count > LED_MAX_STRIPS || buffer_size < sizeof(led_multi_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "multi-strip frame of " << strip_count << " strips (range 1-" << LED_MAX_STRIPS << ") in a "
+            << buffer_size << " byte buffer";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    multi->multi_strip_count = htonl(strip_count);
+
+    return sizeof(led_multi_t);
+}
+
+size_t Led_Multi::encode_strip_header_into(uint32_t strip_id, uint32_t led_count, uint8_t *buffer, size_t buffer_size)
+{
+    led_strip_frame_t *strip_frame = reinterpret_cast<led_strip_frame_t*>(buffer);
+
+    if (strip_id >= LED_MAX_STRIPS || buffer_size < LED_MULTI_STRIP_HEADER_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "strip " << strip_id << " (range 0-" << (LED_MAX_STRIPS - 1) << ") header in a " << buffer_size << " byte buffer";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    strip_frame->strip_id = htonl(strip_id);
+    Led_Codec::encode_header_into(led_count, strip_frame->strip_frame, buffer_size - sizeof(led_strip_frame_t));
+
+    return LED_MULTI_STRIP_HEADER_SIZE;
+}
+
+size_t Led_Multi::encode_into(const led_strip_ref_t *strips, uint32_t strip_count, uint8_t *buffer, size_t buffer_size)
+{
+    size_t offset = encode_header_into(strip_count, buffer, buffer_size);
+
+    for (uint32_t i = 0; i < strip_count; i++)
+    {
+        uint32_t led_count = strips[i].leds->get_led_count();
+        size_t colors_size = led_count * sizeof(Led_Strip::led_color_t);
+
+        if (buffer_size - offset < LED_MULTI_STRIP_HEADER_SIZE + colors_size)
+        {
+            std::ostringstream err_str;
+
+            err_str << "multi-strip buffer too small - " << buffer_size << " bytes (strip " << i << " ends at "
+                << (offset + LED_MULTI_STRIP_HEADER_SIZE + colors_size) << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        offset += encode_strip_header_into(strips[i].strip_id, led_count, &buffer[offset], buffer_size - offset);
+        memcpy(&buffer[offset], strips[i].leds->get_led_colors(), colors_size);
+        offset += colors_size;
+    }
+
+    return offset;
+}
+
+uint32_t Led_Multi::decode(const uint8_t *multi, size_t multi_size, led_strip_view_t *strip_views, uint32_t max_strip_count)
+{
+    const led_multi_t *multi_header = reinterpret_cast<const led_multi_t*>(multi);
+    uint32_t strip_count;
+    uint32_t seen_strips = 0;
+    size_t offset = sizeof(led_multi_t);
+
+    if (multi_size < sizeof(led_multi_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "multi-strip frame too small - " << multi_size << " bytes";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    strip_count = ntohl(multi_header->multi_strip_count);
+    if (strip_count < 1 || strip_count > LED_MAX_STRIPS || strip_count > max_strip_count)
+    {
+        std::ostringstream err_str;
+
+        err_str << "multi-strip frame has " << strip_count << " strips (range 1-" << std::min((uint32_t)LED_MAX_STRIPS, max_strip_count) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // one pass - each sub-frame header gives the size of its frame and the offset of the next one
+    for (uint32_t i = 0; i < strip_count; i++)
+    {
+        const led_strip_frame_t *strip_frame = reinterpret_cast<const led_strip_frame_t*>(&multi[offset]);
+        const Led_Strip::led_net_t *net_frame;
+        uint32_t strip_id;
+        uint32_t led_count;
+        size_t frame_size;
+
+        if (multi_size - offset < LED_MULTI_STRIP_HEADER_SIZE)
+        {
+            std::ostringstream err_str;
+
+            err_str << "multi-strip frame ends inside the header of strip " << i << " (" << multi_size << " bytes)";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        strip_id = ntohl(strip_frame->strip_id);
+        net_frame = reinterpret_cast<const Led_Strip::led_net_t*>(strip_frame->strip_frame);
+        led_count = ntohl(net_frame->net_led_count);
+        if (strip_id >= LED_MAX_STRIPS || (seen_strips & (1u << strip_id)) != 0 || led_count > Led_Codec::get_max_led_count()
+                || multi_size - offset - sizeof(led_strip_frame_t) < Led_Codec::get_frame_size(led_count))
+        {
+            std::ostringstream err_str;
+
+            err_str << "multi-strip frame has an invalid or repeated strip " << strip_id << " of " << led_count << " leds at offset " << offset;
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        // magic and size checked in place
+        frame_size = Led_Codec::get_frame_size(led_count);
+        Led_Codec::decode_view(strip_frame->strip_frame, frame_size);
+
+        seen_strips |= (1u << strip_id);
+        strip_views[i].strip_id = strip_id;
+        strip_views[i].led_frame = strip_frame->strip_frame;
+        strip_views[i].frame_size = frame_size;
+        offset += sizeof(led_strip_frame_t) + frame_size;
+    }
+
+    if (offset != multi_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "multi-strip frame has " << (multi_size - offset) << " bytes after its last strip";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return strip_count;
+}
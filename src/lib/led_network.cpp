@@ -1,28 +1,42 @@
 #include <sstream>
 #include <stdexcept>
-#include <thread>
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include "led.h"
+#include "led_codec.h"
 #include "led_network.h"
+#include "led_message.h"
+#include "led_uring.h"
 #include "debug.h"
 
 
-Led_Network::Led_Network()
+Led_Network::Led_Network(led_transport_t transport_arg)
     : socket_fd(-1)
     , socket_initialized(false)
     , send_message_count(0)
     , receive_message_count(0)
     , stop_requested(false)
+    , epoll_fd(-1)
+    , wake_fd(-1)
+    , transport(transport_arg)
+    , io_backend(LED_IO_BACKEND_EPOLL)
 {
 }
 
 Led_Network::~Led_Network()
 {
+    close_event_loop();
     close_socket();
 }
 
@@ -38,16 +52,13 @@ int Led_Network::get_send_message_count()
 
 void Led_Network::inc_send_message_count()
 {
-    int value = send_message_count.load();
-    ++value;
-    send_message_count.store(value);
+    send_message_count++;
 }
 
 void Led_Network::inc_receive_message_count()
 {
-    int value = receive_message_count.load();
-    ++value;
-    receive_message_count.store(value);
+    // atomic increment - frames may be applied from more than one thread
+    receive_message_count++;
 }
 
 void Led_Network::start_network()
@@ -55,9 +66,179 @@ void Led_Network::start_network()
     stop_requested.store(false);
 }
 
+led_transport_t Led_Network::get_transport()
+{
+    return transport;
+}
+
+void Led_Network::set_io_backend(led_io_backend_t io_backend_arg)
+{
+    if (io_backend_arg >= LED_IO_BACKEND_COUNT)
+    {
+        std::ostringstream err_str;
+
+        err_str << "invalid io backend " << (int)io_backend_arg;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    io_backend = io_backend_arg;
+}
+
+led_io_backend_t Led_Network::get_io_backend()
+{
+    return io_backend;
+}
+
+int Led_Network::get_frame_pool_hit_count()
+{
+    return frame_pool.get_hit_count();
+}
+
+int Led_Network::get_frame_pool_miss_count()
+{
+    return frame_pool.get_miss_count();
+}
+
 void Led_Network::stop_network()
 {
     stop_requested.store(true);
+
+    // interrupt any thread blocked in wait_events
+    wake_event_loop();
+}
+
+void Led_Network::send_datagrams(int dst_socket, const std::vector<std::vector<uint8_t>> &messages)
+{
+    struct mmsghdr msg_headers[LED_UDP_BATCH_COUNT];
+    struct iovec msg_iovecs[LED_UDP_BATCH_COUNT];
+    size_t total_sent = 0;
+    int batch_count;
+    int sent_count;
+
+    if (dst_socket < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Failed to send datagrams - socket is not initialized";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    while (total_sent < messages.size())
+    {
+        // one sendmmsg call for up to LED_UDP_BATCH_COUNT datagrams
+        batch_count = std::min(messages.size() - total_sent, (size_t)LED_UDP_BATCH_COUNT);
+        memset(msg_headers, 0, sizeof(msg_headers));
+        for (int i = 0; i < batch_count; i++)
+        {
+            const std::vector<uint8_t> &message = messages[total_sent + i];
+
+            msg_iovecs[i].iov_base = (void*)message.data();
+            msg_iovecs[i].iov_len = message.size();
+            msg_headers[i].msg_hdr.msg_iov = &msg_iovecs[i];
+            msg_headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        sent_count = sendmmsg(dst_socket, msg_headers, batch_count, MSG_NOSIGNAL);
+        if (sent_count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream err_str;
+
+            err_str << "failed to send datagrams: sent " << total_sent << " of " << messages.size() << ": " << strerror(errno) << " (" << errno << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        total_sent += sent_count;
+    }
+}
+
+int Led_Network::receive_datagrams(int src_socket, std::vector<std::vector<uint8_t>> &buffers, std::vector<size_t> &sizes,
+        std::vector<struct sockaddr_storage> &src_addrs)
+{
+    struct mmsghdr msg_headers[LED_UDP_BATCH_COUNT];
+    struct iovec msg_iovecs[LED_UDP_BATCH_COUNT];
+    int batch_count = std::min(buffers.size(), (size_t)LED_UDP_BATCH_COUNT);
+    int recv_count;
+
+    sizes.resize(batch_count);
+    src_addrs.resize(batch_count);
+
+    memset(msg_headers, 0, sizeof(msg_headers));
+    for (int i = 0; i < batch_count; i++)
+    {
+        msg_iovecs[i].iov_base = buffers[i].data();
+        msg_iovecs[i].iov_len = buffers[i].size();
+        msg_headers[i].msg_hdr.msg_iov = &msg_iovecs[i];
+        msg_headers[i].msg_hdr.msg_iovlen = 1;
+        msg_headers[i].msg_hdr.msg_name = &src_addrs[i];
+        msg_headers[i].msg_hdr.msg_namelen = sizeof(src_addrs[i]);
+    }
+
+    // read every waiting datagram (up to batch_count) with one call
+    recv_count = recvmmsg(src_socket, msg_headers, batch_count, MSG_DONTWAIT, nullptr);
+    if (recv_count < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return 0;
+        }
+
+        std::ostringstream err_str;
+
+        err_str << "failed to receive datagrams: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    for (int i = 0; i < recv_count; i++)
+    {
+        // truncated datagrams are reported as zero length so they are dropped
+        sizes[i] = (msg_headers[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msg_headers[i].msg_len;
+    }
+
+    return recv_count;
+}
+
+size_t Led_Network::get_message_size(const uint8_t *header)
+{
+    const Led_Strip::led_net_t *header_data = reinterpret_cast<const Led_Strip::led_net_t*>(header);
+    char magic_str[] = LED_MAGIC;
+    uint32_t led_count;
+
+    // typed message - size is given by its length field
+    if (Led_Message::is_message(header))
+    {
+        return Led_Message::get_message_size(header);
+    }
+
+    // check for LEDS magic value
+    if (memcmp(header_data->led_magic, magic_str, LED_MAGIC_LEN) != 0)
+    {
+        std::string err = "Failed to validate message header magic value";
+        dbg_error("%s", err.c_str());
+        throw std::runtime_error(err);
+    }
+
+    // check header is valid and get led count
+    led_count = ntohl(header_data->net_led_count);
+    dbg_notice("received led count: %d", led_count);
+    if (led_count < 1 || led_count > Led_Codec::get_max_led_count())
+    {
+        std::ostringstream err_str;
+
+        err_str << "led_count was invalid - receive " << led_count << " (range 1-" << Led_Codec::get_max_led_count() << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return LED_HEADER_SIZE + (led_count * sizeof(Led_Strip::led_color_t));
 }
 
 void Led_Network::create_socket()
@@ -65,7 +246,19 @@ void Led_Network::create_socket()
     int opt;
 
     // Create socket
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    switch (transport)
+    {
+        case LED_TRANSPORT_UDP:
+            socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+            break;
+        case LED_TRANSPORT_UNIX:
+            socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            break;
+        case LED_TRANSPORT_TCP:
+        default:
+            socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+            break;
+    }
     if (socket_fd < 0) 
     {
         std::ostringstream err_str;
@@ -115,6 +308,40 @@ void Led_Network::make_socket_nonblocking(int config_socket)
     }
 }
 
+void Led_Network::enable_keepalive(int config_socket)
+{
+    int opt;
+
+    // detect dead peers on long lived streaming sessions
+    opt = 1;
+    if (setsockopt(config_socket, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to enable keepalive: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    opt = LED_KEEPALIVE_IDLE_SEC;
+    if (setsockopt(config_socket, IPPROTO_TCP, TCP_KEEPIDLE, &opt, sizeof(opt)) < 0)
+    {
+        dbg_notice("failed to set keepalive idle time: %s (%d)", strerror(errno), errno);
+    }
+
+    opt = LED_KEEPALIVE_INTERVAL_SEC;
+    if (setsockopt(config_socket, IPPROTO_TCP, TCP_KEEPINTVL, &opt, sizeof(opt)) < 0)
+    {
+        dbg_notice("failed to set keepalive interval: %s (%d)", strerror(errno), errno);
+    }
+
+    opt = LED_KEEPALIVE_PROBE_COUNT;
+    if (setsockopt(config_socket, IPPROTO_TCP, TCP_KEEPCNT, &opt, sizeof(opt)) < 0)
+    {
+        dbg_notice("failed to set keepalive probe count: %s (%d)", strerror(errno), errno);
+    }
+}
+
 void Led_Network::close_socket()
 {
     if (socket_fd >= 0)
@@ -126,31 +353,247 @@ void Led_Network::close_socket()
     }
 }
 
-bool Led_Network::check_tcp_timeout(
-            const std::chrono::time_point<std::chrono::high_resolution_clock>& start
-        )
+void Led_Network::create_event_loop()
+{
+    // already created
+    if (epoll_fd >= 0)
+    {
+        return;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to create epoll instance: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // eventfd used by stop_network to wake the event loop immediately
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to create wake eventfd: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        close_event_loop();
+        throw std::runtime_error(err_str.str());
+    }
+
+    add_event_fd(wake_fd, EPOLLIN);
+
+    // io_uring is optional - keep the epoll loop if the kernel can not provide it
+    if (io_backend == LED_IO_BACKEND_URING)
+    {
+        try
+        {
+            uring = std::unique_ptr<Led_Uring>(new Led_Uring());
+        }
+        catch (const std::runtime_error& e)
+        {
+            dbg_notice("io_uring not available, using epoll: %s", e.what());
+            io_backend = LED_IO_BACKEND_EPOLL;
+        }
+    }
+
+    dbg_verbose("created event loop %d (wake fd %d)", epoll_fd, wake_fd);
+}
+
+void Led_Network::close_event_loop()
 {
-    auto end = std::chrono::high_resolution_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    uring.reset();
+
+    if (wake_fd >= 0)
+    {
+        close(wake_fd);
+        wake_fd = -1;
+    }
 
+    if (epoll_fd >= 0)
+    {
+        dbg_notice("close event loop %d", epoll_fd);
+
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
+
+void Led_Network::add_event_fd(int fd, uint32_t events)
+{
+    struct epoll_event event = {};
+
+    event.events = events;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to add fd " << fd << " to event loop: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+void Led_Network::modify_event_fd(int fd, uint32_t events)
+{
+    struct epoll_event event = {};
+
+    event.events = events;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to modify fd " << fd << " in event loop: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+void Led_Network::remove_event_fd(int fd)
+{
+    // descriptor may already be gone if the peer closed it - only log failures
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) < 0)
+    {
+        dbg_notice("failed to remove fd %d from event loop: %s (%d)", fd, strerror(errno), errno);
+    }
+}
+
+int Led_Network::wait_events(struct epoll_event *events, int max_events, int timeout_ms)
+{
+    int ready_count;
+
+    if (epoll_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Failed to wait for events - event loop is not initialized";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    ready_count = epoll_wait(epoll_fd, events, max_events, timeout_ms);
+    if (ready_count < 0)
+    {
+        // interrupted by signal - report as no events ready
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+
+        std::ostringstream err_str;
+
+        err_str << "failed to wait for events: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return ready_count;
+}
+
+void Led_Network::wake_event_loop()
+{
+    uint64_t value = 1;
+
+    if (wake_fd >= 0)
+    {
+        if (write(wake_fd, &value, sizeof(value)) != sizeof(value))
+        {
+            dbg_notice("failed to signal wake eventfd: %s (%d)", strerror(errno), errno);
+        }
+    }
+}
+
+void Led_Network::clear_wake_event()
+{
+    uint64_t value;
+
+    if (wake_fd >= 0)
+    {
+        // reset eventfd counter, EAGAIN is expected if already cleared
+        if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        {
+            dbg_notice("failed to clear wake eventfd: %s (%d)", strerror(errno), errno);
+        }
+    }
+}
+
+std::chrono::steady_clock::time_point Led_Network::get_message_deadline()
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(LED_MESSAGE_TIMEOUT_MS);
+}
+
+bool Led_Network::check_tcp_timeout(const std::chrono::steady_clock::time_point &deadline)
+{
     // handle as timeout if stopping
     if (stop_requested.load())
     {
         return true;
     }
 
-    return (elapsed >= std::chrono::milliseconds(LED_MESSAGE_TIMEOUT_MS));
+    return (std::chrono::steady_clock::now() >= deadline);
 }
 
+void Led_Network::wait_socket(int config_socket, short events, const std::chrono::steady_clock::time_point &deadline)
+{
+    struct pollfd poll_fds[2] = {};
+    int poll_count = 1;
+    int timeout_ms;
+
+    poll_fds[0].fd = config_socket;
+    poll_fds[0].events = events;
+
+    // stop_network interrupts the wait through the event loop wake fd
+    if (wake_fd >= 0)
+    {
+        poll_fds[1].fd = wake_fd;
+        poll_fds[1].events = POLLIN;
+        poll_count = 2;
+    }
+
+    // round up so the deadline has passed if poll times out
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    timeout_ms = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count() + 1);
+
+    // readiness, timeout and interruption are all handled by the caller's next attempt
+    if (poll(poll_fds, poll_count, timeout_ms) < 0 && errno != EINTR)
+    {
+        std::ostringstream err_str;
+
+        err_str << "failed to wait for socket " << config_socket << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+}
 
 void Led_Network::send_all(int dst_socket, const std::vector<uint8_t> &led_frame)
 {
+    send_all(dst_socket, led_frame.data(), led_frame.size());
+}
+
+void Led_Network::send_all(int dst_socket, const uint8_t *message, size_t message_size)
+{
+    struct iovec message_iov;
+
+    message_iov.iov_base = const_cast<uint8_t*>(message);
+    message_iov.iov_len = message_size;
+
+    send_all(dst_socket, &message_iov, 1);
+}
+
+int Led_Network::send_all(int dst_socket, struct iovec *iov, int iov_count, int send_flags)
+{
+    struct msghdr msg = {};
     ssize_t bytes_sent = 0;
-    ssize_t total_bytes_sent = 0;
-    const uint8_t *send_ptr;
-    ssize_t expected_size = led_frame.size();
-    ssize_t remaining_size;
-    auto start_time = std::chrono::high_resolution_clock::now();
+    size_t total_bytes_sent = 0;
+    size_t expected_size = 0;
+    int zerocopy_count = 0;
+    auto deadline = get_message_deadline();
 
     // do not send to invalid socket
     if (dst_socket < 0)
@@ -162,22 +605,29 @@ void Led_Network::send_all(int dst_socket, const std::vector<uint8_t> &led_frame
         throw std::runtime_error(err_str.str());
     }
 
+    for (int i = 0; i < iov_count; i++)
+    {
+        expected_size += iov[i].iov_len;
+    }
+
     // don't allow messages bigger than server buffer
-    if (led_frame.size() > LED_BUFFER_MAX_SIZE)
+    if (expected_size > Led_Message::get_max_message_size())
     {
         std::ostringstream err_str;
 
-        err_str << "led_frame is too long - receive " << led_frame.size() << " (maximum " << LED_BUFFER_MAX_SIZE << ")";
+        err_str << "led_frame is too long - receive " << expected_size << " (maximum " << Led_Message::get_max_message_size() << ")";
         dbg_error("%s", err_str.str().c_str());
         throw std::runtime_error(err_str.str());
-        
     }
 
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+
     // send client message to server
-    while (total_bytes_sent < led_frame.size())
+    while (total_bytes_sent < expected_size)
     {
         // timed out while waiting for message
-        if (check_tcp_timeout(start_time))
+        if (check_tcp_timeout(deadline))
         {
             // failed while getting data
             std::ostringstream err_str;
@@ -187,21 +637,25 @@ void Led_Network::send_all(int dst_socket, const std::vector<uint8_t> &led_frame
             throw std::runtime_error(err_str.str());
         }
 
-        // update current buffer pointer / remaining number of bytes to be sent
-        send_ptr = &led_frame.data()[total_bytes_sent];
-        remaining_size = expected_size - total_bytes_sent;
-
-        // attempt to send to server
-        bytes_sent = send(dst_socket, send_ptr, remaining_size, 0);
+        // every remaining piece in one call, never block past the deadline
+        bytes_sent = sendmsg(dst_socket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT | send_flags);
         if (bytes_sent == -1)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) 
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) 
             {
-                // no data is waiting - wait 
-                std::this_thread::sleep_for(std::chrono::milliseconds(LED_MESSAGE_POLL_TIME_MS));
+                // socket buffer is full - wait until it drains or the deadline passes
+                wait_socket(dst_socket, POLLOUT, deadline);
 
                 continue;
             } 
+            else if (errno == ENOBUFS && (send_flags & MSG_ZEROCOPY))
+            {
+                // out of memory for zero copy notifications - the kernel copies the rest
+                dbg_notice("zero copy send not possible, copying remaining %zu bytes", expected_size - total_bytes_sent);
+                send_flags &= ~MSG_ZEROCOPY;
+
+                continue;
+            }
             else 
             {
                 // failed while getting data
@@ -215,23 +669,49 @@ void Led_Network::send_all(int dst_socket, const std::vector<uint8_t> &led_frame
 
         // update bytes successfully sent
         total_bytes_sent += bytes_sent;
+        if (send_flags & MSG_ZEROCOPY)
+        {
+            zerocopy_count++;
+        }
+
+        // skip the pieces sent completely and continue inside a partially sent one
+        while (bytes_sent > 0)
+        {
+            if ((size_t)bytes_sent < msg.msg_iov->iov_len)
+            {
+                msg.msg_iov->iov_base = static_cast<uint8_t*>(msg.msg_iov->iov_base) + bytes_sent;
+                msg.msg_iov->iov_len -= bytes_sent;
+                break;
+            }
+
+            bytes_sent -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
     }
+
+    return zerocopy_count;
 }
 
 std::vector<uint8_t> Led_Network::receive_all(int src_socket)
+{
+    std::vector<uint8_t> led_frame(Led_Message::get_max_message_size());
+
+    led_frame.resize(receive_into(src_socket, led_frame.data(), led_frame.size()));
+
+    return led_frame;
+}
+
+size_t Led_Network::receive_into(int src_socket, uint8_t *buffer, size_t buffer_size)
 {
     ssize_t bytes_recv = 0;
     ssize_t total_bytes_recv = 0;
     uint8_t *recv_ptr;
     ssize_t expected_size;
     ssize_t remaining_size;
-    std::vector<uint8_t> led_header(LED_HEADER_SIZE);
-    std::vector<uint8_t> led_frame;
-    Led_Strip::led_net_t *header_data;
-    uint32_t led_count;
-    auto start_time = std::chrono::high_resolution_clock::now();
+    auto deadline = get_message_deadline();
 
-    dbg_notice("receive_all");
+    dbg_notice("receive_into");
 
     // do not send to invalid socket
     if (src_socket < 0)
@@ -243,12 +723,21 @@ std::vector<uint8_t> Led_Network::receive_all(int src_socket)
         throw std::runtime_error(err_str.str());
     }
 
+    if (buffer_size < LED_HEADER_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "receive buffer too small - " << buffer_size << " bytes (need " << LED_HEADER_SIZE << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
     // wait for the header
     expected_size = LED_HEADER_SIZE;
     while (total_bytes_recv < LED_HEADER_SIZE)
     {
         // timed out while waiting for message
-        if (check_tcp_timeout(start_time))
+        if (check_tcp_timeout(deadline))
         {
             // failed while getting data
             std::ostringstream err_str;
@@ -259,17 +748,25 @@ std::vector<uint8_t> Led_Network::receive_all(int src_socket)
         }
 
         // update current buffer pointer / remaining number of bytes to be sent
-        recv_ptr = &led_header.data()[total_bytes_recv];
+        recv_ptr = &buffer[total_bytes_recv];
         remaining_size = expected_size - total_bytes_recv;
 
-        // get header data from socket
-        bytes_recv = recv(src_socket, recv_ptr, remaining_size, 0);
+        // get header data from socket, never block past the deadline
+        bytes_recv = recv(src_socket, recv_ptr, remaining_size, MSG_DONTWAIT);
+        if (bytes_recv == 0)
+        {
+            std::ostringstream err_str;
+
+            err_str << "Connection closed while waiting for header: recv " << total_bytes_recv << " of expected total bytes " << expected_size;
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
         if (bytes_recv == -1)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) 
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) 
             {
-                // no data is waiting - wait 
-                std::this_thread::sleep_for(std::chrono::milliseconds(LED_MESSAGE_POLL_TIME_MS));
+                // no data is waiting - wait until some arrives or the deadline passes
+                wait_socket(src_socket, POLLIN, deadline);
 
                 continue;
             } 
@@ -299,42 +796,27 @@ std::vector<uint8_t> Led_Network::receive_all(int src_socket)
         throw std::runtime_error(err_str.str());
     }
 
-    // check header is valid and get led count
-    header_data = reinterpret_cast<Led_Strip::led_net_t*>(led_header.data());
-    led_count = ntohl(header_data->net_led_count);
-    dbg_notice("received led count: %d", led_count);
-    if (led_count < 1 || led_count > LED_MAX_COUNT)
+    // check header is valid and get the message size, the rest is received behind the header
+    expected_size = get_message_size(buffer);
+    dbg_notice("expect total frame size: %zu", expected_size);
+    if ((size_t)expected_size > buffer_size)
     {
         std::ostringstream err_str;
 
-        err_str << "led_count was invalid - receive " << led_count << " (range 1-" << LED_MAX_COUNT << ")";
+        err_str << "receive buffer too small - " << buffer_size << " bytes (need " << expected_size << ")";
         dbg_error("%s", err_str.str().c_str());
         throw std::runtime_error(err_str.str());
     }
 
-    // create the final buffer with space to store LED header and data
-    expected_size = LED_HEADER_SIZE + (led_count * sizeof(Led_Strip::led_color_t));
-    led_frame.resize(expected_size);
-    dbg_notice("expect total frame size: %zu", expected_size);
-    if (led_frame.size() != expected_size)
-    {
-        std::string err = "Failed to allocate space for led frame";
-        dbg_error("%s", err.c_str());
-        throw std::runtime_error(err);
-    }
-
-    // copy header to final led_frame
-    memcpy(led_frame.data(), led_header.data(), LED_HEADER_SIZE);
-
     // get led color data (expected_size and total_bytes_recv include sizeof header+colors
     while (total_bytes_recv < expected_size)
     {
         // update current buffer pointer / remaining number of bytes to be sent
-        recv_ptr = &led_frame.data()[total_bytes_recv];
+        recv_ptr = &buffer[total_bytes_recv];
         remaining_size = expected_size - total_bytes_recv;
 
         // timed out while waiting for message
-        if (check_tcp_timeout(start_time))
+        if (check_tcp_timeout(deadline))
         {
             std::ostringstream err_str;
 
@@ -343,12 +825,23 @@ std::vector<uint8_t> Led_Network::receive_all(int src_socket)
             throw std::runtime_error(err_str.str());
         }
 
-        // get led data from socket
-        bytes_recv = recv(src_socket, recv_ptr, remaining_size, 0);
+        // get led data from socket, never block past the deadline
+        bytes_recv = recv(src_socket, recv_ptr, remaining_size, MSG_DONTWAIT);
+        if (bytes_recv == 0)
+        {
+            std::ostringstream err_str;
+
+            err_str << "Connection closed while waiting for message: recv " << total_bytes_recv << " of expected total bytes " << expected_size;
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
         if (bytes_recv == -1)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // no data waiting
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                // rest of the frame has not arrived yet - wait instead of spinning
+                wait_socket(src_socket, POLLIN, deadline);
+
                 continue;
             } 
             else 
@@ -366,7 +859,7 @@ std::vector<uint8_t> Led_Network::receive_all(int src_socket)
         total_bytes_recv += bytes_recv;
     }
 
-    return led_frame;
+    return expected_size;
 }
 
 #if 0
@@ -399,7 +892,7 @@ void Led_Client::send_leds(std::vector<uint8_t> led_frame)
     }
 
     // send client message to server
-    while (total_bytes_sent < led_frame.size())
+    while (total_bytes_sent < expected_size)
     {
         bytes_sent = send(socket_fd, &client_msg, sizeof(client_msg), 0);
         if (bytes_sent == -1)
@@ -0,0 +1,131 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "debug.h"
+#include "led_playout_queue.h"
+
+
+Led_Playout_Queue::Led_Playout_Queue(size_t capacity)
+    : slots(capacity, led_playout_slot_t{std::chrono::steady_clock::time_point(), Led_Strip(0)})
+    , head(0)
+    , count(0)
+    , stopping(false)
+{
+    if (capacity < 1)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Playout_Queue needs at least one slot";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+}
+
+size_t Led_Playout_Queue::get_capacity()
+{
+    return slots.size();
+}
+
+size_t Led_Playout_Queue::get_size()
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+
+    return count;
+}
+
+bool Led_Playout_Queue::push(const std::chrono::steady_clock::time_point &play_time, const uint8_t *led_frame, size_t frame_size)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        led_playout_slot_t *last_slot = &slots[(head + count + slots.size() - 1) % slots.size()];
+
+        // frames are shown in the order they are queued
+        if (count == slots.size() || (count > 0 && play_time < last_slot->play_time))
+        {
+            return false;
+        }
+
+        // decoded into the slot storage, the slot stays free if the frame is invalid
+        led_playout_slot_t &slot = slots[(head + count) % slots.size()];
+
+        slot.leds.set_leds_from_frame(led_frame, frame_size);
+        slot.play_time = play_time;
+        count++;
+    }
+    queue_changed.notify_one();
+
+    return true;
+}
+
+size_t Led_Playout_Queue::clear()
+{
+    size_t dropped_count;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+
+        dropped_count = count;
+        head = 0;
+        count = 0;
+    }
+    queue_changed.notify_one();
+
+    return dropped_count;
+}
+
+bool Led_Playout_Queue::wait_frame(Led_Strip &leds, std::chrono::steady_clock::time_point *play_time, size_t *skipped_count)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    std::chrono::steady_clock::time_point now;
+
+    *skipped_count = 0;
+    while (true)
+    {
+        if (stopping)
+        {
+            return false;
+        }
+
+        if (count == 0)
+        {
+            queue_changed.wait(lock);
+            continue;
+        }
+
+        // frames queued or cleared meanwhile are seen after every wakeup
+        now = std::chrono::steady_clock::now();
+        if (now < slots[head].play_time)
+        {
+            queue_changed.wait_until(lock, slots[head].play_time);
+            continue;
+        }
+
+        break;
+    }
+
+    // behind schedule - show the newest due frame instead of catching up one by one
+    while (count > 1 && slots[(head + 1) % slots.size()].play_time <= now)
+    {
+        head = (head + 1) % slots.size();
+        count--;
+        (*skipped_count)++;
+    }
+
+    // assigned into the storage of leds, no allocation once it is large enough
+    leds = slots[head].leds;
+    *play_time = slots[head].play_time;
+    head = (head + 1) % slots.size();
+    count--;
+
+    return true;
+}
+
+void Led_Playout_Queue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+
+        stopping = true;
+    }
+    queue_changed.notify_all();
+}
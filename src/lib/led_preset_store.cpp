@@ -0,0 +1,252 @@
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "led_codec.h"
+#include "led_preset_store.h"
+
+
+Led_Preset_Store::Led_Preset_Store(std::string file_path)
+    : store_path(file_path)
+    , store_map(nullptr)
+    , store_size(0)
+    , preset_count(0)
+{
+    const led_preset_header_t *header;
+    struct stat store_stat;
+    void *map;
+    int store_fd;
+
+    store_fd = open(store_path.c_str(), O_RDONLY);
+    if (store_fd < 0 || fstat(store_fd, &store_stat) != 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store failed to open " << store_path << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        if (store_fd >= 0)
+        {
+            close(store_fd);
+        }
+        throw std::runtime_error(err_str.str());
+    }
+
+    if ((size_t)store_stat.st_size < sizeof(led_preset_header_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store " << store_path << " too small (" << store_stat.st_size << " bytes)";
+        dbg_error("%s", err_str.str().c_str());
+        close(store_fd);
+        throw std::runtime_error(err_str.str());
+    }
+
+    // the mapping stays valid once the descriptor is closed, pages are only read in when a preset is used
+    store_size = store_stat.st_size;
+    map = mmap(0, store_size, PROT_READ, MAP_SHARED, store_fd, 0);
+    close(store_fd);
+    if (map == MAP_FAILED)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store failed to map " << store_path << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+    store_map = static_cast<const uint8_t*>(map);
+
+    // presets are picked in any order, read ahead would only load unused ones
+    madvise(map, store_size, MADV_RANDOM);
+
+    header = reinterpret_cast<const led_preset_header_t*>(store_map);
+    preset_count = ntohl(header->preset_count);
+    if (memcmp(header->preset_magic, LED_PRESET_MAGIC, LED_MAGIC_LEN) != 0 || ntohl(header->preset_version) != LED_PRESET_VERSION
+            || (size_t)preset_count > (store_size - sizeof(led_preset_header_t)) / sizeof(led_preset_entry_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store " << store_path << " is not a version " << LED_PRESET_VERSION << " preset store with "
+            << preset_count << " presets";
+        dbg_error("%s", err_str.str().c_str());
+        munmap(map, store_size);
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_notice("mapped %u presets from %s", preset_count, store_path.c_str());
+}
+
+Led_Preset_Store::~Led_Preset_Store()
+{
+    munmap(const_cast<uint8_t*>(store_map), store_size);
+}
+
+void Led_Preset_Store::create(const std::string &file_path, const std::vector<led_preset_source_t> &presets)
+{
+    std::vector<led_preset_source_t> sorted_presets(presets);
+    std::vector<led_preset_entry_t> entries(presets.size());
+    std::vector<std::vector<uint8_t>> frames;
+    led_preset_header_t header;
+    std::string temp_path = file_path + ".tmp";
+    uint32_t offset;
+
+    // index sorted by id for the binary search in find_preset
+    std::sort(sorted_presets.begin(), sorted_presets.end(),
+            [](const led_preset_source_t &a, const led_preset_source_t &b) { return a.preset_id < b.preset_id; });
+
+    offset = sizeof(led_preset_header_t) + (presets.size() * sizeof(led_preset_entry_t));
+    for (size_t i = 0; i < sorted_presets.size(); i++)
+    {
+        if ((i > 0 && sorted_presets[i].preset_id == sorted_presets[i - 1].preset_id)
+                || sorted_presets[i].preset_name.length() >= LED_PRESET_NAME_LEN)
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Preset_Store preset " << sorted_presets[i].preset_id << " (" << sorted_presets[i].preset_name
+                << ") has a duplicate id or a name longer than " << (LED_PRESET_NAME_LEN - 1) << " characters";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::invalid_argument(err_str.str());
+        }
+
+        Led_Strip leds(sorted_presets[i].file_path.c_str());
+
+        frames.push_back(leds.get_led_net_frame());
+        entries[i].entry_id = htonl(sorted_presets[i].preset_id);
+        entries[i].entry_offset = htonl(offset);
+        entries[i].entry_size = htonl(frames.back().size());
+        memset(entries[i].entry_name, 0, sizeof(entries[i].entry_name));
+        memcpy(entries[i].entry_name, sorted_presets[i].preset_name.c_str(), sorted_presets[i].preset_name.length());
+        offset += frames.back().size();
+    }
+
+    memcpy(header.preset_magic, LED_PRESET_MAGIC, LED_MAGIC_LEN);
+    header.preset_version = htonl(LED_PRESET_VERSION);
+    header.preset_count = htonl(presets.size());
+    header.preset_reserved = 0;
+
+    // written aside and renamed, a server mapping the old store keeps reading a complete file
+    {
+        std::ofstream output_file(temp_path, std::ios::trunc | std::ios::binary);
+
+        output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output_file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(led_preset_entry_t));
+        for (const std::vector<uint8_t> &frame : frames)
+        {
+            output_file.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        }
+
+        if (!output_file.good())
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Preset_Store failed to write " << temp_path;
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+    }
+
+    if (rename(temp_path.c_str(), file_path.c_str()) != 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store failed to replace " << file_path << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        unlink(temp_path.c_str());
+        throw std::runtime_error(err_str.str());
+    }
+}
+
+uint32_t Led_Preset_Store::get_preset_count()
+{
+    return preset_count;
+}
+
+const Led_Preset_Store::led_preset_entry_t *Led_Preset_Store::get_entries()
+{
+    return reinterpret_cast<const led_preset_entry_t*>(&store_map[sizeof(led_preset_header_t)]);
+}
+
+bool Led_Preset_Store::find_preset(uint32_t preset_id, const uint8_t **frame, size_t *frame_size)
+{
+    const led_preset_entry_t *entries = get_entries();
+    const led_preset_entry_t *entry = nullptr;
+    uint32_t low = 0;
+    uint32_t high = preset_count;
+    uint32_t middle;
+    size_t offset;
+    size_t size;
+
+    // only the index pages on the search path are touched
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (ntohl(entries[middle].entry_id) < preset_id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low < preset_count && ntohl(entries[low].entry_id) == preset_id)
+    {
+        entry = &entries[low];
+    }
+
+    if (entry == nullptr)
+    {
+        return false;
+    }
+
+    offset = ntohl(entry->entry_offset);
+    size = ntohl(entry->entry_size);
+    if (offset > store_size || size > (store_size - offset))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Preset_Store preset " << preset_id << " at " << offset << "+" << size << " is outside "
+            << store_path << " (" << store_size << " bytes)";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // validated when used, throws if the frame is invalid
+    Led_Codec::decode_view(&store_map[offset], size);
+
+    *frame = &store_map[offset];
+    *frame_size = size;
+
+    return true;
+}
+
+bool Led_Preset_Store::find_preset(const std::string &preset_name, uint32_t *preset_id)
+{
+    const led_preset_entry_t *entries = get_entries();
+
+    if (preset_name.length() >= LED_PRESET_NAME_LEN)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < preset_count; i++)
+    {
+        if (strncmp(entries[i].entry_name, preset_name.c_str(), LED_PRESET_NAME_LEN) == 0)
+        {
+            *preset_id = ntohl(entries[i].entry_id);
+            return true;
+        }
+    }
+
+    return false;
+}
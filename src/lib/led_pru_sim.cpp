@@ -0,0 +1,186 @@
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "led_pru_sim.h"
+
+#if DEBUG_NO_SHMEM
+Led_Pru_Sim::Led_Pru_Sim(uint32_t bit_ns, uint32_t reset_us)
+    : bit_ns(bit_ns)
+    , reset_us(reset_us)
+    , shared_mem_fd(-1)
+    , shared_mem_map((volatile uint32_t*) MAP_FAILED)
+    , running(true)
+    , start_count(0)
+    , frame_count(0)
+    , stats()
+    , queued_us_total(0)
+    , latency_us_total(0)
+    , last_sequence(0)
+    , seen_word(0)
+{
+    // the file is created and sized by PruMem
+    shared_mem_fd = open(SHARED_MEM_MAP_FILE, O_RDWR);
+    if (shared_mem_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Pru_Sim failed to open file " << SHARED_MEM_MAP_FILE;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    shared_mem_map = (volatile uint32_t*) mmap(0, SHARED_MEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shared_mem_fd, SHARED_MEM_START_ADDR);
+    if (shared_mem_map == MAP_FAILED)
+    {
+        std::ostringstream err_str;
+
+        close(shared_mem_fd);
+        err_str << "Led_Pru_Sim failed set memory map for " << SHARED_MEM_MAP_FILE;
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    pru_thread = std::thread(&Led_Pru_Sim::run_pru, this);
+}
+
+Led_Pru_Sim::~Led_Pru_Sim()
+{
+    running.store(false);
+    pru_thread.join();
+
+    munmap((void*)shared_mem_map, SHARED_MEM_SIZE);
+    close(shared_mem_fd);
+}
+
+int Led_Pru_Sim::get_start_count()
+{
+    return start_count.load();
+}
+
+int Led_Pru_Sim::get_frame_count()
+{
+    return frame_count.load();
+}
+
+std::vector<Led_Strip::led_color_t> Led_Pru_Sim::get_shown_leds()
+{
+    std::lock_guard<std::mutex> lock(shown_mutex);
+
+    return shown_leds;
+}
+
+Led_Pru_Sim::led_pru_sim_stats_t Led_Pru_Sim::get_stats()
+{
+    std::lock_guard<std::mutex> lock(shown_mutex);
+
+    return stats;
+}
+
+void Led_Pru_Sim::watch_start_word()
+{
+    uint32_t start_word = shared_mem_map[SHARED_MEM_LED_BEGIN_WRITE_OFFSET];
+
+    // queued from the first time the flip is seen
+    if (start_word != seen_word)
+    {
+        seen_word = start_word;
+        seen_time = std::chrono::steady_clock::now();
+    }
+}
+
+void Led_Pru_Sim::add_frame_stats(uint32_t start_word, const std::chrono::steady_clock::time_point &flip_time,
+        const std::chrono::steady_clock::time_point &start_time, uint32_t frame_us)
+{
+    uint32_t sequence = start_word >> 1;
+    uint32_t queued_us = std::chrono::duration_cast<std::chrono::microseconds>(start_time - flip_time).count();
+    uint32_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - flip_time).count();
+
+    // sequences skipped since the last frame were replaced while pending, a new host counts from 1 again
+    stats.dropped_count += sequence - ((sequence > last_sequence) ? last_sequence : 0) - 1;
+    last_sequence = sequence;
+
+    stats.frame_count++;
+    stats.frame_us = frame_us;
+    stats.refresh_rate = 1e6 / frame_us;
+    queued_us_total += queued_us;
+    stats.queued_us_avg = (double)queued_us_total / stats.frame_count;
+    stats.queued_us_max = std::max(stats.queued_us_max, queued_us);
+    latency_us_total += latency_us;
+    stats.latency_us_avg = (double)latency_us_total / stats.frame_count;
+    stats.latency_us_max = std::max(stats.latency_us_max, latency_us);
+}
+
+void Led_Pru_Sim::run_pru()
+{
+    std::vector<Led_Strip::led_color_t> frame_leds;
+    std::chrono::steady_clock::time_point flip_time;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point end_time;
+    uint32_t start_word;
+    uint32_t led_count;
+    uint32_t frame_us;
+
+    while (running.load())
+    {
+        watch_start_word();
+        start_word = seen_word;
+        if (start_word == 0 || start_word == shared_mem_map[SHARED_MEM_LED_DONE_OFFSET])
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(SHARED_MEM_POLL_US));
+            continue;
+        }
+
+        // claim the buffer, then make sure the host did not flip to a newer frame before seeing the claim
+        shared_mem_map[SHARED_MEM_LED_BUSY_OFFSET] = start_word;
+        __sync_synchronize();
+        if (shared_mem_map[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] != start_word)
+        {
+            continue;
+        }
+        flip_time = seen_time;
+        start_time = std::chrono::steady_clock::now();
+        start_count++;
+
+        // the PRU reads the buffer as it clocks it out - the host does not touch it until the done word is written
+        volatile uint32_t *buffer = shared_mem_map + SHARED_MEM_LED_BUFFER_OFFSET + (start_word & 1) * SHARED_MEM_LED_BUFFER_SIZE;
+
+        led_count = std::min((uint32_t)buffer[SHARED_MEM_LED_COUNT_OFFSET], (uint32_t)WS2812_LED_COUNT);
+        frame_leds.resize(led_count);
+        for (uint32_t i = 0; i < led_count; i++)
+        {
+            uint32_t led_word = buffer[SHARED_MEM_LED_START_OFFSET + i];
+
+            frame_leds[i].red = (led_word >> 8) & 0xff;
+            frame_leds[i].green = (led_word >> 16) & 0xff;
+            frame_leds[i].blue = led_word & 0xff;
+        }
+
+        // bits at the strip's rate, then the reset latch - flips seen meanwhile are timestamped
+        frame_us = ((uint64_t)led_count * WS2812_LED_BIT_COUNT * bit_ns) / 1000 + reset_us;
+        end_time = start_time + std::chrono::microseconds(frame_us);
+        while (std::chrono::steady_clock::now() < end_time)
+        {
+            std::this_thread::sleep_until(std::min(end_time, std::chrono::steady_clock::now() + std::chrono::microseconds(SHARED_MEM_POLL_US)));
+            watch_start_word();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shown_mutex);
+
+            shown_leds.swap(frame_leds);
+            add_frame_stats(start_word, flip_time, start_time, frame_us);
+        }
+        frame_count++;
+
+        // buffer reads are complete before the host sees the buffer free
+        __sync_synchronize();
+        shared_mem_map[SHARED_MEM_LED_DONE_OFFSET] = start_word;
+    }
+}
+#endif
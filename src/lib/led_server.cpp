@@ -5,22 +5,84 @@
 #include <cstring>
 #include <errno.h>
 #include <chrono>
+#include <algorithm>
 #include <thread>
 #include <future>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <endian.h>
 
 #include "debug.h"
 #include "led_server.h"
+#include "led_message.h"
+#include "led_codec.h"
+#include "led_delta.h"
+#include "led_compact.h"
+#include "share.h"
 
+// io_uring user data - operation in the upper half, descriptor in the lower half
+typedef enum
+{
+    LED_URING_OP_NONE = LED_URING_USER_DATA_NONE,
+    LED_URING_OP_ACCEPT,
+    LED_URING_OP_WAKE,
+    LED_URING_OP_RECV,
+    LED_URING_OP_SEND,
+    LED_URING_OP_CANCEL
+} led_uring_op_t;
+
+#define LED_URING_USER_DATA(op, fd) (((uint64_t)(op) << 32) | (uint32_t)(fd))
 
-Led_Server::Led_Server(int port)
-    : Led_Network()
+
+Led_Server::Led_Server(int port, led_transport_t transport)
+    : Led_Network(transport)
     , server_port(port)
     , server_is_running(false)
+    , accepted_count(0)
+    , dropped_count(0)
+    , duplicate_frame_count(0)
+    , dispatch_thread_count(std::max(std::min((int)std::thread::hardware_concurrency(), LED_MAX_STRIPS) - 1, 0))
+    , playout_late_count(0)
+    , playout_dropped_count(0)
+    , pru_output_enabled(false)
+    , output_rate(0)
+    , output_frame_count(0)
+    , output_truncated_count(0)
+    , accept_paused(false)
+    , uring_accept_armed(false)
+    , uring_wake_armed(false)
+{
+}
+
+Led_Server::Led_Server(std::string socket_path)
+    : Led_Network(LED_TRANSPORT_UNIX)
+    , server_port(0)
+    , server_path(socket_path)
+    , server_is_running(false)
+    , accepted_count(0)
+    , dropped_count(0)
+    , duplicate_frame_count(0)
+    , dispatch_thread_count(std::max(std::min((int)std::thread::hardware_concurrency(), LED_MAX_STRIPS) - 1, 0))
+    , playout_late_count(0)
+    , playout_dropped_count(0)
+    , pru_output_enabled(false)
+    , output_rate(0)
+    , output_frame_count(0)
+    , output_truncated_count(0)
+    , accept_paused(false)
+    , uring_accept_armed(false)
+    , uring_wake_armed(false)
 {
 }
 
 Led_Server::~Led_Server()
 {
+    // remove the socket file created by bind
+    if (transport == LED_TRANSPORT_UNIX && socket_initialized)
+    {
+        unlink(server_path.c_str());
+    }
 }
 
 void Led_Server::initialize()
@@ -29,15 +91,62 @@ void Led_Server::initialize()
 
     if (!socket_initialized)
     {
-        // create TCP socket
+        // create TCP, UDP or unix socket
         create_socket();
 
-        // accept all IPv4 connections on server port
+        // accept all IPv4 connections / datagrams on server port, or connections on the socket path
         bind_socket();
 
-        // make server socket nonblocking to allow stop_server while polling for messages
+        // make server socket nonblocking so accept_clients can drain pending connections
         make_socket_nonblocking(socket_fd);
 
+        // datagrams are already batched with recvmmsg, io_uring only serves stream sockets
+        if (transport == LED_TRANSPORT_UDP && io_backend == LED_IO_BACKEND_URING)
+        {
+            dbg_notice("io_uring backend not used for UDP, using epoll");
+            io_backend = LED_IO_BACKEND_EPOLL;
+        }
+
+        // create the event loop early so stop_server can wake it at any time
+        create_event_loop();
+
+        // create the shared memory segment so producers can attach before the server starts
+        if (!shm_ring_name.empty())
+        {
+            shm_ring = std::unique_ptr<Led_Shm_Ring>(new Led_Shm_Ring(shm_ring_name, true));
+        }
+
+        // workers for multi-strip frames, started once
+        if (dispatch_thread_count > 0)
+        {
+            dispatch_pool = std::unique_ptr<Led_Dispatch_Pool>(new Led_Dispatch_Pool(dispatch_thread_count));
+        }
+
+        // map the preset store, presets are only read and validated when activated
+        if (!preset_store_path.empty())
+        {
+            preset_store = std::unique_ptr<Led_Preset_Store>(new Led_Preset_Store(preset_store_path));
+        }
+
+        // timelines arrive on stream connections only, the slots are allocated once
+        if (transport != LED_TRANSPORT_UDP)
+        {
+            playout_queue = std::unique_ptr<Led_Playout_Queue>(new Led_Playout_Queue(LED_PLAYOUT_QUEUE_SIZE));
+        }
+
+        // map the PRU memory once, frames reach it through the output buffers
+        if (pru_output_enabled)
+        {
+            pru_mem = std::unique_ptr<PruMem>(new PruMem((const void*)SHARED_MEM_START_ADDR));
+            output_frames = std::unique_ptr<Led_Triple_Buffer>(new Led_Triple_Buffer());
+        }
+
+        // timerfd for fixed rate output, armed when the output thread starts
+        if (pru_output_enabled && output_rate > 0)
+        {
+            output_pacer = std::unique_ptr<Led_Frame_Pacer>(new Led_Frame_Pacer(output_rate));
+        }
+
         // Update socket init status
         socket_initialized = true;
     }
@@ -45,6 +154,10 @@ void Led_Server::initialize()
 
 void Led_Server::bind_socket()
 {
+    struct sockaddr_un server_unix_addr = {};
+    struct sockaddr *bind_addr = (struct sockaddr*)&server_addr;
+    socklen_t bind_len = sizeof(server_addr);
+
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(server_port);
@@ -58,8 +171,28 @@ void Led_Server::bind_socket()
         throw std::runtime_error(err_str.str());
     }
 
+    if (transport == LED_TRANSPORT_UNIX)
+    {
+        if (server_path.empty() || server_path.length() >= sizeof(server_unix_addr.sun_path))
+        {
+            std::ostringstream err_str;
+
+            err_str << "Led_Server socket path length " << server_path.length() << " out of range (1-" << (sizeof(server_unix_addr.sun_path) - 1) << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        server_unix_addr.sun_family = AF_UNIX;
+        strncpy(server_unix_addr.sun_path, server_path.c_str(), sizeof(server_unix_addr.sun_path) - 1);
+        bind_addr = (struct sockaddr*)&server_unix_addr;
+        bind_len = sizeof(server_unix_addr);
+
+        // remove a socket file left behind by a previous server
+        unlink(server_path.c_str());
+    }
+
     // Bind socket
-    if (bind(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0)
+    if (bind(socket_fd, bind_addr, bind_len) < 0)
     {
         std::ostringstream err_str;
 
@@ -71,6 +204,82 @@ void Led_Server::bind_socket()
 
     dbg_notice("Led_Server successfully bind socket");
 }
+void Led_Server::set_shm_ring(std::string ring_name)
+{
+    if (socket_initialized)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server shared memory ring must be set before initialize";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    shm_ring_name = ring_name;
+}
+
+void Led_Server::set_preset_store(std::string file_path)
+{
+    if (socket_initialized)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server preset store must be set before initialize";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    preset_store_path = file_path;
+}
+
+void Led_Server::set_dispatch_thread_count(int thread_count)
+{
+    if (socket_initialized || thread_count < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server dispatch thread count " << thread_count << " must be set before initialize, and not negative";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    dispatch_thread_count = thread_count;
+}
+
+int Led_Server::get_dispatch_thread_count()
+{
+    return dispatch_thread_count;
+}
+
+void Led_Server::set_pru_output(bool enable)
+{
+    if (socket_initialized)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server PRU output must be set before initialize";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    pru_output_enabled = enable;
+}
+
+void Led_Server::set_output_rate(uint32_t refresh_rate)
+{
+    if (socket_initialized || refresh_rate > Led_Frame_Pacer::get_max_refresh_rate())
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server output rate " << refresh_rate << " must be set before initialize, and at most "
+                << Led_Frame_Pacer::get_max_refresh_rate() << " frames per second";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    output_rate = refresh_rate;
+}
+
 void Led_Server::stop_server()
 {
     server_is_running.store(false);
@@ -82,11 +291,76 @@ bool Led_Server::get_server_is_running()
     return (server_is_running.load() && !stop_requested.load());
 }
 
+int Led_Server::get_accepted_count()
+{
+    return accepted_count.load();
+}
+
+int Led_Server::get_dropped_count()
+{
+    return dropped_count.load();
+}
+
+int Led_Server::get_duplicate_frame_count()
+{
+    return duplicate_frame_count.load();
+}
+
+int Led_Server::get_playout_late_count()
+{
+    return playout_late_count.load();
+}
+
+int Led_Server::get_playout_dropped_count()
+{
+    return playout_dropped_count.load();
+}
+
+int Led_Server::get_output_frame_count()
+{
+    return output_frame_count.load();
+}
+
+int Led_Server::get_output_overwritten_count()
+{
+    return output_frames ? output_frames->get_overwritten_count() : 0;
+}
+
+int Led_Server::get_output_truncated_count()
+{
+    return output_truncated_count.load();
+}
+
+Led_Frame_Pacer::led_pacer_stats_t Led_Server::get_output_pacer_stats()
+{
+    Led_Frame_Pacer::led_pacer_stats_t stats = {};
+
+    // with pacing every frame the output buffers overwrite was coalesced into a later tick
+    if (output_pacer)
+    {
+        stats = output_pacer->get_stats();
+        stats.coalesced_frame_count = output_frames->get_overwritten_count();
+    }
+
+    return stats;
+}
+
+int Led_Server::get_strip_frame_count(uint32_t strip_id)
+{
+    if (strip_id >= LED_MAX_STRIPS)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Server strip " << strip_id << " out of range (0-" << (LED_MAX_STRIPS - 1) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    return strip_outputs[strip_id].frame_count.load();
+}
+
 void Led_Server::start_server()
 {
-    int client_fd;
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
     dbg_notice("starting server");
 
     // do not listen on invalid socket
@@ -99,7 +373,12 @@ void Led_Server::start_server()
         throw std::runtime_error(err_str.str());
     }
 
-    if (listen(socket_fd, 5) < 0) 
+    // datagram sockets are read directly, stream sockets accept connections
+    if (transport == LED_TRANSPORT_UDP)
+    {
+        datagram_buffers.assign(LED_UDP_BATCH_COUNT, std::vector<uint8_t>(LED_MSG_MAX_SIZE));
+    }
+    else if (listen(socket_fd, 5) < 0) 
     {
         std::ostringstream err_str;
 
@@ -112,88 +391,1567 @@ void Led_Server::start_server()
     start_network();
     server_is_running.store(true);
 
+    // shared memory frames are consumed on their own thread, the ring has no descriptor to poll
+    if (shm_ring)
+    {
+        shm_thread = std::thread(&Led_Server::consume_shm_ring, this);
+    }
+
+    // timeline frames are shown from their own thread, at their time on the server clock
+    if (playout_queue)
+    {
+        playout_thread = std::thread(&Led_Server::run_playout, this);
+    }
+
+    // the PRU is written from its own thread, a slow refresh never holds up receiving
+    if (output_frames)
+    {
+        output_thread = std::thread(output_pacer ? &Led_Server::run_paced_output : &Led_Server::run_output, this);
+    }
+
     dbg_notice("accepting clients");
-    while (server_is_running.load()) 
+    try
     {
-        // accept client connection
-        client_fd = accept(socket_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd < 0) 
+        if (uring)
+        {
+            run_uring_loop();
+        }
+        else
+        {
+            run_epoll_loop();
+        }
+    }
+    catch (...)
+    {
+        server_is_running.store(false);
+        stop_shm_consumer();
+        stop_playout();
+        stop_output();
+        close_all_clients();
+        throw;
+    }
+
+    stop_shm_consumer();
+    stop_playout();
+    stop_output();
+    close_all_clients();
+}
+
+void Led_Server::run_epoll_loop()
+{
+    struct epoll_event events[LED_EVENT_MAX_COUNT];
+    int ready_count;
+
+    // wait for new connections or datagrams on the server socket
+    add_event_fd(socket_fd, EPOLLIN);
+    accept_paused = false;
+
+    try
+    {
+        while (server_is_running.load()) 
         {
-            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) 
+            // block until a socket is ready, a client deadline passes, or stop_server signals the wake fd
+            ready_count = wait_events(events, LED_EVENT_MAX_COUNT, get_next_timeout_ms());
+
+            for (int i = 0; i < ready_count; i++)
             {
-                // log if the error wasn't caused because no clients were connected
-                dbg_error("Led_Server failed to handle client connection");
+                int ready_fd = events[i].data.fd;
+
+                if (ready_fd == wake_fd)
+                {
+                    // stop requested - loop condition is checked after handling events
+                    clear_wake_event();
+                }
+                else if (ready_fd == socket_fd && transport == LED_TRANSPORT_UDP)
+                {
+                    receive_frame_datagrams();
+                }
+                else if (ready_fd == socket_fd)
+                {
+                    accept_clients();
+                }
+                else
+                {
+                    handle_client(ready_fd, events[i].events);
+                }
             }
 
-            // sleep to avoid busy waiting for clients
-            std::this_thread::sleep_for(std::chrono::milliseconds(LED_MESSAGE_POLL_TIME_MS));
-            continue;
+            // drop clients that stalled in the middle of a message or idled out
+            close_stalled_clients();
+            if (accept_paused && std::chrono::steady_clock::now() >= accept_resume_time)
+            {
+                resume_accept();
+            }
         }
-        // record the connection
-        dbg_notice("client connected to server");
+    }
+    catch (...)
+    {
+        // clients closed from here on must not add the server socket back
+        accept_paused = false;
+        remove_event_fd(socket_fd);
+        throw;
+    }
 
-        // do not block for client socket
-        make_socket_nonblocking(client_fd);
+    accept_paused = false;
+    remove_event_fd(socket_fd);
+}
 
-        // Receive data from client
-        std::vector<uint8_t> client_frame = receive_all(client_fd);
-        dbg_notice("received frame from client");
-        dbg_verbose_print_vector(client_frame);
+void Led_Server::run_uring_loop()
+{
+    struct io_uring_cqe cqe;
 
-        Led_Strip client_leds(1);
-        client_leds.set_leds_from_net_frame(client_frame);
+    // accept and the stop request are operations like any other, re-armed when they complete
+    uring->prep_accept(socket_fd, LED_URING_USER_DATA(LED_URING_OP_ACCEPT, socket_fd));
+    uring->prep_poll(wake_fd, POLLIN, LED_URING_USER_DATA(LED_URING_OP_WAKE, wake_fd));
+    uring_accept_armed = true;
+    uring_wake_armed = true;
+    accept_paused = false;
 
-        printf("converted configuration client: \n");
-        client_leds.print_all_leds();
+    try
+    {
+        while (server_is_running.load())
+        {
+            // one syscall submits everything queued while handling the previous completions
+            // and waits for the next ones, or until a client deadline passes
+            uring->submit_and_wait(1, get_next_timeout_ms());
 
-        // increment the number of valid messages received
-        inc_receive_message_count();
+            while (uring->get_completion(cqe))
+            {
+                handle_uring_completion(cqe);
+            }
 
-        // Send response to client
-        send_all(client_fd, client_frame);
+            // drop clients that stalled in the middle of a message or idled out
+            close_stalled_clients();
+            if (accept_paused && std::chrono::steady_clock::now() >= accept_resume_time)
+            {
+                resume_accept();
+            }
+        }
+    }
+    catch (...)
+    {
+        finish_uring_operations();
+        throw;
+    }
 
-        // increment the number of valid messages received
-        inc_send_message_count();
+    finish_uring_operations();
+}
+
+void Led_Server::consume_shm_ring()
+{
+    std::vector<uint8_t> led_frame;
+    uint32_t wake_sequence;
+
+    led_frame.reserve(LED_SHM_RING_SLOT_SIZE);
+    while (true)
+    {
+        // read before checking for work so a wake in between is not lost
+        wake_sequence = shm_ring->get_wake_sequence();
+        if (!server_is_running.load())
+        {
+            break;
+        }
 
-        // Close client socket
-        close(client_fd);
+        // fast path - frames are copied out of the ring without any syscall
+        if (!shm_ring->read_frame(led_frame))
+        {
+            shm_ring->wait_frame(wake_sequence, -1);
+            continue;
+        }
 
-        dbg_notice("Led_Server client disconnect");
+        try
+        {
+            apply_frame(led_frame.data(), led_frame.size());
+            inc_receive_message_count();
+        }
+        catch (const std::runtime_error& e)
+        {
+            dbg_error("Led_Server rejected shared memory frame: %s", e.what());
+            dropped_count++;
+        }
     }
 }
 
-Led_Server_Nonblocking::Led_Server_Nonblocking(int port)
-    : server(port)
+void Led_Server::stop_shm_consumer()
 {
+    if (shm_thread.joinable())
+    {
+        // server_is_running is already false - wake the consumer so it sees it
+        shm_ring->wake();
+        shm_thread.join();
+    }
 }
 
-Led_Server_Nonblocking::~Led_Server_Nonblocking()
+void Led_Server::run_playout()
 {
+    Led_Strip playout_leds(0);
+    std::chrono::steady_clock::time_point play_time;
+    size_t skipped_count;
+
+    while (playout_queue->wait_frame(playout_leds, &play_time, &skipped_count))
+    {
+        Led_Codec::led_frame_view_t view = {(uint32_t)playout_leds.get_led_count(), playout_leds.get_led_colors()};
+
+        playout_dropped_count += skipped_count;
+        if (std::chrono::steady_clock::now() - play_time > std::chrono::microseconds(LED_PLAYOUT_LATE_US))
+        {
+            playout_late_count++;
+        }
+
+        apply_view(view);
+    }
 }
 
-void Led_Server_Nonblocking::initialize()
+void Led_Server::stop_playout()
 {
-    if (!socket_initialized)
+    if (playout_thread.joinable())
     {
-        server.initialize();
+        playout_queue->stop();
+        playout_thread.join();
+    }
+}
 
-        socket_initialized = true;
+void Led_Server::run_output()
+{
+    Led_Codec::led_frame_view_t view;
+    uint32_t wake_sequence;
+
+    while (true)
+    {
+        // read before checking for work so a wake in between is not lost
+        wake_sequence = output_frames->get_wake_sequence();
+        if (!server_is_running.load())
+        {
+            break;
+        }
+
+        // only the newest frame is taken, frames published while the last one was written are skipped
+        if (!output_frames->take(&view))
+        {
+            output_frames->wait_frame(wake_sequence, -1);
+            continue;
+        }
+
+        write_output(view);
     }
 }
 
-bool Led_Server_Nonblocking::get_server_is_running()
+void Led_Server::run_paced_output()
 {
-    return server.get_server_is_running();
+    Led_Codec::led_frame_view_t view;
+
+    // a strip without a new frame keeps showing the last one
+    while (output_pacer->wait_tick())
+    {
+        if (output_frames->take(&view))
+        {
+            write_output(view);
+        }
+    }
 }
 
-int Led_Server_Nonblocking::get_send_message_count()
+void Led_Server::write_output(const Led_Codec::led_frame_view_t &view)
 {
-    return server.get_send_message_count();
+    // the PRU drives up to WS2812_LED_COUNT leds, longer strips are cut
+    uint32_t led_count = std::min(view.led_count, (uint32_t)WS2812_LED_COUNT);
+
+    // a setup problem rather than a bad frame - counted, and logged for the first one only
+    if (view.led_count > led_count && output_truncated_count++ == 0)
+    {
+        dbg_error("Led_Server PRU output cut a %u led strip to %u leds", view.led_count, led_count);
+    }
+
+    try
+    {
+        pru_mem->write_mem_led_count(led_count);
+        pru_mem->write_mem_led_colors(view.led_colors, led_count);
+        pru_mem->write_mem_led_start();
+        output_frame_count++;
+    }
+    catch (const std::exception& e)
+    {
+        // the PRU still holds both buffers or rejected the frame, the next frame tries again
+        dbg_error("Led_Server dropped PRU output frame: %s", e.what());
+        dropped_count++;
+    }
 }
 
-int Led_Server_Nonblocking::get_receive_message_count()
+void Led_Server::stop_output()
 {
-    return server.get_receive_message_count();
+    if (output_thread.joinable())
+    {
+        // server_is_running is already false - wake the output thread so it sees it
+        output_frames->wake();
+        if (output_pacer)
+        {
+            output_pacer->stop();
+        }
+        output_thread.join();
+    }
+}
+
+void Led_Server::accept_clients()
+{
+    int client_fd;
+    struct sockaddr_storage client_addr;
+    socklen_t client_len;
+
+    // accept every pending connection before returning to the event loop
+    while (true)
+    {
+        client_len = sizeof(client_addr);
+        client_fd = accept(socket_fd, (struct sockaddr*)&client_addr, &client_len);
+        if (client_fd < 0) 
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) 
+            {
+                // no more clients waiting
+                return;
+            }
+
+            // the peer gave up before it was accepted
+            if ((errno == ECONNABORTED) || (errno == EINTR))
+            {
+                continue;
+            }
+
+            // out of descriptors or memory - the connection stays queued and would wake the loop right
+            // away, wait for a client to close or the backoff to pass
+            dbg_error("Led_Server failed to handle client connection: %s (%d)", strerror(errno), errno);
+            pause_accept();
+            return;
+        }
+
+        // record the connection
+        dbg_notice("client connected to server");
+
+        try
+        {
+            // do not block for client socket
+            make_socket_nonblocking(client_fd);
+
+            // detect peers that vanish during a streaming session (unix sockets report this directly)
+            if (transport == LED_TRANSPORT_TCP)
+            {
+                enable_keepalive(client_fd);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            // drop this client but keep accepting the others
+            dbg_error("Led_Server failed to set up client %d: %s", client_fd, e.what());
+            close(client_fd);
+            continue;
+        }
+
+        // wait for client data with the other sockets
+        client_connections[client_fd] = std::unique_ptr<Led_Connection>(new Led_Connection(client_fd, frame_pool));
+        add_event_fd(client_fd, EPOLLIN);
+        accepted_count++;
+    }
+}
+
+void Led_Server::pause_accept()
+{
+    accept_paused = true;
+    accept_resume_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(LED_ACCEPT_BACKOFF_MS);
+
+    // io_uring - the accept is just not re-armed
+    if (!uring)
+    {
+        remove_event_fd(socket_fd);
+    }
+}
+
+void Led_Server::resume_accept()
+{
+    // nothing is re-armed once the server stops
+    if (!accept_paused || !server_is_running.load())
+    {
+        return;
+    }
+
+    accept_paused = false;
+    if (uring)
+    {
+        uring->prep_accept(socket_fd, LED_URING_USER_DATA(LED_URING_OP_ACCEPT, socket_fd));
+        uring_accept_armed = true;
+    }
+    else
+    {
+        add_event_fd(socket_fd, EPOLLIN);
+    }
+}
+
+void Led_Server::receive_frame_datagrams()
+{
+    std::vector<size_t> sizes;
+    std::vector<struct sockaddr_storage> src_addrs;
+    Led_Frame_Pool::Buffer latest_frame;
+    size_t latest_size = 0;
+    bool latest_valid = false;
+    int recv_count;
+    std::chrono::steady_clock::time_point now;
+
+    // drain the socket, only the newest frame is applied
+    do
+    {
+        recv_count = receive_datagrams(socket_fd, datagram_buffers, sizes, src_addrs);
+        now = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < recv_count; i++)
+        {
+            const uint8_t *datagram = datagram_buffers[i].data();
+            const Led_Message::led_msg_t *msg_header = reinterpret_cast<const Led_Message::led_msg_t*>(datagram);
+            const struct sockaddr_in *src_addr = reinterpret_cast<const struct sockaddr_in*>(&src_addrs[i]);
+            uint64_t sender = ((uint64_t)src_addr->sin_addr.s_addr << 16) | src_addr->sin_port;
+            uint32_t sequence;
+
+            // each datagram must hold exactly one typed frame message
+            if (sizes[i] < LED_MSG_HEADER_SIZE || !Led_Message::is_message(datagram)
+                    || ntohl(msg_header->msg_length) != (sizes[i] - LED_HEADER_SIZE)
+                    || msg_header->msg_type != LED_MSG_TYPE_FRAME)
+            {
+                dbg_error("Led_Server dropped invalid datagram (%zu bytes)", sizes[i]);
+                dropped_count++;
+                continue;
+            }
+
+            // out of order or duplicate - an equal or newer frame from this sender was already seen, unless the
+            // sender went quiet or jumped back further than reordering explains (restarted on the same port)
+            sequence = Led_Message::get_sequence(msg_header);
+            auto sender_entry = datagram_senders.find(sender);
+            if (sender_entry != datagram_senders.end() && (int32_t)(sequence - sender_entry->second.sequence) <= 0
+                    && (int32_t)(sequence - sender_entry->second.sequence) > -LED_UDP_SEQUENCE_WINDOW
+                    && now - sender_entry->second.last_seen < std::chrono::milliseconds(LED_UDP_SENDER_TIMEOUT_MS))
+            {
+                dbg_verbose("Led_Server dropped stale datagram %u (newest %u)", sequence, sender_entry->second.sequence);
+                dropped_count++;
+                continue;
+            }
+
+            // forget silent senders once too many are tracked, all of them if every one is still active
+            if (sender_entry == datagram_senders.end() && datagram_senders.size() >= LED_UDP_MAX_SENDERS)
+            {
+                forget_datagram_senders(now);
+            }
+            datagram_senders[sender] = {sequence, now};
+
+            // a newer frame replaces the one waiting to be applied
+            if (latest_valid)
+            {
+                dropped_count++;
+            }
+            else
+            {
+                latest_frame = frame_pool.acquire();
+            }
+            latest_size = sizes[i] - LED_MSG_HEADER_SIZE;
+            memcpy(latest_frame.data(), msg_header->msg_data, latest_size);
+            latest_valid = true;
+        }
+    } while (recv_count == LED_UDP_BATCH_COUNT);
+
+    if (!latest_valid)
+    {
+        return;
+    }
+
+    try
+    {
+        apply_frame(latest_frame.data(), latest_size);
+        inc_receive_message_count();
+    }
+    catch (const std::runtime_error& e)
+    {
+        dbg_error("Led_Server rejected datagram frame: %s", e.what());
+        dropped_count++;
+    }
+}
+
+void Led_Server::forget_datagram_senders(const std::chrono::steady_clock::time_point &now)
+{
+    for (auto sender_entry = datagram_senders.begin(); sender_entry != datagram_senders.end(); )
+    {
+        if (now - sender_entry->second.last_seen >= std::chrono::milliseconds(LED_UDP_SENDER_TIMEOUT_MS))
+        {
+            sender_entry = datagram_senders.erase(sender_entry);
+        }
+        else
+        {
+            sender_entry++;
+        }
+    }
+
+    if (datagram_senders.size() >= LED_UDP_MAX_SENDERS)
+    {
+        datagram_senders.clear();
+    }
+}
+
+void Led_Server::handle_client(int client_fd, uint32_t events)
+{
+    auto connection_entry = client_connections.find(client_fd);
+    bool peer_open = true;
+
+    // already closed while handling an earlier event
+    if (connection_entry == client_connections.end())
+    {
+        return;
+    }
+
+    Led_Connection &connection = *connection_entry->second;
+
+    try
+    {
+        // a backlogged session is only read again once its responses drained (EPOLLIN is not armed meanwhile)
+        if ((events & (EPOLLHUP | EPOLLERR)) || ((events & EPOLLIN) && !connection.is_send_backlogged()))
+        {
+            // read whatever arrived, partial messages stay buffered in the connection
+            peer_open = connection.receive_available();
+
+            handle_received(connection);
+        }
+
+        if (events & EPOLLOUT)
+        {
+            connection.send_pending();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // drop the failed client but keep serving the others
+        dbg_error("Led_Server client %d failed: %s", client_fd, e.what());
+        close_client(client_fd);
+        return;
+    }
+
+    // keep the session open until the peer closes it
+    if (!peer_open)
+    {
+        close_client(client_fd);
+        return;
+    }
+
+    update_client_events(connection);
+}
+
+void Led_Server::handle_received(Led_Connection &connection)
+{
+    const uint8_t *message;
+    size_t message_size;
+    const uint8_t *header;
+    size_t header_size;
+    const Led_Strip::led_color_t *led_colors;
+    uint32_t led_count;
+
+    // a completed stream arrived before anything buffered, then every complete message is handled in place
+    while (true)
+    {
+        if (connection.peek_stream(&header, &header_size, &led_colors, &led_count))
+        {
+            handle_stream(connection, header, header_size, led_colors, led_count);
+            connection.consume_stream();
+        }
+        else if (connection.peek_message(&message, &message_size))
+        {
+            handle_message(connection, message, message_size);
+            connection.consume_message(message_size);
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+void Led_Server::handle_stream(Led_Connection &connection, const uint8_t *header, size_t header_size,
+        const Led_Strip::led_color_t *led_colors, uint32_t led_count)
+{
+    const uint8_t *colors_data = reinterpret_cast<const uint8_t*>(led_colors);
+    size_t colors_size = led_count * sizeof(Led_Strip::led_color_t);
+    Led_Codec::led_frame_view_t view = {led_count, led_colors};
+    uint8_t ack_message[LED_MSG_ACK_SIZE];
+    size_t ack_size;
+    uint32_t frame_checksum;
+
+    dbg_notice("received streamed frame of %u leds from client", led_count);
+
+    // headers were validated when the stream started, the colors are in the session strip already
+    apply_view(view);
+    inc_receive_message_count();
+
+    // legacy frame - echo back in full
+    if (!Led_Message::is_message(header))
+    {
+        connection.queue_send(header, header_size);
+        connection.queue_send(colors_data, colors_size);
+        inc_send_message_count();
+        return;
+    }
+
+    const Led_Message::led_msg_t *msg_header = reinterpret_cast<const Led_Message::led_msg_t*>(header);
+    uint32_t sequence = Led_Message::get_sequence(msg_header);
+
+    // following delta frames apply to this one, it is stored there already
+    connection.set_delta_base(sequence, led_colors, led_count);
+
+    // debug mode - return the full frame
+    if (msg_header->msg_flags & LED_MSG_FLAG_ECHO)
+    {
+        connection.queue_send(header, header_size);
+        connection.queue_send(colors_data, colors_size);
+    }
+    else
+    {
+        // checksum of the frame, continued from its led_net_t header over the colors
+        frame_checksum = Led_Message::checksum(msg_header->msg_data, sizeof(Led_Strip::led_net_t));
+        frame_checksum = Led_Message::checksum(colors_data, colors_size, frame_checksum);
+        ack_size = Led_Message::encode_ack_into(sequence, LED_ACK_STATUS_OK, frame_checksum, ack_message, sizeof(ack_message));
+        connection.queue_send(ack_message, ack_size);
+    }
+    inc_send_message_count();
+}
+
+void Led_Server::handle_message(Led_Connection &connection, const uint8_t *message, size_t message_size)
+{
+    uint8_t ack_message[LED_MSG_ACK_SIZE];
+    size_t ack_size;
+
+    dbg_notice("received frame from client");
+    dbg_verbose_print_buffer(message, message_size);
+
+    // legacy frame - apply and echo back in full
+    if (!Led_Message::is_message(message))
+    {
+        apply_frame(message, message_size);
+
+        // increment the number of valid messages received
+        inc_receive_message_count();
+
+        // Send response to client, written by the event loop if the socket is full
+        connection.queue_send(message, message_size);
+
+        // increment the number of valid messages sent
+        inc_send_message_count();
+        return;
+    }
+
+    const Led_Message::led_msg_t *msg_header = Led_Message::parse(message, message_size);
+    uint32_t sequence = Led_Message::get_sequence(msg_header);
+
+    switch (msg_header->msg_type)
+    {
+        case LED_MSG_TYPE_FRAME:
+        {
+            const uint8_t *led_frame = msg_header->msg_data;
+            size_t frame_size = Led_Message::get_payload_size(msg_header);
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            // a bad frame is reported in the ack instead of dropping the session
+            try
+            {
+                Led_Codec::led_frame_view_t view = apply_frame(led_frame, frame_size);
+
+                // following delta frames apply to this one
+                connection.set_delta_base(sequence, view.led_colors, view.led_count);
+                inc_receive_message_count();
+            }
+            catch (const std::runtime_error& e)
+            {
+                dbg_error("Led_Server rejected frame %u: %s", sequence, e.what());
+                status = LED_ACK_STATUS_INVALID;
+            }
+
+            // debug mode - return the full frame
+            if ((msg_header->msg_flags & LED_MSG_FLAG_ECHO) && status == LED_ACK_STATUS_OK)
+            {
+                connection.queue_send(message, message_size);
+            }
+            else
+            {
+                // acknowledge by sequence, client may already have sent the following frames
+                ack_size = Led_Message::encode_ack_into(sequence, status, Led_Message::checksum(led_frame, frame_size), ack_message, sizeof(ack_message));
+                connection.queue_send(ack_message, ack_size);
+            }
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_DELTA:
+        {
+            const uint8_t *delta = msg_header->msg_data;
+            size_t delta_size = Led_Message::get_payload_size(msg_header);
+            uint8_t frame_header[sizeof(Led_Strip::led_net_t)];
+            Led_Strip::led_color_t *base_colors;
+            uint32_t led_count = 0;
+            uint32_t frame_checksum = 0;
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            try
+            {
+                // only the frame this session applied last can be the base, otherwise the client sends a keyframe
+                base_colors = connection.get_delta_base(Led_Delta::get_base_sequence(delta, delta_size), &led_count);
+                if (base_colors == nullptr)
+                {
+                    dbg_notice("Led_Server has no base for delta frame %u", sequence);
+                    status = LED_ACK_STATUS_NO_BASE;
+                }
+                else
+                {
+                    // patch the base in place and apply it like a keyframe, the frame is never rebuilt
+                    Led_Codec::led_frame_view_t view = {led_count, base_colors};
+
+                    Led_Delta::apply(delta, delta_size, base_colors, led_count);
+                    apply_view(view);
+                    connection.set_delta_base(sequence, base_colors, led_count);
+
+                    Led_Codec::encode_header_into(led_count, frame_header, sizeof(frame_header));
+                    frame_checksum = Led_Message::checksum(frame_header, sizeof(frame_header));
+                    frame_checksum = Led_Message::checksum(reinterpret_cast<const uint8_t*>(base_colors),
+                            led_count * sizeof(Led_Strip::led_color_t), frame_checksum);
+                    inc_receive_message_count();
+                }
+            }
+            catch (const std::runtime_error& e)
+            {
+                dbg_error("Led_Server rejected delta frame %u: %s", sequence, e.what());
+                connection.clear_delta_base();
+                status = LED_ACK_STATUS_INVALID;
+            }
+
+            // acked with the checksum of the full frame, the client compares it with the strip it sent
+            ack_size = Led_Message::encode_ack_into(sequence, status, frame_checksum, ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_COMPACT:
+        {
+            const uint8_t *compact = msg_header->msg_data;
+            size_t compact_size = Led_Message::get_payload_size(msg_header);
+            Led_Frame_Pool::Buffer led_frame = frame_pool.acquire();
+            uint32_t frame_checksum = 0;
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            try
+            {
+                // expand straight into the colors of a frame buffer, then apply it like a keyframe
+                Led_Strip::led_color_t *led_colors = reinterpret_cast<Led_Strip::led_color_t*>(led_frame.data() + sizeof(Led_Strip::led_net_t));
+                uint32_t led_count = Led_Compact::decode_into(compact, compact_size, led_colors,
+                        (led_frame.capacity() - sizeof(Led_Strip::led_net_t)) / sizeof(Led_Strip::led_color_t));
+                size_t frame_size = Led_Codec::get_frame_size(led_count);
+
+                Led_Codec::encode_header_into(led_count, led_frame.data(), led_frame.capacity());
+
+                apply_frame(led_frame.data(), frame_size);
+                connection.set_delta_base(sequence, led_colors, led_count);
+                frame_checksum = Led_Message::checksum(led_frame.data(), frame_size);
+                inc_receive_message_count();
+            }
+            catch (const std::runtime_error& e)
+            {
+                dbg_error("Led_Server rejected compact frame %u: %s", sequence, e.what());
+                connection.clear_delta_base();
+                status = LED_ACK_STATUS_INVALID;
+            }
+
+            // acked with the checksum of the full frame, like a delta
+            ack_size = Led_Message::encode_ack_into(sequence, status, frame_checksum, ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_SAME:
+        {
+            const Led_Message::led_same_t *same = reinterpret_cast<const Led_Message::led_same_t*>(msg_header->msg_data);
+            uint64_t frame_hash = 0;
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            if (Led_Message::get_payload_size(msg_header) != sizeof(Led_Message::led_same_t))
+            {
+                dbg_error("Led_Server rejected same frame %u: %zu byte payload", sequence, Led_Message::get_payload_size(msg_header));
+                status = LED_ACK_STATUS_INVALID;
+            }
+            else
+            {
+                // nothing to decode or write - only confirm the strip still shows that frame
+                frame_hash = be64toh(same->same_frame_hash);
+                if (is_applied_frame(frame_hash))
+                {
+                    duplicate_frame_count++;
+                    inc_receive_message_count();
+                }
+                else
+                {
+                    dbg_notice("Led_Server applied frame changed before same frame %u", sequence);
+                    status = LED_ACK_STATUS_NO_BASE;
+                }
+            }
+
+            ack_size = Led_Message::encode_ack_into(sequence, status, status == LED_ACK_STATUS_OK ? Led_Message::fold_hash(frame_hash) : 0,
+                    ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_PRESET:
+        {
+            const Led_Message::led_preset_msg_t *preset = reinterpret_cast<const Led_Message::led_preset_msg_t*>(msg_header->msg_data);
+            const uint8_t *led_frame;
+            size_t frame_size;
+            uint32_t preset_id = 0;
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            if (Led_Message::get_payload_size(msg_header) != sizeof(Led_Message::led_preset_msg_t))
+            {
+                dbg_error("Led_Server rejected preset message %u: %zu byte payload", sequence, Led_Message::get_payload_size(msg_header));
+                status = LED_ACK_STATUS_INVALID;
+            }
+            else
+            {
+                // applied straight from the mapping, the client does not know the colors so no delta base is kept
+                preset_id = ntohl(preset->preset_id);
+                connection.clear_delta_base();
+
+                try
+                {
+                    if (!preset_store || !preset_store->find_preset(preset_id, &led_frame, &frame_size))
+                    {
+                        dbg_notice("Led_Server has no preset %u for message %u", preset_id, sequence);
+                        status = LED_ACK_STATUS_NOT_FOUND;
+                    }
+                    else
+                    {
+                        apply_frame(led_frame, frame_size);
+                        inc_receive_message_count();
+                    }
+                }
+                catch (const std::runtime_error& e)
+                {
+                    dbg_error("Led_Server rejected preset %u in message %u: %s", preset_id, sequence, e.what());
+                    status = LED_ACK_STATUS_INVALID;
+                }
+            }
+
+            // acked with the preset id instead of a checksum
+            ack_size = Led_Message::encode_ack_into(sequence, status, preset_id, ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_MULTI:
+        {
+            const uint8_t *multi = msg_header->msg_data;
+            size_t multi_size = Led_Message::get_payload_size(msg_header);
+            Led_Multi::led_strip_view_t strip_views[LED_MAX_STRIPS];
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            try
+            {
+                // every sub-frame is validated in one pass before any strip changes
+                uint32_t strip_count = Led_Multi::decode(multi, multi_size, strip_views, LED_MAX_STRIPS);
+
+                apply_strips(strip_views, strip_count);
+
+                // strip 0 may have changed under the single strip delta base
+                connection.clear_delta_base();
+                inc_receive_message_count();
+            }
+            catch (const std::runtime_error& e)
+            {
+                dbg_error("Led_Server rejected multi-strip frame %u: %s", sequence, e.what());
+                status = LED_ACK_STATUS_INVALID;
+            }
+
+            // acked with the checksum of the whole payload
+            ack_size = Led_Message::encode_ack_into(sequence, status, status == LED_ACK_STATUS_OK ? Led_Message::checksum(multi, multi_size) : 0,
+                    ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        case LED_MSG_TYPE_TIMELINE:
+        {
+            const uint8_t *timeline = msg_header->msg_data;
+            size_t timeline_size = Led_Message::get_payload_size(msg_header);
+            Led_Timeline::led_timeline_view_t frame_views[LED_TIMELINE_MAX_FRAMES];
+            std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            uint32_t timeline_flags = 0;
+            uint32_t status = LED_ACK_STATUS_OK;
+
+            try
+            {
+                // every frame is validated in one pass before any is queued
+                uint32_t frame_count = Led_Timeline::decode(timeline, timeline_size, &timeline_flags, frame_views, LED_TIMELINE_MAX_FRAMES);
+
+                if (!playout_queue)
+                {
+                    dbg_error("Led_Server has no playout queue for timeline %u", sequence);
+                    status = LED_ACK_STATUS_UNSUPPORTED;
+                }
+                else if (timeline_flags & LED_TIMELINE_FLAG_CONTINUE)
+                {
+                    // played relative to the start of the previous timeline of this session
+                    if (!connection.get_timeline_start(&start_time))
+                    {
+                        dbg_notice("Led_Server has no timeline for continued timeline %u", sequence);
+                        status = LED_ACK_STATUS_NO_BASE;
+                    }
+                }
+                else
+                {
+                    // a new animation replaces the frames still waiting
+                    connection.set_timeline_start(start_time);
+                    playout_dropped_count += playout_queue->clear();
+                }
+
+                if (status == LED_ACK_STATUS_OK)
+                {
+                    for (uint32_t i = 0; i < frame_count; i++)
+                    {
+                        if (!playout_queue->push(start_time + std::chrono::microseconds(frame_views[i].offset_us),
+                                frame_views[i].led_frame, frame_views[i].frame_size))
+                        {
+                            playout_dropped_count++;
+                        }
+                    }
+
+                    // the strip changes later, without a base the client can rely on
+                    connection.clear_delta_base();
+                    inc_receive_message_count();
+                }
+            }
+            catch (const std::runtime_error& e)
+            {
+                dbg_error("Led_Server rejected timeline %u: %s", sequence, e.what());
+                status = LED_ACK_STATUS_INVALID;
+            }
+
+            // acked with the checksum of the whole payload once queued, not once shown
+            ack_size = Led_Message::encode_ack_into(sequence, status, status == LED_ACK_STATUS_OK ? Led_Message::checksum(timeline, timeline_size) : 0,
+                    ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+
+        default:
+        {
+            dbg_error("Led_Server received unsupported message type %d", (int)msg_header->msg_type);
+            ack_size = Led_Message::encode_ack_into(sequence, LED_ACK_STATUS_UNSUPPORTED, 0, ack_message, sizeof(ack_message));
+            connection.queue_send(ack_message, ack_size);
+            inc_send_message_count();
+            break;
+        }
+    }
+}
+
+Led_Codec::led_frame_view_t Led_Server::apply_frame(const uint8_t *led_frame, size_t frame_size, uint32_t strip_id)
+{
+    // validate in place, throws on an invalid frame
+    Led_Codec::led_frame_view_t view = Led_Codec::decode_view(led_frame, frame_size);
+
+    apply_view(view, strip_id);
+
+    return view;
+}
+
+void Led_Server::apply_view(const Led_Codec::led_frame_view_t &view, uint32_t strip_id)
+{
+    led_strip_output_t &output = strip_outputs[strip_id];
+    uint64_t frame_hash = Led_Codec::get_frame_hash(view);
+
+    // a resent static scene - the strip already shows it
+    {
+        std::lock_guard<std::mutex> lock(output.applied_mutex);
+
+        if (output.applied_valid && output.applied_hash == frame_hash)
+        {
+            duplicate_frame_count++;
+            return;
+        }
+
+        output.applied_hash = frame_hash;
+        output.applied_valid = true;
+
+        // published under the lock, the output buffers take one producer at a time
+        if (strip_id == 0 && output_frames)
+        {
+            output_frames->publish(view);
+        }
+    }
+    output.frame_count++;
+
+    if (debug_mode >= DEBUG_VERBOSE)
+    {
+        std::vector<uint8_t> led_frame(Led_Codec::get_frame_size(view.led_count));
+        Led_Strip client_leds(0);
+
+        Led_Codec::encode_into(view.led_colors, view.led_count, led_frame.data(), led_frame.size());
+        client_leds.set_leds_from_frame(led_frame.data(), led_frame.size());
+        printf("converted configuration client: \n");
+        client_leds.print_all_leds();
+    }
+}
+
+bool Led_Server::is_applied_frame(uint64_t frame_hash)
+{
+    std::lock_guard<std::mutex> lock(strip_outputs[0].applied_mutex);
+
+    return strip_outputs[0].applied_valid && strip_outputs[0].applied_hash == frame_hash;
+}
+
+void Led_Server::apply_strips(const Led_Multi::led_strip_view_t *strip_views, uint32_t strip_count)
+{
+    // few strips are applied faster than the workers are woken
+    if (!dispatch_pool || strip_count < LED_DISPATCH_MIN_STRIPS)
+    {
+        for (uint32_t i = 0; i < strip_count; i++)
+        {
+            apply_frame(strip_views[i].led_frame, strip_views[i].frame_size, strip_views[i].strip_id);
+        }
+        return;
+    }
+
+    // each strip has its own output, no two tasks share one
+    dispatch_pool->run(strip_count, [this, strip_views](size_t i)
+    {
+        apply_frame(strip_views[i].led_frame, strip_views[i].frame_size, strip_views[i].strip_id);
+    });
+}
+
+void Led_Server::update_client_events(Led_Connection &connection)
+{
+    // only wait for writable sockets while a response is queued, stop reading until a backlog drained
+    if (connection.is_send_backlogged())
+    {
+        modify_event_fd(connection.get_fd(), EPOLLOUT);
+    }
+    else if (connection.has_pending_send())
+    {
+        modify_event_fd(connection.get_fd(), EPOLLIN | EPOLLOUT);
+    }
+    else
+    {
+        modify_event_fd(connection.get_fd(), EPOLLIN);
+    }
+}
+
+int Led_Server::get_next_timeout_ms()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point next_deadline;
+
+    // no clients - wait until a connection or stop request arrives
+    if (client_connections.empty() && !accept_paused)
+    {
+        return -1;
+    }
+
+    next_deadline = accept_paused ? accept_resume_time : client_connections.begin()->second->get_deadline();
+    for (auto &entry : client_connections)
+    {
+        next_deadline = std::min(next_deadline, entry.second->get_deadline());
+    }
+
+    if (next_deadline <= now)
+    {
+        return 0;
+    }
+
+    // round up so the deadline has passed when epoll_wait returns
+    return std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now).count() + 1;
+}
+
+void Led_Server::close_stalled_clients()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<int> stalled_clients;
+
+    for (auto &entry : client_connections)
+    {
+        if (entry.second->check_timeout(now))
+        {
+            stalled_clients.push_back(entry.first);
+        }
+    }
+
+    for (int client_fd : stalled_clients)
+    {
+        dbg_error("Led_Server client %d timed out", client_fd);
+        close_client(client_fd);
+    }
+}
+
+void Led_Server::close_client(int client_fd)
+{
+    if (uring)
+    {
+        // kernel still uses the connection buffers - shut the socket down so its operations
+        // complete, the last completion closes the client
+        auto operations = uring_operations.find(client_fd);
+        if (operations != uring_operations.end() && operations->second > 0)
+        {
+            if (uring_closing_fds.insert(client_fd).second)
+            {
+                shutdown(client_fd, SHUT_RDWR);
+            }
+            return;
+        }
+        uring_operations.erase(client_fd);
+        uring_closing_fds.erase(client_fd);
+        uring_paused_fds.erase(client_fd);
+    }
+    else
+    {
+        remove_event_fd(client_fd);
+    }
+
+    // connection destructor closes the socket
+    client_connections.erase(client_fd);
+
+    dbg_notice("Led_Server client disconnect");
+
+    // a descriptor is free again
+    resume_accept();
+}
+
+void Led_Server::close_all_clients()
+{
+    while (!client_connections.empty())
+    {
+        close_client(client_connections.begin()->first);
+    }
+}
+
+void Led_Server::handle_uring_completion(const struct io_uring_cqe &cqe)
+{
+    int completion_fd = (int)(uint32_t)cqe.user_data;
+
+    switch (cqe.user_data >> 32)
+    {
+        case LED_URING_OP_ACCEPT:
+        {
+            uring_accept_armed = false;
+            if (cqe.res >= 0)
+            {
+                add_uring_client(cqe.res);
+            }
+            else if (cqe.res != -ECANCELED && cqe.res != -ECONNABORTED && cqe.res != -EINTR)
+            {
+                // out of descriptors or memory - re-arming right away would fail again at once
+                dbg_error("Led_Server failed to handle client connection: %s (%d)", strerror(-cqe.res), -cqe.res);
+                pause_accept();
+                break;
+            }
+
+            if (server_is_running.load())
+            {
+                uring->prep_accept(socket_fd, cqe.user_data);
+                uring_accept_armed = true;
+            }
+            break;
+        }
+
+        case LED_URING_OP_WAKE:
+        {
+            // stop requested - loop condition is checked after handling completions
+            uring_wake_armed = false;
+            clear_wake_event();
+            if (server_is_running.load())
+            {
+                uring->prep_poll(wake_fd, POLLIN, cqe.user_data);
+                uring_wake_armed = true;
+            }
+            break;
+        }
+
+        case LED_URING_OP_RECV:
+        {
+            handle_uring_receive(completion_fd, cqe);
+            break;
+        }
+
+        case LED_URING_OP_SEND:
+        {
+            handle_uring_send(completion_fd, cqe);
+            break;
+        }
+
+        default:
+        {
+            // cancel requests and returned receive buffers only complete on failure
+            if (cqe.res < 0 && cqe.res != -ENOENT && cqe.res != -EALREADY)
+            {
+                dbg_notice("Led_Server io_uring operation failed: %s (%d)", strerror(-cqe.res), -cqe.res);
+            }
+            break;
+        }
+    }
+}
+
+void Led_Server::add_uring_client(int client_fd)
+{
+    // record the connection
+    dbg_notice("client connected to server");
+
+    // detect peers that vanish during a streaming session (unix sockets report this directly)
+    if (transport == LED_TRANSPORT_TCP)
+    {
+        enable_keepalive(client_fd);
+    }
+
+    // responses are submitted by the event loop instead of written directly
+    client_connections[client_fd] = std::unique_ptr<Led_Connection>(new Led_Connection(client_fd, frame_pool));
+    client_connections[client_fd]->set_deferred_send(true);
+    uring_operations[client_fd] = 0;
+    accepted_count++;
+
+    start_uring_receive(client_fd);
+}
+
+void Led_Server::handle_uring_receive(int client_fd, const struct io_uring_cqe &cqe)
+{
+    auto connection_entry = client_connections.find(client_fd);
+    const uint8_t *received = nullptr;
+    size_t received_size = 0;
+    size_t appended_size;
+
+    uring_operations[client_fd]--;
+
+    // already closed
+    if (connection_entry == client_connections.end())
+    {
+        uring->release_buffer(cqe);
+        return;
+    }
+
+    // shut down - data is dropped, nothing is re-armed and the last completion closes the client
+    if (uring_closing_fds.count(client_fd))
+    {
+        uring->release_buffer(cqe);
+        if (uring_operations[client_fd] == 0)
+        {
+            close_client(client_fd);
+        }
+        return;
+    }
+
+    Led_Connection &connection = *connection_entry->second;
+
+    try
+    {
+        // ENOBUFS - every pool buffer was in use, buffers released meanwhile make the retry succeed
+        if (cqe.res < 0 && cqe.res != -ENOBUFS)
+        {
+            std::ostringstream err_str;
+
+            err_str << "failed to receive: " << strerror(-cqe.res) << " (" << -cqe.res << ")";
+            throw std::runtime_error(err_str.str());
+        }
+
+        // copy out of the kernel buffer as far as the connection buffer allows, handle every complete
+        // message in place and repeat until the whole completion was consumed
+        if (cqe.res > 0)
+        {
+            received = uring->get_buffer(cqe);
+            received_size = cqe.res;
+        }
+
+        while (received_size > 0)
+        {
+            appended_size = connection.append_received(received, received_size);
+            received += appended_size;
+            received_size -= appended_size;
+
+            handle_received(connection);
+        }
+
+        start_uring_send(connection);
+    }
+    catch (const std::exception& e)
+    {
+        // drop the failed client but keep serving the others
+        dbg_error("Led_Server client %d failed: %s", client_fd, e.what());
+        uring->release_buffer(cqe);
+        close_client(client_fd);
+        return;
+    }
+
+    // everything was copied out, hand the buffer back to the kernel
+    uring->release_buffer(cqe);
+
+    // keep the session open until the peer closes it
+    if (cqe.res == 0 || !server_is_running.load())
+    {
+        close_client(client_fd);
+        return;
+    }
+
+    // backlogged - the receive is re-armed once the send completions drained it
+    if (connection.is_send_backlogged())
+    {
+        uring_paused_fds.insert(client_fd);
+        return;
+    }
+
+    start_uring_receive(client_fd);
+}
+
+void Led_Server::handle_uring_send(int client_fd, const struct io_uring_cqe &cqe)
+{
+    auto connection_entry = client_connections.find(client_fd);
+
+    uring_operations[client_fd]--;
+
+    // already closed
+    if (connection_entry == client_connections.end())
+    {
+        return;
+    }
+
+    // shut down - the rest is never sent, the last completion closes the client
+    if (uring_closing_fds.count(client_fd))
+    {
+        if (uring_operations[client_fd] == 0)
+        {
+            close_client(client_fd);
+        }
+        return;
+    }
+
+    if (cqe.res < 0)
+    {
+        dbg_error("Led_Server client %d failed to send: %s (%d)", client_fd, strerror(-cqe.res), -cqe.res);
+        close_client(client_fd);
+        return;
+    }
+
+    // submit the rest of a short send and anything queued meanwhile
+    connection_entry->second->complete_send(cqe.res);
+    start_uring_send(*connection_entry->second);
+
+    if (uring_paused_fds.count(client_fd) && !connection_entry->second->is_send_backlogged())
+    {
+        uring_paused_fds.erase(client_fd);
+        start_uring_receive(client_fd);
+    }
+}
+
+void Led_Server::start_uring_receive(int client_fd)
+{
+    uring->prep_recv(client_fd, LED_URING_USER_DATA(LED_URING_OP_RECV, client_fd));
+    uring_operations[client_fd]++;
+}
+
+void Led_Server::start_uring_send(Led_Connection &connection)
+{
+    const uint8_t *data;
+    size_t size;
+
+    // a shut down client only waits for its operations to complete
+    if (uring_closing_fds.count(connection.get_fd()))
+    {
+        return;
+    }
+
+    if (connection.start_send(&data, &size))
+    {
+        uring->prep_send(connection.get_fd(), data, size, LED_URING_USER_DATA(LED_URING_OP_SEND, connection.get_fd()));
+        uring_operations[connection.get_fd()]++;
+    }
+}
+
+void Led_Server::finish_uring_operations()
+{
+    struct io_uring_cqe cqe;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LED_MESSAGE_TIMEOUT_MS);
+    std::vector<int> client_fds;
+
+    // cancel the accept / stop operations and shut every client down, nothing is re-armed
+    // once server_is_running is false
+    server_is_running.store(false);
+    if (uring_accept_armed)
+    {
+        uring->prep_cancel(LED_URING_USER_DATA(LED_URING_OP_ACCEPT, socket_fd), LED_URING_USER_DATA(LED_URING_OP_CANCEL, socket_fd));
+    }
+
+    if (uring_wake_armed)
+    {
+        uring->prep_cancel(LED_URING_USER_DATA(LED_URING_OP_WAKE, wake_fd), LED_URING_USER_DATA(LED_URING_OP_CANCEL, wake_fd));
+    }
+
+    for (auto &entry : client_connections)
+    {
+        client_fds.push_back(entry.first);
+    }
+
+    for (int client_fd : client_fds)
+    {
+        close_client(client_fd);
+    }
+
+    // wait for the kernel to finish with every buffer it was given
+    while (uring_accept_armed || uring_wake_armed || !client_connections.empty())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            dbg_error("Led_Server io_uring operations did not complete");
+            break;
+        }
+
+        uring->submit_and_wait(1, LED_MESSAGE_POLL_TIME_MS);
+        while (uring->get_completion(cqe))
+        {
+            handle_uring_completion(cqe);
+        }
+    }
+
+    uring_operations.clear();
+    uring_closing_fds.clear();
+    uring_paused_fds.clear();
+}
+
+Led_Server_Nonblocking::Led_Server_Nonblocking(int port, led_transport_t transport)
+    : server(port, transport)
+    , socket_initialized(false)
+{
+}
+
+Led_Server_Nonblocking::Led_Server_Nonblocking(std::string socket_path)
+    : server(socket_path)
+    , socket_initialized(false)
+{
+}
+
+Led_Server_Nonblocking::~Led_Server_Nonblocking()
+{
+}
+
+void Led_Server_Nonblocking::set_shm_ring(std::string ring_name)
+{
+    server.set_shm_ring(ring_name);
+}
+
+void Led_Server_Nonblocking::set_preset_store(std::string file_path)
+{
+    server.set_preset_store(file_path);
+}
+
+void Led_Server_Nonblocking::set_dispatch_thread_count(int thread_count)
+{
+    server.set_dispatch_thread_count(thread_count);
+}
+
+void Led_Server_Nonblocking::set_pru_output(bool enable)
+{
+    server.set_pru_output(enable);
+}
+
+void Led_Server_Nonblocking::set_output_rate(uint32_t refresh_rate)
+{
+    server.set_output_rate(refresh_rate);
+}
+
+void Led_Server_Nonblocking::set_io_backend(led_io_backend_t io_backend)
+{
+    server.set_io_backend(io_backend);
+}
+
+led_io_backend_t Led_Server_Nonblocking::get_io_backend()
+{
+    return server.get_io_backend();
+}
+
+void Led_Server_Nonblocking::initialize()
+{
+    if (!socket_initialized)
+    {
+        server.initialize();
+
+        socket_initialized = true;
+    }
+}
+
+bool Led_Server_Nonblocking::get_server_is_running()
+{
+    return server.get_server_is_running();
+}
+
+int Led_Server_Nonblocking::get_accepted_count()
+{
+    return server.get_accepted_count();
+}
+
+int Led_Server_Nonblocking::get_dropped_count()
+{
+    return server.get_dropped_count();
+}
+
+int Led_Server_Nonblocking::get_duplicate_frame_count()
+{
+    return server.get_duplicate_frame_count();
+}
+
+int Led_Server_Nonblocking::get_strip_frame_count(uint32_t strip_id)
+{
+    return server.get_strip_frame_count(strip_id);
+}
+
+int Led_Server_Nonblocking::get_playout_late_count()
+{
+    return server.get_playout_late_count();
+}
+
+int Led_Server_Nonblocking::get_playout_dropped_count()
+{
+    return server.get_playout_dropped_count();
+}
+
+int Led_Server_Nonblocking::get_output_frame_count()
+{
+    return server.get_output_frame_count();
+}
+
+int Led_Server_Nonblocking::get_output_overwritten_count()
+{
+    return server.get_output_overwritten_count();
+}
+
+int Led_Server_Nonblocking::get_output_truncated_count()
+{
+    return server.get_output_truncated_count();
+}
+
+Led_Frame_Pacer::led_pacer_stats_t Led_Server_Nonblocking::get_output_pacer_stats()
+{
+    return server.get_output_pacer_stats();
+}
+
+int Led_Server_Nonblocking::get_send_message_count()
+{
+    return server.get_send_message_count();
+}
+
+int Led_Server_Nonblocking::get_receive_message_count()
+{
+    return server.get_receive_message_count();
+}
+
+int Led_Server_Nonblocking::get_frame_pool_hit_count()
+{
+    return server.get_frame_pool_hit_count();
+}
+
+int Led_Server_Nonblocking::get_frame_pool_miss_count()
+{
+    return server.get_frame_pool_miss_count();
 }
 
 void Led_Server_Nonblocking::start_server()
@@ -0,0 +1,208 @@
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "debug.h"
+#include "led_shm_ring.h"
+
+
+static long futex(std::atomic<uint32_t> *address, int op, uint32_t value, const struct timespec *timeout)
+{
+    // shared (not FUTEX_PRIVATE) - producer and consumer are different processes
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(address), op, value, timeout, nullptr, 0);
+}
+
+Led_Shm_Ring::Led_Shm_Ring(std::string name, bool create)
+    : ring_name(name)
+    , ring_owner(create)
+    , ring_fd(-1)
+    , ring(nullptr)
+{
+    void *ring_map;
+
+    ring_fd = shm_open(ring_name.c_str(), create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, (mode_t)0600);
+    if (ring_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Shm_Ring failed to open " << ring_name << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    if (create && ftruncate(ring_fd, sizeof(led_shm_ring_t)) != 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Shm_Ring failed to set size of " << ring_name << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        close(ring_fd);
+        shm_unlink(ring_name.c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    ring_map = mmap(0, sizeof(led_shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+    if (ring_map == MAP_FAILED)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Shm_Ring failed to map " << ring_name << ": " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        close(ring_fd);
+        if (create)
+        {
+            shm_unlink(ring_name.c_str());
+        }
+        throw std::runtime_error(err_str.str());
+    }
+    ring = static_cast<led_shm_ring_t*>(ring_map);
+
+    if (create)
+    {
+        // new segment is zero filled - publish layout once indexes are valid
+        ring->slot_count = LED_SHM_RING_SLOT_COUNT;
+        ring->slot_size = LED_SHM_RING_SLOT_SIZE;
+        ring->write_index.store(0);
+        ring->read_index.store(0);
+        ring->consumer_waiting.store(0);
+        ring->wake_sequence.store(0);
+        ring->ring_magic = LED_SHM_RING_MAGIC;
+    }
+    else if (ring->ring_magic != LED_SHM_RING_MAGIC || ring->slot_count != LED_SHM_RING_SLOT_COUNT || ring->slot_size != LED_SHM_RING_SLOT_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Shm_Ring " << ring_name << " has an incompatible layout";
+        dbg_error("%s", err_str.str().c_str());
+        munmap(ring, sizeof(led_shm_ring_t));
+        close(ring_fd);
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_notice("%s shared memory ring %s", create ? "created" : "attached", ring_name.c_str());
+}
+
+Led_Shm_Ring::~Led_Shm_Ring()
+{
+    if (ring != nullptr)
+    {
+        munmap(ring, sizeof(led_shm_ring_t));
+    }
+
+    if (ring_fd >= 0)
+    {
+        close(ring_fd);
+    }
+
+    if (ring_owner)
+    {
+        shm_unlink(ring_name.c_str());
+    }
+}
+
+bool Led_Shm_Ring::write_frame(const uint8_t *frame, size_t frame_size)
+{
+    uint32_t write_index = ring->write_index.load(std::memory_order_relaxed);
+    uint32_t read_index = ring->read_index.load(std::memory_order_acquire);
+    led_shm_slot_t *slot;
+
+    if (frame_size > LED_SHM_RING_SLOT_SIZE)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Shm_Ring frame is too long - " << frame_size << " bytes (maximum " << LED_SHM_RING_SLOT_SIZE << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::invalid_argument(err_str.str());
+    }
+
+    // full - consumer has not released the oldest slot yet
+    if ((write_index - read_index) >= LED_SHM_RING_SLOT_COUNT)
+    {
+        return false;
+    }
+
+    slot = &ring->slots[write_index & (LED_SHM_RING_SLOT_COUNT - 1)];
+    memcpy(slot->frame, frame, frame_size);
+    slot->frame_size = frame_size;
+
+    // publish the slot, seq_cst orders this store before the consumer_waiting load
+    ring->write_index.store(write_index + 1);
+
+    // only pay for a syscall when the consumer is asleep
+    if (ring->consumer_waiting.load())
+    {
+        wake();
+    }
+
+    return true;
+}
+
+bool Led_Shm_Ring::read_frame(std::vector<uint8_t> &frame)
+{
+    uint32_t read_index = ring->read_index.load(std::memory_order_relaxed);
+    uint32_t write_index = ring->write_index.load(std::memory_order_acquire);
+    led_shm_slot_t *slot;
+    uint32_t frame_size;
+
+    if (read_index == write_index)
+    {
+        return false;
+    }
+
+    slot = &ring->slots[read_index & (LED_SHM_RING_SLOT_COUNT - 1)];
+
+    // never trust the size written by another process
+    frame_size = std::min(slot->frame_size, (uint32_t)LED_SHM_RING_SLOT_SIZE);
+    frame.assign(slot->frame, slot->frame + frame_size);
+
+    // release the slot to the producer
+    ring->read_index.store(read_index + 1, std::memory_order_release);
+
+    return true;
+}
+
+uint32_t Led_Shm_Ring::get_wake_sequence()
+{
+    return ring->wake_sequence.load();
+}
+
+void Led_Shm_Ring::wait_frame(uint32_t wake_sequence, int timeout_ms)
+{
+    struct timespec timeout;
+
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    // announce sleep, then check again so a frame written in between is not missed
+    ring->consumer_waiting.store(1);
+    if (is_empty())
+    {
+        // returns immediately if wake_sequence changed since it was read
+        if (futex(&ring->wake_sequence, FUTEX_WAIT, wake_sequence, (timeout_ms < 0) ? nullptr : &timeout) < 0
+                && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            dbg_error("Led_Shm_Ring futex wait failed: %s (%d)", strerror(errno), errno);
+        }
+    }
+    ring->consumer_waiting.store(0);
+}
+
+void Led_Shm_Ring::wake()
+{
+    ring->wake_sequence++;
+    futex(&ring->wake_sequence, FUTEX_WAKE, 1, nullptr);
+}
+
+bool Led_Shm_Ring::is_empty()
+{
+    return (ring->read_index.load() == ring->write_index.load());
+}
@@ -0,0 +1,137 @@
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "debug.h"
+#include "led_codec.h"
+#include "led_timeline.h"
+
+
+size_t Led_Timeline::get_frame_size(uint32_t led_count)
+{
+    return sizeof(led_timeline_frame_t) + Led_Codec::get_frame_size(led_count);
+}
+
+size_t Led_Timeline::encode_into(const led_timeline_ref_t *frames, uint32_t frame_count, uint32_t flags, uint8_t *buffer, size_t buffer_size)
+{
+    led_timeline_t *timeline = reinterpret_cast<led_timeline_t*>(buffer);
+    size_t offset = sizeof(led_timeline_t);
+
+    if (frame_count < 1 || frame_count > LED_TIMELINE_MAX_FRAMES || buffer_size < sizeof(led_timeline_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "timeline of " << frame_count << " frames (range 1-" << LED_TIMELINE_MAX_FRAMES << ") in a "
+            << buffer_size << " byte buffer";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    timeline->timeline_frame_count = htonl(frame_count);
+    timeline->timeline_flags = htonl(flags);
+
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        led_timeline_frame_t *frame = reinterpret_cast<led_timeline_frame_t*>(&buffer[offset]);
+        uint32_t led_count = frames[i].leds->get_led_count();
+
+        if (buffer_size - offset < get_frame_size(led_count))
+        {
+            std::ostringstream err_str;
+
+            err_str << "timeline buffer too small - " << buffer_size << " bytes (frame " << i << " ends at "
+                << (offset + get_frame_size(led_count)) << ")";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        frame->frame_offset_us = htonl(frames[i].offset_us);
+        offset += sizeof(led_timeline_frame_t);
+        offset += Led_Codec::encode_into(frames[i].leds->get_led_colors(), led_count, &buffer[offset], buffer_size - offset);
+    }
+
+    return offset;
+}
+
+uint32_t Led_Timeline::decode(const uint8_t *timeline, size_t timeline_size, uint32_t *flags, led_timeline_view_t *frame_views, uint32_t max_frame_count)
+{
+    const led_timeline_t *timeline_header = reinterpret_cast<const led_timeline_t*>(timeline);
+    uint32_t frame_count;
+    uint32_t previous_offset_us = 0;
+    size_t offset = sizeof(led_timeline_t);
+
+    if (timeline_size < sizeof(led_timeline_t))
+    {
+        std::ostringstream err_str;
+
+        err_str << "timeline too small - " << timeline_size << " bytes";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    frame_count = ntohl(timeline_header->timeline_frame_count);
+    if (frame_count < 1 || frame_count > LED_TIMELINE_MAX_FRAMES || frame_count > max_frame_count)
+    {
+        std::ostringstream err_str;
+
+        err_str << "timeline has " << frame_count << " frames (range 1-" << std::min((uint32_t)LED_TIMELINE_MAX_FRAMES, max_frame_count) << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // one pass - each frame header gives the size of its frame and the offset of the next one
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        const led_timeline_frame_t *frame = reinterpret_cast<const led_timeline_frame_t*>(&timeline[offset]);
+        const Led_Strip::led_net_t *net_frame;
+        uint32_t offset_us;
+        uint32_t led_count;
+
+        if (timeline_size - offset < LED_TIMELINE_FRAME_HEADER_SIZE)
+        {
+            std::ostringstream err_str;
+
+            err_str << "timeline ends inside the header of frame " << i << " (" << timeline_size << " bytes)";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        offset_us = ntohl(frame->frame_offset_us);
+        net_frame = reinterpret_cast<const Led_Strip::led_net_t*>(frame->frame_data);
+        led_count = ntohl(net_frame->net_led_count);
+        if (offset_us < previous_offset_us || led_count > Led_Codec::get_max_led_count()
+                || timeline_size - offset < get_frame_size(led_count))
+        {
+            std::ostringstream err_str;
+
+            err_str << "timeline has an invalid frame " << i << " of " << led_count << " leds at " << offset_us
+                << " us (previous frame at " << previous_offset_us << " us)";
+            dbg_error("%s", err_str.str().c_str());
+            throw std::runtime_error(err_str.str());
+        }
+
+        // magic and size checked in place
+        Led_Codec::decode_view(frame->frame_data, Led_Codec::get_frame_size(led_count));
+
+        frame_views[i].offset_us = offset_us;
+        frame_views[i].led_frame = frame->frame_data;
+        frame_views[i].frame_size = Led_Codec::get_frame_size(led_count);
+        previous_offset_us = offset_us;
+        offset += get_frame_size(led_count);
+    }
+
+    if (offset != timeline_size)
+    {
+        std::ostringstream err_str;
+
+        err_str << "timeline has " << (timeline_size - offset) << " bytes after its last frame";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    *flags = ntohl(timeline_header->timeline_flags);
+
+    return frame_count;
+}
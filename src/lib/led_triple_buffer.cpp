@@ -0,0 +1,111 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "debug.h"
+#include "led_triple_buffer.h"
+
+
+static long futex(std::atomic<uint32_t> *address, int op, uint32_t value, const struct timespec *timeout)
+{
+    // the atomic has the size and layout of the 32-bit futex word
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(address), op, value, timeout, nullptr, 0);
+}
+
+Led_Triple_Buffer::Led_Triple_Buffer()
+    : back_index(0)
+    , front_index(1)
+    , ready_index(2)
+    , wake_sequence(0)
+    , consumer_waiting(0)
+    , publish_count(0)
+    , overwritten_count(0)
+{
+}
+
+void Led_Triple_Buffer::publish(const Led_Codec::led_frame_view_t &view)
+{
+    uint32_t previous_index;
+
+    buffers[back_index].assign(view.led_colors, view.led_colors + view.led_count);
+
+    // the filled buffer becomes the ready one, the previous ready buffer is written next
+    previous_index = ready_index.exchange(back_index | LED_TRIPLE_BUFFER_NEW);
+    back_index = previous_index & ~LED_TRIPLE_BUFFER_NEW;
+    publish_count++;
+
+    if (previous_index & LED_TRIPLE_BUFFER_NEW)
+    {
+        overwritten_count++;
+    }
+
+    // seq_cst exchange above orders the publish before this load, only pay for a syscall when the consumer is asleep
+    if (consumer_waiting.load())
+    {
+        wake();
+    }
+}
+
+bool Led_Triple_Buffer::take(Led_Codec::led_frame_view_t *view)
+{
+    uint32_t previous_index;
+
+    if (!(ready_index.load() & LED_TRIPLE_BUFFER_NEW))
+    {
+        return false;
+    }
+
+    // hand the front buffer back, it is written once the producer got through the back buffer
+    previous_index = ready_index.exchange(front_index);
+    front_index = previous_index & ~LED_TRIPLE_BUFFER_NEW;
+
+    view->led_count = buffers[front_index].size();
+    view->led_colors = buffers[front_index].data();
+
+    return true;
+}
+
+uint32_t Led_Triple_Buffer::get_wake_sequence()
+{
+    return wake_sequence.load();
+}
+
+void Led_Triple_Buffer::wait_frame(uint32_t wake_sequence_arg, int timeout_ms)
+{
+    struct timespec timeout;
+
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    // announce sleep, then check again so a frame published in between is not missed
+    consumer_waiting.store(1);
+    if (!(ready_index.load() & LED_TRIPLE_BUFFER_NEW))
+    {
+        // returns immediately if wake_sequence changed since it was read
+        if (futex(&wake_sequence, FUTEX_WAIT_PRIVATE, wake_sequence_arg, (timeout_ms < 0) ? nullptr : &timeout) < 0
+                && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            dbg_error("Led_Triple_Buffer futex wait failed: %s (%d)", strerror(errno), errno);
+        }
+    }
+    consumer_waiting.store(0);
+}
+
+void Led_Triple_Buffer::wake()
+{
+    wake_sequence++;
+    futex(&wake_sequence, FUTEX_WAKE_PRIVATE, 1, nullptr);
+}
+
+int Led_Triple_Buffer::get_publish_count()
+{
+    return publish_count.load();
+}
+
+int Led_Triple_Buffer::get_overwritten_count()
+{
+    return overwritten_count.load();
+}
@@ -0,0 +1,353 @@
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "debug.h"
+#include "led_uring.h"
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+Led_Uring::Led_Uring(unsigned queue_depth)
+    : ring_fd(-1)
+    , ring_ptr(MAP_FAILED)
+    , ring_size(0)
+    , sqes((struct io_uring_sqe*)MAP_FAILED)
+    , sqes_size(0)
+    , sqe_tail(0)
+    , buffer_pool(LED_URING_BUFFER_COUNT * LED_URING_BUFFER_SIZE)
+{
+    struct io_uring_params params = {};
+    struct io_uring_cqe cqe = {};
+    char *ring_base;
+
+    ring_fd = sys_io_uring_setup(queue_depth, &params);
+    if (ring_fd < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring failed to set up ring: " << strerror(errno) << " (" << errno << ")";
+        dbg_notice("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    // single mapping for both rings, poll armed sockets, timed waits and silent buffer returns
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL)
+            || !(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_CQE_SKIP))
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring kernel is missing required features (0x" << std::hex << params.features << ")";
+        dbg_notice("%s", err_str.str().c_str());
+        close_ring();
+        throw std::runtime_error(err_str.str());
+    }
+
+    ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+            params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ring_ptr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe*)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+    if (ring_ptr == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring failed to map rings: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        close_ring();
+        throw std::runtime_error(err_str.str());
+    }
+
+    ring_base = (char*)ring_ptr;
+    sq_head = (unsigned*)(ring_base + params.sq_off.head);
+    sq_tail = (unsigned*)(ring_base + params.sq_off.tail);
+    sq_array = (unsigned*)(ring_base + params.sq_off.array);
+    sq_mask = *(unsigned*)(ring_base + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    cq_head = (unsigned*)(ring_base + params.cq_off.head);
+    cq_tail = (unsigned*)(ring_base + params.cq_off.tail);
+    cq_mask = *(unsigned*)(ring_base + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*)(ring_base + params.cq_off.cqes);
+    sqe_tail = *sq_tail;
+
+    // hand the whole frame pool to the kernel and check it was accepted
+    prep_provide_buffers(buffer_pool.data(), LED_URING_BUFFER_COUNT, 0, 0);
+    submit_and_wait(1, -1);
+    if (!get_completion(cqe) || cqe.res < 0)
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring failed to provide receive buffers: " << strerror(-cqe.res) << " (" << -cqe.res << ")";
+        dbg_notice("%s", err_str.str().c_str());
+        close_ring();
+        throw std::runtime_error(err_str.str());
+    }
+
+    dbg_verbose("created io_uring %d (%u entries)", ring_fd, sq_entries);
+}
+
+Led_Uring::~Led_Uring()
+{
+    close_ring();
+}
+
+void Led_Uring::close_ring()
+{
+    if (sqes != MAP_FAILED)
+    {
+        munmap(sqes, sqes_size);
+        sqes = (struct io_uring_sqe*)MAP_FAILED;
+    }
+
+    if (ring_ptr != MAP_FAILED)
+    {
+        munmap(ring_ptr, ring_size);
+        ring_ptr = MAP_FAILED;
+    }
+
+    if (ring_fd >= 0)
+    {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+struct io_uring_sqe *Led_Uring::get_sqe()
+{
+    struct io_uring_sqe *sqe;
+
+    // submission ring full - hand the queued entries to the kernel first
+    if (is_submission_full())
+    {
+        submit_and_wait(0, 0);
+    }
+
+    // EBUSY - the completion ring overflowed and the kernel takes no entries until completions are
+    // reaped, move them aside for get_completion and submit again
+    if (is_submission_full())
+    {
+        reap_completions();
+        submit_and_wait(0, 0);
+    }
+
+    // an entry the kernel did not consume yet is never overwritten
+    if (is_submission_full())
+    {
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring submission ring full, " << sq_entries << " entries not consumed by the kernel";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    sqe = &sqes[sqe_tail & sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[sqe_tail & sq_mask] = sqe_tail & sq_mask;
+    sqe_tail++;
+
+    return sqe;
+}
+
+bool Led_Uring::is_submission_full()
+{
+    return (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries);
+}
+
+void Led_Uring::reap_completions()
+{
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        reaped_completions.push_back(cqes[head & cq_mask]);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+void Led_Uring::prep_accept(int fd, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+}
+
+void Led_Uring::prep_recv(int fd, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    // kernel picks a free buffer from the frame pool once data arrives
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->len = LED_URING_BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = LED_URING_BUFFER_GROUP;
+    sqe->user_data = user_data;
+}
+
+void Led_Uring::prep_send(int fd, const void *data, size_t size, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = size;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data;
+}
+
+void Led_Uring::prep_poll(int fd, uint32_t poll_events, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = poll_events;
+    sqe->user_data = user_data;
+}
+
+void Led_Uring::prep_cancel(uint64_t target_user_data, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target_user_data;
+    sqe->user_data = user_data;
+}
+
+void Led_Uring::prep_provide_buffers(uint8_t *buffers, unsigned count, unsigned first_id, uint8_t sqe_flags)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = count;
+    sqe->addr = (uint64_t)(uintptr_t)buffers;
+    sqe->len = LED_URING_BUFFER_SIZE;
+    sqe->off = first_id;
+    sqe->buf_group = LED_URING_BUFFER_GROUP;
+    sqe->flags = sqe_flags;
+    sqe->user_data = LED_URING_USER_DATA_NONE;
+}
+
+int Led_Uring::submit_and_wait(unsigned wait_count, int timeout_ms)
+{
+    struct io_uring_getevents_arg wait_arg = {};
+    struct __kernel_timespec wait_time = {};
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    unsigned to_submit;
+    int submitted;
+
+    // completions moved aside by get_sqe are already waiting
+    if (!reaped_completions.empty())
+    {
+        wait_count = 0;
+    }
+
+    // publish queued entries to the kernel
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+
+    if (wait_count > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    if (timeout_ms >= 0)
+    {
+        wait_time.tv_sec = timeout_ms / 1000;
+        wait_time.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        wait_arg.ts = (uint64_t)(uintptr_t)&wait_time;
+    }
+
+    // nothing to submit and no completion wanted
+    if (to_submit == 0 && wait_count == 0)
+    {
+        return 0;
+    }
+
+    submitted = sys_io_uring_enter(ring_fd, to_submit, wait_count, flags, &wait_arg, sizeof(wait_arg));
+    if (submitted < 0)
+    {
+        // timed out or interrupted - completions are checked by the caller either way
+        if (errno == ETIME || errno == EINTR || errno == EBUSY)
+        {
+            return 0;
+        }
+
+        std::ostringstream err_str;
+
+        err_str << "Led_Uring failed to submit: " << strerror(errno) << " (" << errno << ")";
+        dbg_error("%s", err_str.str().c_str());
+        throw std::runtime_error(err_str.str());
+    }
+
+    return submitted;
+}
+
+bool Led_Uring::get_completion(struct io_uring_cqe &cqe)
+{
+    unsigned head = *cq_head;
+
+    // completed before anything still in the ring
+    if (!reaped_completions.empty())
+    {
+        cqe = reaped_completions.front();
+        reaped_completions.pop_front();
+        return true;
+    }
+
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    cqe = cqes[head & cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+const uint8_t *Led_Uring::get_buffer(const struct io_uring_cqe &cqe)
+{
+    if (!(cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        return nullptr;
+    }
+
+    return &buffer_pool[(cqe.flags >> IORING_CQE_BUFFER_SHIFT) * LED_URING_BUFFER_SIZE];
+}
+
+void Led_Uring::release_buffer(const struct io_uring_cqe &cqe)
+{
+    unsigned buffer_id;
+
+    if (!(cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        return;
+    }
+
+    // submitted with the next batch, only a failure produces a completion
+    buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    prep_provide_buffers(&buffer_pool[buffer_id * LED_URING_BUFFER_SIZE], 1, buffer_id, IOSQE_CQE_SKIP_SUCCESS);
+}
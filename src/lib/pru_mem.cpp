@@ -5,6 +5,8 @@
 #include <inttypes.h>
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
+#include <thread>
 
 #include "pru_mem.h"
 #include "share.h"
@@ -14,11 +16,19 @@ PruMem::PruMem(const void *addr)
     : physical_addr(addr)
     , shared_mem_fd(-1)
     , shared_mem_map((volatile uint32_t*) MAP_FAILED)
+    , frame_sequence(0)
+    , write_buffer(-1)
+    , wait_count(0)
 {
     // create memory map
     allocate_mem(addr);
 }
 
+PruMem::~PruMem()
+{
+    deallocate_mem();
+}
+
 void PruMem::allocate_mem(const void *physical_addr)
 {
   // open shared memory file descriptor
@@ -83,58 +93,107 @@ void PruMem::deallocate_mem()
   }
 }
 
-void PruMem::write_mem_led_colors(uint32_t size, const char *buff)
+volatile uint32_t *PruMem::get_write_buffer()
+{
+    if (write_buffer < 0)
+    {
+        // the buffer not flipped to last, the PRU may still clock it out if the last frame is pending
+        uint32_t idle_buffer = (shared_mem_map[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] & 1) ^ 1;
+        uint32_t busy_word;
+        auto start = std::chrono::steady_clock::now();
+
+        // the last flip is visible before the PRU words are read (the PRU orders busy before its start word read)
+        __sync_synchronize();
+        busy_word = shared_mem_map[SHARED_MEM_LED_BUSY_OFFSET];
+        if (busy_word != shared_mem_map[SHARED_MEM_LED_DONE_OFFSET] && (busy_word & 1) == idle_buffer)
+        {
+            wait_count++;
+        }
+
+        while (busy_word != shared_mem_map[SHARED_MEM_LED_DONE_OFFSET] && (busy_word & 1) == idle_buffer)
+        {
+            if (std::chrono::steady_clock::now() - start > std::chrono::microseconds(SHARED_MEM_WAIT_TIMEOUT_US))
+            {
+                std::ostringstream err_str;
+
+                err_str << "PruMem PRU did not finish frame 0x" << std::hex << busy_word << " within " << std::dec << SHARED_MEM_WAIT_TIMEOUT_US << " us";
+                throw std::runtime_error(err_str.str());
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(SHARED_MEM_POLL_US));
+            busy_word = shared_mem_map[SHARED_MEM_LED_BUSY_OFFSET];
+        }
+
+        write_buffer = idle_buffer;
+    }
+
+    return shared_mem_map + SHARED_MEM_LED_BUFFER_OFFSET + write_buffer * SHARED_MEM_LED_BUFFER_SIZE;
+}
+
+void PruMem::write_mem_led_colors(const Led_Strip::led_color_t *led_colors, uint32_t led_count)
 {
-    if ((size + SHARED_MEM_LED_START_OFFSET) > getpagesize())
+    if (led_count > WS2812_LED_COUNT)
     {
         std::ostringstream err_str;
 
-        err_str << "PruMem::write_mem size " << size << " bytes is greater than allocated (" <<  getpagesize() << " bytes)";
+        err_str << "PruMem::write_mem_led_colors " << led_count << " leds is more than shared memory holds (" << WS2812_LED_COUNT << " leds)";
         throw std::invalid_argument(err_str.str());
     }
 
-    if (buff == nullptr)
+    // an empty strip has no colors to write
+    if (led_colors == nullptr && led_count > 0)
     {
         std::ostringstream err_str;
 
-        err_str << "PruMem::write_mem attempt to write null buffer";
+        err_str << "PruMem::write_mem_led_colors attempt to write null buffer";
         throw std::invalid_argument(err_str.str());
     }
 
-    // synchronize color values
-    char *shared_mem_bytes = (char*) shared_mem_map;
+    // whole words, the PRU reads one word per led
+    volatile uint32_t *led_words = get_write_buffer() + SHARED_MEM_LED_START_OFFSET;
 
-    // write the values before setting
-    for (uint32_t i = SHARED_MEM_LED_START_OFFSET; i < size; i++)
+    for (uint32_t i = 0; i < led_count; i++)
     {
-        shared_mem_bytes[i] = buff[i];
+        led_words[i] = SHARED_MEM_LED_WORD(led_colors[i].red, led_colors[i].green, led_colors[i].blue);
     }
 }
 
-void PruMem::write_mem_led_count(uint8_t led_count)
+void PruMem::write_mem_led_count(uint32_t led_count)
 {
-    // synchronize color values
-    char *shared_mem_bytes = (char*) shared_mem_map;
+    if (led_count > WS2812_LED_COUNT)
+    {
+        std::ostringstream err_str;
 
-    // set LED count
-    shared_mem_bytes[SHARED_MEM_LED_COUNT_OFFSET] = led_count;
+        err_str << "PruMem::write_mem_led_count " << led_count << " leds is more than shared memory holds (" << WS2812_LED_COUNT << " leds)";
+        throw std::invalid_argument(err_str.str());
+    }
 
+    // set LED count
+    get_write_buffer()[SHARED_MEM_LED_COUNT_OFFSET] = led_count;
 }
 
 void PruMem::write_mem_led_start()
 {
-    // synchronize color values
-    char *shared_mem_bytes = (char*) shared_mem_map;
+    // a start without count / colors flips to an idle buffer as well
+    get_write_buffer();
+
+    // volatile only orders the compiler, the barrier keeps the cpu from letting the flip pass the led words
+    __sync_synchronize();
 
-    // begin PRU program to configure colors currently in shared memory
-    shared_mem_bytes[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] = 1;
+    // begin PRU program on the written buffer, sequence stays within 31 bits and never 0
+    frame_sequence = (frame_sequence % 0x7fffffff) + 1;
+    shared_mem_map[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] = (frame_sequence << 1) | write_buffer;
+    write_buffer = -1;
 }
 
 void PruMem::write_mem_led_stop()
 {
-    // synchronize color values
-    char *shared_mem_bytes = (char*) shared_mem_map;
+    // no frame pending, the PRU finishes the frame it clocks out
+    shared_mem_map[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] = 0;
+    write_buffer = -1;
+}
 
-    // stop PRU program if writing to LEDs
-    shared_mem_bytes[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] = 0;
+int PruMem::get_wait_count()
+{
+    return wait_count;
 }
@@ -6,16 +6,25 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <fstream>
+#include <sys/resource.h>
 
 #include "unit_test.h"
 #include "led.h"
+#include "led_codec.h"
 #include "led_client.h"
 #include "led_server.h"
+#include "led_message.h"
+#include "led_shm_ring.h"
+#include "led_frame_pool.h"
+#include "share.h"
 #include "catch.hpp"
 
 // LED client/server test
 #define LOCAL_TEST_IP "127.0.0.1"
 #define LOCAL_TEST_PORT 1632
+#define LOCAL_TEST_SOCKET "led_test.sock"
+#define LOCAL_TEST_RING "/led_test_ring"
 
 void server_runner(Led_Server *test_server);
 std::future<void> start_test_server(Led_Server &test_server);
@@ -248,6 +257,1323 @@ TEST_CASE("Led_Server_Nonblocking accepts traffic", "[Led_Server_Nonblocking::Le
     REQUIRE(test_server.get_send_message_count() == 1);
 }
 
+TEST_CASE("Led_Server stops without waiting for a poll interval", "[Led_Server::stop_server]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+
+    // stop_server wakes the event loop through its eventfd instead of waiting for a poll timeout
+    auto stop_start = std::chrono::steady_clock::now();
+    stop_test_server(test_server, server_thread);
+    auto stop_time = std::chrono::steady_clock::now() - stop_start;
+
+    REQUIRE(stop_time < std::chrono::milliseconds(LED_MESSAGE_POLL_TIME_MS));
+}
+
+TEST_CASE("Led_Server serves other clients while one client is stalled", "[Led_Server::start_server]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    struct sockaddr_in server_addr = {};
+    int stalled_fd;
+
+    // connect a client that only sends part of a header and then stops
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(LOCAL_TEST_IP);
+    server_addr.sin_port = htons(LOCAL_TEST_PORT);
+    stalled_fd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(stalled_fd >= 0);
+    REQUIRE(connect(stalled_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0);
+    REQUIRE(send(stalled_fd, LED_MAGIC, LED_MAGIC_LEN, 0) == LED_MAGIC_LEN);
+
+    // a second client is served without waiting for the stalled client to time out
+    auto send_start = std::chrono::steady_clock::now();
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Strip client_leds(3, 255, 0, 255);
+        std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+        test_client.initialize();
+        test_client.send(client_message);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending alongside stalled client" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+    auto send_time = std::chrono::steady_clock::now() - send_start;
+
+    close(stalled_fd);
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(send_time < std::chrono::milliseconds(LED_MESSAGE_TIMEOUT_MS));
+    REQUIRE(test_server.get_receive_message_count() == 1);
+    REQUIRE(test_server.get_accepted_count() == 2);
+}
+
+TEST_CASE("Led_Server waits for descriptors instead of failing accept in a loop", "[Led_Server::accept_clients]")
+{
+    const led_io_backend_t io_backends[] = {LED_IO_BACKEND_EPOLL, LED_IO_BACKEND_URING};
+    const int client_count = 3;
+
+    for (led_io_backend_t io_backend : io_backends)
+    {
+        Led_Server test_server(LOCAL_TEST_PORT);
+        std::future<void> server_thread;
+        struct sockaddr_in server_addr = {};
+        struct rlimit fd_limit;
+        struct rlimit exhausted_limit;
+        int client_fds[client_count];
+        int accepted_count;
+        int free_fd;
+
+        test_server.set_io_backend(io_backend);
+        server_thread = start_test_server(test_server);
+
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = inet_addr(LOCAL_TEST_IP);
+        server_addr.sin_port = htons(LOCAL_TEST_PORT);
+        for (int i = 0; i < client_count; i++)
+        {
+            client_fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+            REQUIRE(client_fds[i] >= 0);
+        }
+
+        // every descriptor below the lowest free one is in use, the server cannot accept anything
+        free_fd = dup(0);
+        REQUIRE(free_fd >= 0);
+        close(free_fd);
+        REQUIRE(getrlimit(RLIMIT_NOFILE, &fd_limit) == 0);
+        exhausted_limit = fd_limit;
+        exhausted_limit.rlim_cur = free_fd;
+        REQUIRE(setrlimit(RLIMIT_NOFILE, &exhausted_limit) == 0);
+
+        for (int i = 0; i < client_count; i++)
+        {
+            REQUIRE(connect(client_fds[i], (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(setrlimit(RLIMIT_NOFILE, &fd_limit) == 0);
+        accepted_count = test_server.get_accepted_count();
+
+        // the queued clients are accepted once the backoff passed
+        auto start = std::chrono::steady_clock::now();
+        while (test_server.get_accepted_count() < client_count && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        for (int i = 0; i < client_count; i++)
+        {
+            close(client_fds[i]);
+        }
+        stop_test_server(test_server, server_thread);
+
+        // io_uring may still install one descriptor above the limit
+        REQUIRE(accepted_count < client_count);
+        REQUIRE(test_server.get_accepted_count() == client_count);
+    }
+}
+
+TEST_CASE("Led_Client streaming session sends many frames on one connection", "[Led_Client::set_streaming]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    const int frame_count = 10;
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.initialize();
+        for (int i = 0; i < frame_count; i++)
+        {
+            Led_Strip client_leds(3, i, 0, 255);
+            std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+            test_client.send(client_message);
+        }
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while streaming frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    // every frame was handled on the same connection
+    REQUIRE(test_server.get_receive_message_count() == frame_count);
+    REQUIRE(test_server.get_send_message_count() == frame_count);
+    REQUIRE(test_server.get_accepted_count() == 1);
+}
+
+TEST_CASE("Led_Client without streaming opens a connection per frame", "[Led_Client::send]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Strip client_leds(3, 255, 0, 255);
+        std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+        test_client.send(client_message);
+        test_client.send(client_message);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 2);
+    REQUIRE(test_server.get_accepted_count() == 2);
+}
+
+TEST_CASE("Led_Client pipelines frames within its window", "[Led_Client::send_pipelined]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    const int frame_count = 50;
+    const int window_size = 4;
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_window_size(window_size);
+        for (int i = 1; i <= frame_count; i++)
+        {
+            Led_Strip client_leds(3, i, 0, 255);
+            std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+            REQUIRE(test_client.send_pipelined(client_message) == (uint32_t)i);
+            REQUIRE(test_client.get_outstanding_count() <= window_size);
+        }
+
+        // every frame acknowledged once flushed
+        test_client.flush();
+        REQUIRE(test_client.get_outstanding_count() == 0);
+        REQUIRE(test_client.get_acked_sequence() == frame_count);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while pipelining frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == frame_count);
+    REQUIRE(test_server.get_accepted_count() == 1);
+}
+
+TEST_CASE("Led_Server acks rejected frames without closing the session", "[Led_Client::get_rejected_count]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+    Led_Strip client_leds(3, 255, 0, 255);
+    std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+    std::vector<uint8_t> bad_message = client_message;
+    bool rejected = false;
+
+    // led count no longer matches the payload
+    bad_message.pop_back();
+
+    test_client.set_streaming(true);
+    try
+    {
+        test_client.send(bad_message);
+    }
+    catch (const std::runtime_error& runtime_err)
+    {
+        rejected = true;
+    }
+
+    REQUIRE(rejected);
+    REQUIRE(test_client.get_rejected_count() == 1);
+    REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_INVALID);
+
+    // the same session keeps working, including the debug echo mode
+    try
+    {
+        test_client.send(client_message);
+        REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_OK);
+
+        test_client.set_echo(true);
+        test_client.send(client_message);
+        REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_OK);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error after rejected frame" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    test_client.close_connection();
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 2);
+    REQUIRE(test_server.get_accepted_count() == 1);
+}
+
+TEST_CASE("UDP Led_Server applies the newest frame and drops stale datagrams", "[Led_Server::receive_frame_datagrams]")
+{
+    Led_Server_Nonblocking test_server(LOCAL_TEST_PORT, LED_TRANSPORT_UDP);
+    Led_Strip client_leds(3, 255, 0, 255);
+    std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+    struct sockaddr_in server_addr = {};
+    int test_fd;
+
+    test_server.initialize();
+    test_server.start_server();
+    for (int i = 0; i < 30 && !test_server.get_server_is_running(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(test_server.get_server_is_running() == true);
+
+    // send sequence 10 followed by an older sequence 3 from the same socket
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(LOCAL_TEST_IP);
+    server_addr.sin_port = htons(LOCAL_TEST_PORT);
+    test_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    REQUIRE(test_fd >= 0);
+    REQUIRE(connect(test_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0);
+
+    std::vector<uint8_t> newer = Led_Message::create_frame(10, client_message);
+    std::vector<uint8_t> stale = Led_Message::create_frame(3, client_message);
+    REQUIRE(send(test_fd, newer.data(), newer.size(), 0) == (ssize_t)newer.size());
+    REQUIRE(send(test_fd, stale.data(), stale.size(), 0) == (ssize_t)stale.size());
+
+    // let the server handle both before the batch, otherwise all 7 may arrive in one recvmmsg
+    for (int i = 0; i < 100; i++)
+    {
+        if (test_server.get_receive_message_count() + test_server.get_dropped_count() == 2)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // a client batch of 5 frames is sent with a single sendmmsg
+    Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT, LED_TRANSPORT_UDP);
+    test_client.send_batch(std::vector<std::vector<uint8_t>>(5, client_message));
+
+    // wait for all 7 datagrams to be applied or dropped
+    for (int i = 0; i < 100; i++)
+    {
+        if (test_server.get_receive_message_count() + test_server.get_dropped_count() == 7)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    close(test_fd);
+    test_server.stop_server();
+
+    // stale sequence 3 is always dropped, the client batch is applied at least once (newest wins)
+    REQUIRE(test_server.get_receive_message_count() + test_server.get_dropped_count() == 7);
+    REQUIRE(test_server.get_dropped_count() >= 1);
+    REQUIRE(test_server.get_receive_message_count() >= 2);
+}
+
+TEST_CASE("UDP Led_Server accepts a sender that restarted its sequence", "[Led_Server::receive_frame_datagrams]")
+{
+    Led_Server_Nonblocking test_server(LOCAL_TEST_PORT, LED_TRANSPORT_UDP);
+    Led_Strip client_leds(3, 255, 0, 255);
+    std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+    struct sockaddr_in server_addr = {};
+    int test_fd;
+
+    // send one frame and wait until it was applied or dropped
+    auto send_sequence = [&](uint32_t sequence, int handled_count)
+    {
+        std::vector<uint8_t> message = Led_Message::create_frame(sequence, client_message);
+
+        REQUIRE(send(test_fd, message.data(), message.size(), 0) == (ssize_t)message.size());
+        for (int i = 0; i < 100; i++)
+        {
+            if (test_server.get_receive_message_count() + test_server.get_dropped_count() == handled_count)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    test_server.initialize();
+    test_server.start_server();
+    for (int i = 0; i < 30 && !test_server.get_server_is_running(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(test_server.get_server_is_running() == true);
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(LOCAL_TEST_IP);
+    server_addr.sin_port = htons(LOCAL_TEST_PORT);
+    test_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    REQUIRE(test_fd >= 0);
+    REQUIRE(connect(test_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0);
+
+    // a small step back is reordering, a large one a restart of the sender
+    send_sequence(5000, 1);
+    send_sequence(4990, 2);
+    REQUIRE(test_server.get_dropped_count() == 1);
+    send_sequence(1, 3);
+    REQUIRE(test_server.get_receive_message_count() == 2);
+
+    // a sender silent for longer than the timeout starts over
+    std::this_thread::sleep_for(std::chrono::milliseconds(LED_UDP_SENDER_TIMEOUT_MS + 100));
+    send_sequence(1, 4);
+
+    close(test_fd);
+    test_server.stop_server();
+
+    REQUIRE(test_server.get_receive_message_count() == 3);
+    REQUIRE(test_server.get_dropped_count() == 1);
+}
+
+TEST_CASE("Led_Client can stream to Led_Server over a unix socket", "[Led_Client::bind_unix_socket]")
+{
+    Led_Server_Nonblocking test_server(LOCAL_TEST_SOCKET);
+
+    try
+    {
+        test_server.initialize();
+        test_server.start_server();
+        for (int i = 0; i < 30 && !test_server.get_server_is_running(); i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        Led_Client test_client(LOCAL_TEST_SOCKET);
+        Led_Strip client_leds(3, 255, 0, 255);
+        std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+        test_client.set_streaming(true);
+        test_client.send(client_message);
+        test_client.send(client_message);
+        test_client.close_connection();
+
+        test_server.stop_server();
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while using unix socket" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    REQUIRE(test_server.get_receive_message_count() == 2);
+    REQUIRE(test_server.get_accepted_count() == 1);
+}
+
+TEST_CASE("Led_Server io_uring backend serves streaming and pipelined clients", "[Led_Network::set_io_backend]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread;
+    struct sockaddr_in server_addr = {};
+    const int frame_count = 20;
+    int stalled_fd;
+
+    // falls back to epoll on kernels without io_uring, the clients are served either way
+    test_server.set_io_backend(LED_IO_BACKEND_URING);
+    server_thread = start_test_server(test_server);
+    std::cerr << "io backend: " << ((test_server.get_io_backend() == LED_IO_BACKEND_URING) ? "io_uring" : "epoll") << std::endl;
+
+    // a stalled client must not hold up the others
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(LOCAL_TEST_IP);
+    server_addr.sin_port = htons(LOCAL_TEST_PORT);
+    stalled_fd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(stalled_fd >= 0);
+    REQUIRE(connect(stalled_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0);
+    REQUIRE(send(stalled_fd, LED_MAGIC, LED_MAGIC_LEN, 0) == LED_MAGIC_LEN);
+
+    try
+    {
+        Led_Client streaming_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Client pipelined_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        streaming_client.set_streaming(true);
+        pipelined_client.set_window_size(8);
+        for (int i = 1; i <= frame_count; i++)
+        {
+            Led_Strip client_leds(3, i, 0, 255);
+            std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+            streaming_client.send(client_message);
+            pipelined_client.send_pipelined(client_message);
+        }
+
+        pipelined_client.flush();
+        REQUIRE(pipelined_client.get_acked_sequence() == frame_count);
+        streaming_client.close_connection();
+        pipelined_client.close_connection();
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending to io_uring server" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    // stop completes while the stalled client still has a receive outstanding
+    stop_test_server(test_server, server_thread);
+    close(stalled_fd);
+
+    REQUIRE(test_server.get_receive_message_count() == 2 * frame_count);
+    REQUIRE(test_server.get_send_message_count() == 2 * frame_count);
+    REQUIRE(test_server.get_accepted_count() == 3);
+}
+
+TEST_CASE("Led_Client sends a strip straight from its storage", "[Led_Client::send]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Strip client_leds(LED_MAX_COUNT, 0, 0, 255);
+    std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+    const int frame_count = 10;
+
+    // a frame checksummed in pieces matches the contiguous frame
+    REQUIRE(Led_Message::checksum(&client_message[LED_HEADER_SIZE], client_message.size() - LED_HEADER_SIZE,
+                Led_Message::checksum(client_message.data(), LED_HEADER_SIZE)) == Led_Message::checksum(client_message.data(), client_message.size()));
+
+    try
+    {
+        Led_Client streaming_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Client pipelined_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        // acks carry the checksum of the applied frame, a mismatch throws
+        streaming_client.set_streaming(true);
+        for (int i = 1; i <= frame_count; i++)
+        {
+            client_leds.set_led_color(i, i, i, i);
+            streaming_client.send(client_leds);
+            REQUIRE(pipelined_client.send_pipelined(client_leds) == (uint32_t)i);
+        }
+
+        pipelined_client.flush();
+        REQUIRE(pipelined_client.get_acked_sequence() == frame_count);
+
+        // echoed frames are validated as well
+        streaming_client.set_echo(true);
+        streaming_client.send(client_leds);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending strips" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 2 * frame_count + 1);
+}
+
+TEST_CASE("Led_Client zero copy sends wait for the kernel to release the strip", "[Led_Client::set_zerocopy]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Strip client_leds(LED_MAX_COUNT, 255, 0, 0);
+    const int frame_count = 10;
+    int zerocopy_send_count = 0;
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        // every message qualifies - the default threshold is larger than a single strip
+        test_client.set_zerocopy(true, 0);
+        test_client.set_streaming(true);
+        for (int i = 0; i < frame_count; i++)
+        {
+            // changing the strip right after send must not affect the acked frame
+            test_client.send(client_leds);
+            client_leds.set_all_leds(i, 0, 0);
+        }
+
+        zerocopy_send_count = test_client.get_zerocopy_send_count();
+        std::cerr << "zero copy sends: " << zerocopy_send_count << ", copied by kernel: " << test_client.get_zerocopy_copied_count() << std::endl;
+
+        // no socket support is not an error, the client copies instead
+        REQUIRE((zerocopy_send_count == frame_count || zerocopy_send_count == 0));
+        REQUIRE(test_client.get_zerocopy_copied_count() <= zerocopy_send_count);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending zero copy frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == frame_count);
+}
+
+TEST_CASE("Led_Client sends only the changed spans of a streamed strip", "[Led_Client::set_delta]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Strip client_leds(LED_MAX_COUNT, 0, 0, 0);
+    const int frame_count = 20;
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.set_delta(true);
+
+        // a moving dot - one keyframe, then deltas checked against the server's ack checksum
+        for (int i = 0; i < frame_count; i++)
+        {
+            client_leds.set_led_color(i, 255, 0, 0);
+            test_client.send(client_leds);
+        }
+        REQUIRE(test_client.get_keyframe_count() == 1);
+        REQUIRE(test_client.get_delta_frame_count() == frame_count - 1);
+
+        // every led changed - the delta would be larger
+        client_leds.set_all_leds(0, 255, 0);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_keyframe_count() == 2);
+
+        // a new session has no base on the server
+        test_client.close_connection();
+        client_leds.set_led_color(0, 0, 0, 255);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_keyframe_count() == 3);
+
+        client_leds.set_led_color(1, 0, 0, 255);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_delta_frame_count() == frame_count);
+        REQUIRE(test_client.get_rejected_count() == 0);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending delta frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == frame_count + 3);
+    REQUIRE(test_server.get_accepted_count() == 2);
+}
+
+TEST_CASE("Led_Client sends solid fills and ranges as compact frames", "[Led_Client::set_compact]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Strip client_leds(LED_MAX_COUNT, 0, 0, 0);
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.set_compact(true);
+
+        // solid fill and ranges - the server acks the checksum of the expanded frame
+        client_leds.set_all_leds(0, 255, 0);
+        test_client.send(client_leds);
+        client_leds.set_led_color_range(10, 99, 255, 0, 0);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_compact_frame_count() == 2);
+
+        // every led a different color goes out as a plain frame
+        for (uint32_t i = 0; i < LED_MAX_COUNT; i++)
+        {
+            client_leds.set_led_color(i, i, 0, 0);
+        }
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_compact_frame_count() == 2);
+
+        // pipelined, and combined with deltas - a changed range is cheaper as runs than as a span
+        client_leds.set_all_leds(0, 0, 255);
+        test_client.send_pipelined(client_leds);
+        test_client.flush();
+        REQUIRE(test_client.get_compact_frame_count() == 3);
+
+        test_client.set_delta(true);
+        test_client.send(client_leds);
+        client_leds.set_led_color_range(0, 199, 255, 255, 255);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_compact_frame_count() == 5);
+        REQUIRE(test_client.get_keyframe_count() == 2);
+
+        // a single led - the span is smaller than the runs
+        client_leds.set_led_color(220, 0, 0, 0);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_delta_frame_count() == 1);
+        REQUIRE(test_client.get_rejected_count() == 0);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending compact frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 7);
+}
+
+TEST_CASE("Led_Client resends an unchanged strip as its hash", "[Led_Client::set_dedup]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread = start_test_server(test_server);
+    Led_Strip client_leds(LED_MAX_COUNT, 0, 64, 0);
+    Led_Strip other_leds(LED_MAX_COUNT, 64, 0, 0);
+    std::vector<uint8_t> other_frame = other_leds.get_led_net_frame();
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Client other_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.set_dedup(true);
+
+        // a static scene refreshed for liveness
+        for (int i = 0; i < 5; i++)
+        {
+            test_client.send(client_leds);
+        }
+        REQUIRE(test_client.get_same_frame_count() == 4);
+
+        // another sender changed the strip - the hash is refused and the frame sent in full
+        other_client.send(other_frame);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_same_frame_count() == 4);
+
+        // a changed strip is sent in full, plain frames equal to the applied one are not applied again
+        client_leds.set_led_color(0, 1, 1, 1);
+        test_client.send(client_leds);
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_same_frame_count() == 5);
+        REQUIRE(test_client.get_rejected_count() == 0);
+
+        other_client.send(other_frame);
+        other_client.send(other_frame);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending unchanged frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 11);
+    REQUIRE(test_server.get_duplicate_frame_count() == 6);
+}
+
+TEST_CASE("Led_Client activates presets from the server's store", "[Led_Client::activate_preset]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    Led_Strip preset_leds(100, 0, 0, 64);
+    Led_Strip client_leds(100, 0, 0, 64);
+    std::future<void> server_thread;
+
+    preset_leds.save_all_leds("./test_preset_blue.dat");
+    Led_Preset_Store::create("./test_presets_server.dat", {{42, "blue", "./test_preset_blue.dat"}});
+
+    try
+    {
+        test_server.set_preset_store("./test_presets_server.dat");
+        server_thread = start_test_server(test_server);
+
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.set_delta(true);
+        test_client.set_dedup(true);
+        test_client.activate_preset(42);
+
+        // unknown presets are reported, the session keeps going
+        REQUIRE_THROWS_AS(test_client.activate_preset(43), std::runtime_error);
+        REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_NOT_FOUND);
+
+        // the strip already shows these colors, but the client never sent them - no hash or delta
+        test_client.send(client_leds);
+        REQUIRE(test_client.get_same_frame_count() == 0);
+        REQUIRE(test_client.get_delta_frame_count() == 0);
+        REQUIRE(test_client.get_rejected_count() == 1);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while activating presets" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 2);
+    REQUIRE(test_server.get_duplicate_frame_count() == 1);
+}
+
+TEST_CASE("Led_Client sends several strips in one multi-strip frame", "[Led_Client::send_strips]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::vector<Led_Strip> strips;
+    std::vector<Led_Multi::led_strip_ref_t> strip_refs;
+    std::future<void> server_thread;
+
+    for (uint32_t i = 0; i < LED_MAX_STRIPS; i++)
+    {
+        strips.push_back(Led_Strip(LED_MAX_COUNT, i, 0, 255));
+    }
+    for (uint32_t i = 0; i < LED_MAX_STRIPS; i++)
+    {
+        strip_refs.push_back({i, &strips[i]});
+    }
+
+    try
+    {
+        // workers even on a single core, so the strips are applied in parallel
+        test_server.set_dispatch_thread_count(3);
+        server_thread = start_test_server(test_server);
+
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        test_client.set_streaming(true);
+        test_client.set_delta(true);
+        test_client.send(strips[0]);
+
+        test_client.send_strips(strip_refs);
+
+        // only strip 2 changed - the others are duplicates
+        strips[2].set_led_color(0, 1, 2, 3);
+        test_client.send_strips(strip_refs);
+
+        // two strips, applied on the event loop
+        test_client.send_strips({{5, &strips[5]}, {6, &strips[2]}});
+
+        // a repeated strip id rejects the whole frame
+        REQUIRE_THROWS_AS(test_client.send_strips({{4, &strips[1]}, {4, &strips[2]}}), std::runtime_error);
+        REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_INVALID);
+        REQUIRE_THROWS_AS(test_client.send_strips({}), std::invalid_argument);
+
+        // strip 0 is still the single strip, the multi-strip frames reset its delta base
+        test_client.send(strips[0]);
+        REQUIRE(test_client.get_delta_frame_count() == 0);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending multi-strip frames" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_receive_message_count() == 5);
+    REQUIRE(test_server.get_strip_frame_count(0) == 1);
+    REQUIRE(test_server.get_strip_frame_count(2) == 2);
+    REQUIRE(test_server.get_strip_frame_count(4) == 1);
+    REQUIRE(test_server.get_strip_frame_count(5) == 1);
+    REQUIRE(test_server.get_strip_frame_count(6) == 2);
+    REQUIRE(test_server.get_duplicate_frame_count() == 10);
+}
+
+TEST_CASE("Led_Client uploads a timeline the server plays out on its own clock", "[Led_Client::send_timeline]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread;
+    std::vector<Led_Strip> strips;
+    std::vector<Led_Timeline::led_timeline_ref_t> frames;
+    std::vector<Led_Timeline::led_timeline_ref_t> later_frames;
+    const int frame_count = 100;
+
+    // more frames than fit one message, every frame differs
+    for (int i = 0; i < frame_count; i++)
+    {
+        strips.push_back(Led_Strip(LED_MAX_COUNT, i, 0, 255));
+    }
+    for (int i = 0; i < 90; i++)
+    {
+        frames.push_back({(uint32_t)i * 2000, &strips[i]});
+    }
+    for (int i = 90; i < frame_count; i++)
+    {
+        later_frames.push_back({(uint32_t)i * 2000, &strips[i]});
+    }
+
+    try
+    {
+        server_thread = start_test_server(test_server);
+
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Client other_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        auto start = std::chrono::steady_clock::now();
+
+        test_client.set_streaming(true);
+        test_client.send_timeline(frames);
+        test_client.send_timeline(later_frames, true);
+
+        // every frame is shown or counted as dropped (late and overtaken on a busy machine)
+        while (test_server.get_strip_frame_count(0) + test_server.get_playout_dropped_count() < frame_count
+                && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(198));
+        REQUIRE(test_server.get_strip_frame_count(0) + test_server.get_playout_dropped_count() == frame_count);
+
+        // a new timeline replaces frames still waiting
+        test_client.send_timeline({{10000000, &strips[0]}});
+        test_client.send_timeline({{0, &strips[1]}});
+        test_client.close_connection();
+        while (test_server.get_strip_frame_count(0) + test_server.get_playout_dropped_count() < frame_count + 2
+                && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // nothing to continue on a new session
+        REQUIRE_THROWS_AS(other_client.send_timeline({{0, &strips[2]}}, true), std::runtime_error);
+        REQUIRE(other_client.get_last_ack_status() == LED_ACK_STATUS_NO_BASE);
+        REQUIRE_THROWS_AS(other_client.send_timeline({}), std::invalid_argument);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending timelines" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_playout_dropped_count() >= 1);
+    REQUIRE(test_server.get_strip_frame_count(0) + test_server.get_playout_dropped_count() == frame_count + 2);
+    REQUIRE(test_server.get_playout_late_count() <= test_server.get_strip_frame_count(0));
+}
+
+TEST_CASE("Led_Server streams strips larger than its receive buffer", "[Led_Codec::set_max_led_count]")
+{
+    const led_io_backend_t io_backends[] = {LED_IO_BACKEND_EPOLL, LED_IO_BACKEND_URING};
+    const uint32_t large_led_count = 3000;
+
+    Led_Codec::set_max_led_count(large_led_count);
+
+    for (led_io_backend_t io_backend : io_backends)
+    {
+        Led_Server test_server(LOCAL_TEST_PORT);
+        std::future<void> server_thread;
+
+        test_server.set_io_backend(io_backend);
+        server_thread = start_test_server(test_server);
+
+        try
+        {
+            Led_Client streaming_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+            Led_Client pipelined_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+            Led_Client legacy_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+            Led_Strip large_leds(large_led_count, 0, 0, 255);
+
+            REQUIRE(Led_Codec::get_frame_size(large_led_count) > LED_FRAME_POOL_SLOT_SIZE);
+
+            // a keyframe streamed into the session strip, then a delta against it
+            streaming_client.set_streaming(true);
+            streaming_client.set_delta(true);
+            streaming_client.send(large_leds);
+            large_leds.set_led_color(large_led_count - 1, 1, 2, 3);
+            streaming_client.send(large_leds);
+            REQUIRE(streaming_client.get_delta_frame_count() == 1);
+
+            // back to back streams, compact frames are not used above the buffer size
+            pipelined_client.set_compact(true);
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                large_leds.set_led_color(i, i, i, i);
+                pipelined_client.send_pipelined(large_leds);
+            }
+            pipelined_client.flush();
+            REQUIRE(pipelined_client.get_rejected_count() == 0);
+            REQUIRE(pipelined_client.get_compact_frame_count() == 0);
+
+            // echoed in full from the session strip
+            large_leds.set_led_color(large_led_count / 2, 4, 5, 6);
+            std::vector<uint8_t> client_message = large_leds.get_led_net_frame();
+            legacy_client.send(client_message);
+
+            streaming_client.close_connection();
+            pipelined_client.close_connection();
+
+            // multi-strip frames still have to fit the buffer
+            REQUIRE_THROWS_AS(streaming_client.send_strips({{0, &large_leds}}), std::invalid_argument);
+        }
+        catch (...)
+        {
+            std::cerr << "Unexpected error while streaming large strips" << std::endl;
+            Led_Codec::set_max_led_count(LED_MAX_COUNT);
+            REQUIRE(TEST_FAILS);
+        }
+
+        stop_test_server(test_server, server_thread);
+
+        REQUIRE(test_server.get_receive_message_count() == 6);
+        REQUIRE(test_server.get_strip_frame_count(0) == 6);
+    }
+
+    Led_Codec::set_max_led_count(LED_MAX_COUNT);
+}
+
+TEST_CASE("Led_Server writes the newest frame to the PRU from its output thread", "[Led_Server::set_pru_output]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread;
+    const int frame_count = 50;
+
+    // every applied frame is written or replaced by a newer one, the last one is always written
+    auto wait_output = [&test_server]
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        while (test_server.get_output_frame_count() + test_server.get_output_overwritten_count() < test_server.get_strip_frame_count(0)
+                && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    auto read_pru_mem = []
+    {
+        std::ifstream pru_file(SHARED_MEM_MAP_FILE, std::ios::binary);
+        std::vector<uint32_t> pru_words(SHARED_MEM_SIZE / sizeof(uint32_t));
+
+        // the buffer flipped to last
+        pru_file.read((char*)pru_words.data(), SHARED_MEM_SIZE);
+        REQUIRE(pru_words[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] != 0);
+        uint32_t buffer_offset = SHARED_MEM_LED_BUFFER_OFFSET + (pru_words[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] & 1) * SHARED_MEM_LED_BUFFER_SIZE;
+
+        return std::vector<uint32_t>(pru_words.begin() + buffer_offset, pru_words.begin() + buffer_offset + SHARED_MEM_LED_BUFFER_SIZE);
+    };
+
+    test_server.set_pru_output(true);
+    server_thread = start_test_server(test_server);
+    REQUIRE_THROWS_AS(test_server.set_pru_output(false), std::runtime_error);
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+        // a burst of strips longer than the PRU drives
+        test_client.set_streaming(true);
+        for (int i = 0; i < frame_count; i++)
+        {
+            Led_Strip burst_leds(LED_MAX_COUNT, i, 0, 255);
+
+            test_client.send_pipelined(burst_leds);
+        }
+        test_client.flush();
+        wait_output();
+        REQUIRE(read_pru_mem()[SHARED_MEM_LED_COUNT_OFFSET] == WS2812_LED_COUNT);
+
+        Led_Strip short_leds(5, 1, 2, 3);
+        test_client.send(short_leds);
+        test_client.close_connection();
+        wait_output();
+        REQUIRE(read_pru_mem()[SHARED_MEM_LED_COUNT_OFFSET] == 5);
+        REQUIRE(read_pru_mem()[SHARED_MEM_LED_START_OFFSET + 4] == SHARED_MEM_LED_WORD(1, 2, 3));
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while writing PRU output" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_strip_frame_count(0) == frame_count + 1);
+    REQUIRE(test_server.get_output_frame_count() >= 2);
+    REQUIRE(test_server.get_output_frame_count() + test_server.get_output_overwritten_count() == frame_count + 1);
+    REQUIRE(test_server.get_output_truncated_count() == test_server.get_output_frame_count() - 1);
+}
+
+TEST_CASE("Led_Server writes empty frames to the PRU and keeps serving", "[Led_Server::set_pru_output]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread;
+    std::vector<uint8_t> empty_frame(LED_HEADER_SIZE);
+
+    auto wait_output = [&test_server](int output_frame_count)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        while (test_server.get_output_frame_count() < output_frame_count && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    auto read_led_count = []
+    {
+        std::ifstream pru_file(SHARED_MEM_MAP_FILE, std::ios::binary);
+        std::vector<uint32_t> pru_words(SHARED_MEM_SIZE / sizeof(uint32_t));
+
+        pru_file.read((char*)pru_words.data(), SHARED_MEM_SIZE);
+        uint32_t buffer_offset = SHARED_MEM_LED_BUFFER_OFFSET + (pru_words[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] & 1) * SHARED_MEM_LED_BUFFER_SIZE;
+
+        return pru_words[buffer_offset + SHARED_MEM_LED_COUNT_OFFSET];
+    };
+
+    test_server.set_pru_output(true);
+    server_thread = start_test_server(test_server);
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        Led_Strip client_leds(5, 1, 2, 3);
+
+        // a frame without leds is valid, the PRU shows the empty strip
+        Led_Codec::encode_header_into(0, empty_frame.data(), empty_frame.size());
+        test_client.set_streaming(true);
+        test_client.send_pipelined(empty_frame);
+        test_client.flush();
+        REQUIRE(test_client.get_last_ack_status() == LED_ACK_STATUS_OK);
+        wait_output(1);
+        REQUIRE(test_server.get_output_frame_count() == 1);
+        REQUIRE(read_led_count() == 0);
+
+        // the output thread is still running
+        test_client.send_pipelined(client_leds);
+        test_client.flush();
+        test_client.close_connection();
+        wait_output(2);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while sending an empty frame" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    REQUIRE(test_server.get_output_frame_count() == 2);
+    REQUIRE(read_led_count() == 5);
+    REQUIRE(test_server.get_dropped_count() == 0);
+}
+
+TEST_CASE("Led_Server paces PRU output and latches the newest frame each tick", "[Led_Server::set_output_rate]")
+{
+    Led_Server test_server(LOCAL_TEST_PORT);
+    std::future<void> server_thread;
+    const int frame_count = 50;
+
+    REQUIRE_THROWS_AS(test_server.set_output_rate(Led_Frame_Pacer::get_max_refresh_rate() + 1), std::runtime_error);
+    test_server.set_pru_output(true);
+    test_server.set_output_rate(100);
+    server_thread = start_test_server(test_server);
+
+    try
+    {
+        Led_Client test_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+        auto start = std::chrono::steady_clock::now();
+
+        // a burst, far faster than 100 frames per second
+        test_client.set_streaming(true);
+        for (int i = 0; i < frame_count; i++)
+        {
+            Led_Strip burst_leds(WS2812_LED_COUNT, i, 0, 255);
+
+            test_client.send_pipelined(burst_leds);
+        }
+        test_client.flush();
+        test_client.close_connection();
+
+        // every frame is written at a tick or coalesced into a later one
+        while (test_server.get_output_frame_count() + test_server.get_output_pacer_stats().coalesced_frame_count < frame_count
+                && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while pacing PRU output" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    stop_test_server(test_server, server_thread);
+
+    Led_Frame_Pacer::led_pacer_stats_t stats = test_server.get_output_pacer_stats();
+    REQUIRE(test_server.get_output_frame_count() + stats.coalesced_frame_count == frame_count);
+    REQUIRE(test_server.get_output_frame_count() <= stats.tick_count);
+    REQUIRE(stats.coalesced_frame_count >= 1);
+}
+
+TEST_CASE("Led_Frame_Pool falls back to the heap once every slot is in use", "[Led_Frame_Pool::acquire]")
+{
+    Led_Frame_Pool frame_pool(2);
+
+    {
+        Led_Frame_Pool::Buffer first = frame_pool.acquire();
+        Led_Frame_Pool::Buffer second = frame_pool.acquire();
+        Led_Frame_Pool::Buffer third = frame_pool.acquire();
+
+        REQUIRE(first.is_pooled() == true);
+        REQUIRE(second.is_pooled() == true);
+        REQUIRE(third.is_pooled() == false);
+        REQUIRE(third.capacity() == LED_FRAME_POOL_SLOT_SIZE);
+        REQUIRE(first.data() != second.data());
+        REQUIRE(frame_pool.get_free_count() == 0);
+
+        // a moved buffer is returned once
+        Led_Frame_Pool::Buffer moved = std::move(first);
+        REQUIRE(first.data() == nullptr);
+        REQUIRE(moved.is_pooled() == true);
+    }
+
+    // every slot is back, the next buffers come from the pool again
+    REQUIRE(frame_pool.get_free_count() == 2);
+    {
+        Led_Frame_Pool::Buffer reused = frame_pool.acquire();
+
+        REQUIRE(reused.is_pooled() == true);
+        reused.release();
+        REQUIRE(reused.data() == nullptr);
+    }
+
+    REQUIRE(frame_pool.get_hit_count() == 3);
+    REQUIRE(frame_pool.get_miss_count() == 1);
+    REQUIRE(frame_pool.get_free_count() == 2);
+}
+
+TEST_CASE("Led_Server and Led_Client recycle frame pool buffers", "[Led_Network::get_frame_pool_hit_count]")
+{
+    const led_io_backend_t io_backends[] = {LED_IO_BACKEND_EPOLL, LED_IO_BACKEND_URING};
+    const int frame_count = 20;
+
+    for (led_io_backend_t io_backend : io_backends)
+    {
+        Led_Server test_server(LOCAL_TEST_PORT);
+        std::future<void> server_thread;
+        int client_hit_count = 0;
+        int client_miss_count = 0;
+
+        test_server.set_io_backend(io_backend);
+        server_thread = start_test_server(test_server);
+
+        try
+        {
+            Led_Client streaming_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+            Led_Client pipelined_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+            Led_Client reconnecting_client(LOCAL_TEST_IP, LOCAL_TEST_PORT);
+
+            streaming_client.set_streaming(true);
+            pipelined_client.set_window_size(8);
+            for (int i = 1; i <= frame_count; i++)
+            {
+                // full size frames, a pipelined window never fits into one connection buffer
+                Led_Strip client_leds(LED_MAX_COUNT, i, 0, 255);
+                std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+                streaming_client.send(client_message);
+                pipelined_client.send_pipelined(client_message);
+                reconnecting_client.send(client_message);
+            }
+
+            pipelined_client.flush();
+            REQUIRE(pipelined_client.get_acked_sequence() == frame_count);
+            streaming_client.close_connection();
+            pipelined_client.close_connection();
+
+            client_hit_count = streaming_client.get_frame_pool_hit_count() + pipelined_client.get_frame_pool_hit_count()
+                + reconnecting_client.get_frame_pool_hit_count();
+            client_miss_count = streaming_client.get_frame_pool_miss_count() + pipelined_client.get_frame_pool_miss_count()
+                + reconnecting_client.get_frame_pool_miss_count();
+        }
+        catch (...)
+        {
+            std::cerr << "Unexpected error while recycling frame buffers" << std::endl;
+            REQUIRE(TEST_FAILS);
+        }
+
+        stop_test_server(test_server, server_thread);
+
+        REQUIRE(test_server.get_receive_message_count() == 3 * frame_count);
+
+        // one response buffer per frame on the clients (frames are gathered from their own storage),
+        // one buffer per connection on the server
+        REQUIRE(client_hit_count == 3 * frame_count);
+        REQUIRE(client_miss_count == 0);
+        REQUIRE(test_server.get_frame_pool_hit_count() == test_server.get_accepted_count());
+        REQUIRE(test_server.get_frame_pool_miss_count() == 0);
+    }
+}
+
+TEST_CASE("Led_Shm_Ring reports full instead of overwriting unread frames", "[Led_Shm_Ring::write_frame]")
+{
+    Led_Shm_Ring consumer(LOCAL_TEST_RING, true);
+    Led_Shm_Ring producer(LOCAL_TEST_RING, false);
+    Led_Strip client_leds(3, 255, 0, 255);
+    std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+    std::vector<uint8_t> received_message;
+
+    REQUIRE(consumer.read_frame(received_message) == false);
+
+    for (int i = 0; i < LED_SHM_RING_SLOT_COUNT; i++)
+    {
+        REQUIRE(producer.write_frame(client_message.data(), client_message.size()) == true);
+    }
+    REQUIRE(producer.write_frame(client_message.data(), client_message.size()) == false);
+
+    // consuming one frame frees one slot
+    REQUIRE(consumer.read_frame(received_message) == true);
+    REQUIRE(received_message == client_message);
+    REQUIRE(producer.write_frame(client_message.data(), client_message.size()) == true);
+}
+
+TEST_CASE("Led_Server consumes frames from a shared memory producer", "[Led_Shm_Producer::send]")
+{
+    Led_Server_Nonblocking test_server(LOCAL_TEST_PORT);
+    const int frame_count = 100;
+    int sent_count = 0;
+
+    try
+    {
+        test_server.set_shm_ring(LOCAL_TEST_RING);
+        test_server.initialize();
+        test_server.start_server();
+        for (int i = 0; i < 30 && !test_server.get_server_is_running(); i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        Led_Shm_Producer producer(LOCAL_TEST_RING);
+        Led_Strip client_leds(3, 255, 0, 255);
+        std::vector<uint8_t> client_message = client_leds.get_led_net_frame();
+
+        // retry while the ring is full
+        while (sent_count < frame_count)
+        {
+            if (producer.send(client_message))
+            {
+                sent_count++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        for (int i = 0; i < 100 && test_server.get_receive_message_count() < frame_count; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        test_server.stop_server();
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error while using shared memory ring" << std::endl;
+        REQUIRE(TEST_FAILS);
+    }
+
+    REQUIRE(test_server.get_receive_message_count() == frame_count);
+}
+
 #if 0
 TEST_CASE("Led_Client can connect to Led_Server_Nonblocking", "[Led_Client::send]")
 {
@@ -1,11 +1,37 @@
 #include <cstring>
+#include <algorithm>
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
 #include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
 
 #include "unit_test.h"
 #include "led.h"
+#include "led_codec.h"
+#include "led_delta.h"
+#include "led_compact.h"
+#include "led_preset_store.h"
+#include "led_multi.h"
+#include "led_message.h"
+#include "led_dispatch_pool.h"
+#include "led_timeline.h"
+#include "led_playout_queue.h"
+#include "led_triple_buffer.h"
+#include "pru_mem.h"
+#include "led_pru_sim.h"
+#include "led_frame_pacer.h"
+#include "led_connection.h"
+#include "led_uring.h"
+#include "share.h"
 #include "catch.hpp"
 
 TEST_CASE("LEDs are initialized to 255 for all values", "[LedStrip::constructor]")
@@ -380,3 +406,976 @@ TEST_CASE("get_led_net_frame returns matches set_led_net_frame", "[LedStrip::set
     }
 }
 
+
+TEST_CASE("encode_into writes the same frame as get_led_net_frame", "[Led_Codec::encode_into]")
+{
+    Led_Strip leds(12, 10, 20, 30);
+    std::vector<uint8_t> net_frame = leds.get_led_net_frame();
+    uint8_t buffer[LED_BUFFER_MAX_SIZE];
+    size_t frame_size;
+
+    frame_size = leds.encode_into(buffer, sizeof(buffer));
+    REQUIRE(frame_size == net_frame.size());
+    REQUIRE(frame_size == Led_Codec::get_frame_size(12));
+    REQUIRE(memcmp(buffer, net_frame.data(), frame_size) == 0);
+
+    // buffer must hold the whole frame
+    REQUIRE_THROWS_AS(leds.encode_into(buffer, frame_size - 1), std::runtime_error);
+}
+
+TEST_CASE("decode_view points into the received frame", "[Led_Codec::decode_view]")
+{
+    Led_Strip leds(5, 1, 2, 3);
+    std::vector<uint8_t> net_frame = leds.get_led_net_frame();
+    Led_Codec::led_frame_view_t view = Led_Codec::decode_view(net_frame.data(), net_frame.size());
+
+    // no copy - colors are read straight from the frame bytes
+    REQUIRE(view.led_count == 5);
+    REQUIRE((const uint8_t*)view.led_colors == &net_frame[LED_HEADER_SIZE]);
+    REQUIRE(view.led_colors[4].red == 1);
+    REQUIRE(view.led_colors[4].green == 2);
+    REQUIRE(view.led_colors[4].blue == 3);
+
+    // size must match the led count, magic must match
+    REQUIRE_THROWS_AS(Led_Codec::decode_view(net_frame.data(), net_frame.size() - 1), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Codec::decode_view(net_frame.data(), LED_HEADER_SIZE - 1), std::runtime_error);
+    net_frame[0] = 'X';
+    REQUIRE_THROWS_AS(Led_Codec::decode_view(net_frame.data(), net_frame.size()), std::runtime_error);
+}
+
+TEST_CASE("The led count limit can be raised for large strips", "[Led_Codec::set_max_led_count]")
+{
+    Led_Strip large_leds(3000, 1, 2, 3);
+    std::vector<uint8_t> net_frame;
+    const char *file_path = "./test_large_leds.dat";
+
+    large_leds.set_led_color(2999, 4, 5, 6);
+    large_leds.save_all_leds(file_path);
+    net_frame = large_leds.get_led_net_frame();
+
+    // refused with the default limit, when decoded and when loaded
+    REQUIRE(Led_Codec::get_max_led_count() == LED_MAX_COUNT);
+    REQUIRE_THROWS_AS(Led_Codec::decode_view(net_frame.data(), net_frame.size()), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Strip(file_path), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Codec::set_max_led_count(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(Led_Codec::set_max_led_count(LED_MAX_COUNT_LIMIT + 1), std::invalid_argument);
+
+    try
+    {
+        Led_Codec::set_max_led_count(3000);
+
+        Led_Codec::led_frame_view_t view = Led_Codec::decode_view(net_frame.data(), net_frame.size());
+        Led_Strip loaded_leds(file_path);
+
+        REQUIRE(view.led_count == 3000);
+        REQUIRE(loaded_leds.get_led_count() == 3000);
+        REQUIRE(loaded_leds.get_led_colors()[2999].blue == 6);
+
+        // messages grow with the limit, never below a full multi-strip frame
+        REQUIRE(Led_Message::get_max_message_size() == LED_MSG_HEADER_SIZE + net_frame.size());
+        Led_Codec::set_max_led_count(1);
+        REQUIRE(Led_Message::get_max_message_size() == LED_MSG_MAX_SIZE);
+    }
+    catch (...)
+    {
+        std::cerr << "Unexpected error with a raised led count limit" << std::endl;
+        Led_Codec::set_max_led_count(LED_MAX_COUNT);
+        REQUIRE(TEST_FAILS);
+    }
+
+    Led_Codec::set_max_led_count(LED_MAX_COUNT);
+}
+
+TEST_CASE("set_leds_from_frame leaves the strip unchanged on an invalid frame", "[LedStrip::set_leds_from_frame]")
+{
+    Led_Strip leds(3, 9, 9, 9);
+    Led_Strip source(7, 4, 5, 6);
+    std::vector<uint8_t> net_frame = source.get_led_net_frame();
+
+    REQUIRE_THROWS_AS(leds.set_leds_from_frame(net_frame.data(), net_frame.size() - 3), std::runtime_error);
+    REQUIRE(leds.get_led_count() == 3);
+
+    leds.set_leds_from_frame(net_frame.data(), net_frame.size());
+    REQUIRE(leds.get_led_count() == 7);
+    REQUIRE(leds.get_led_color(6)->blue == 6);
+}
+
+TEST_CASE("find_difference locates changes inside and across diff blocks", "[Led_Delta::find_difference]")
+{
+    std::vector<uint8_t> base(100, 7);
+    std::vector<uint8_t> frame(base);
+
+    REQUIRE(Led_Delta::find_difference(base.data(), frame.data(), 0, frame.size()) == frame.size());
+
+    // first byte, inside a later block, in the tail shorter than a block
+    const size_t changed_offsets[] = {0, 15, 16, 37, 95, 99};
+    for (size_t offset : changed_offsets)
+    {
+        frame = base;
+        frame[offset] = 8;
+        REQUIRE(Led_Delta::find_difference(base.data(), frame.data(), 0, frame.size()) == offset);
+        REQUIRE(Led_Delta::find_difference(base.data(), frame.data(), offset, frame.size()) == offset);
+        REQUIRE(Led_Delta::find_difference(base.data(), frame.data(), offset + 1, frame.size()) == frame.size());
+    }
+}
+
+TEST_CASE("Delta frames rebuild the strip they were encoded from", "[Led_Delta::encode_into]")
+{
+    Led_Strip base(LED_MAX_COUNT, 0, 0, 255);
+    Led_Strip leds(LED_MAX_COUNT, 0, 0, 255);
+    std::vector<Led_Strip::led_color_t> rebuilt(base.get_led_colors(), base.get_led_colors() + LED_MAX_COUNT);
+    uint8_t buffer[LED_BUFFER_MAX_SIZE];
+    size_t delta_size;
+
+    // separate runs, a gap short enough to merge, the last led
+    leds.set_led_color(0, 1, 1, 1);
+    leds.set_led_color_range(40, 49, 2, 2, 2);
+    leds.set_led_color(51, 3, 3, 3);
+    leds.set_led_color(LED_MAX_COUNT - 1, 4, 4, 4);
+
+    delta_size = Led_Delta::encode_into(42, base.get_led_colors(), leds.get_led_colors(), LED_MAX_COUNT, buffer, sizeof(buffer));
+    REQUIRE(delta_size > 0);
+    REQUIRE(delta_size < Led_Codec::get_frame_size(LED_MAX_COUNT));
+    REQUIRE(Led_Delta::get_base_sequence(buffer, delta_size) == 42);
+    REQUIRE(ntohl(reinterpret_cast<Led_Delta::led_delta_t*>(buffer)->delta_span_count) == 3);
+
+    Led_Delta::apply(buffer, delta_size, rebuilt.data(), LED_MAX_COUNT);
+    REQUIRE(memcmp(rebuilt.data(), leds.get_led_colors(), LED_MAX_COUNT * sizeof(Led_Strip::led_color_t)) == 0);
+
+    // an unchanged strip is an empty delta
+    delta_size = Led_Delta::encode_into(1, base.get_led_colors(), base.get_led_colors(), LED_MAX_COUNT, buffer, sizeof(buffer));
+    REQUIRE(delta_size == sizeof(Led_Delta::led_delta_t));
+
+    // every led changed - the full frame is smaller
+    leds.set_all_leds(9, 9, 9);
+    REQUIRE(Led_Delta::encode_into(1, base.get_led_colors(), leds.get_led_colors(), LED_MAX_COUNT, buffer, sizeof(buffer)) == 0);
+}
+
+TEST_CASE("Invalid delta frames leave the base unchanged", "[Led_Delta::apply]")
+{
+    Led_Strip base(10, 5, 5, 5);
+    Led_Strip leds(10, 5, 5, 5);
+    std::vector<Led_Strip::led_color_t> rebuilt(base.get_led_colors(), base.get_led_colors() + 10);
+    Led_Delta::led_span_t *span;
+    uint8_t buffer[LED_BUFFER_MAX_SIZE];
+    size_t delta_size;
+
+    leds.set_led_color(2, 0, 0, 0);
+    delta_size = Led_Delta::encode_into(1, base.get_led_colors(), leds.get_led_colors(), 10, buffer, sizeof(buffer));
+    REQUIRE(delta_size > 0);
+
+    // led count, truncated span, trailing bytes
+    REQUIRE_THROWS_AS(Led_Delta::apply(buffer, delta_size, rebuilt.data(), 9), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Delta::apply(buffer, delta_size - 1, rebuilt.data(), 10), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Delta::apply(buffer, delta_size + 1, rebuilt.data(), 10), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Delta::get_base_sequence(buffer, sizeof(Led_Delta::led_delta_t) - 1), std::runtime_error);
+
+    // span past the end of the strip
+    span = reinterpret_cast<Led_Delta::led_span_t*>(&buffer[sizeof(Led_Delta::led_delta_t)]);
+    span->span_start = htonl(10);
+    REQUIRE_THROWS_AS(Led_Delta::apply(buffer, delta_size, rebuilt.data(), 10), std::runtime_error);
+
+    REQUIRE(memcmp(rebuilt.data(), base.get_led_colors(), 10 * sizeof(Led_Strip::led_color_t)) == 0);
+}
+
+TEST_CASE("Compact frames use the cheapest encoding and rebuild the strip", "[Led_Compact::encode_into]")
+{
+    Led_Strip leds(LED_MAX_COUNT, 0, 0, 0);
+    Led_Strip rebuilt(0);
+    uint8_t buffer[LED_BUFFER_MAX_SIZE];
+    size_t encoded_size;
+    size_t compact_size;
+
+    // a few solid ranges - run-length
+    leds.set_led_color_range(0, 99, 255, 0, 0);
+    leds.set_led_color_range(100, 249, 0, 0, 255);
+    REQUIRE(Led_Compact::choose_encoding(leds.get_led_colors(), LED_MAX_COUNT, &encoded_size) == LED_COMPACT_RLE);
+    compact_size = Led_Compact::encode_into(leds.get_led_colors(), LED_MAX_COUNT, buffer, sizeof(buffer));
+    REQUIRE(compact_size == encoded_size);
+    REQUIRE(compact_size == sizeof(Led_Compact::led_compact_t) + 2 * sizeof(Led_Compact::led_run_t));
+    rebuilt.set_leds_from_compact(buffer, compact_size);
+    REQUIRE(rebuilt.get_led_count() == LED_MAX_COUNT);
+    REQUIRE(memcmp(rebuilt.get_led_colors(), leds.get_led_colors(), LED_MAX_COUNT * sizeof(Led_Strip::led_color_t)) == 0);
+
+    // four alternating colors - palette with 2 bit indexes
+    for (uint32_t i = 0; i < LED_MAX_COUNT; i++)
+    {
+        leds.set_led_color(i, (i % 4) * 10, 0, 0);
+    }
+    REQUIRE(Led_Compact::choose_encoding(leds.get_led_colors(), LED_MAX_COUNT, &encoded_size) == LED_COMPACT_PALETTE);
+    compact_size = Led_Compact::encode_into(leds.get_led_colors(), LED_MAX_COUNT, buffer, sizeof(buffer));
+    REQUIRE(compact_size == sizeof(Led_Compact::led_compact_t) + 4 * sizeof(Led_Strip::led_color_t) + (LED_MAX_COUNT * 2 + 7) / 8);
+    REQUIRE(reinterpret_cast<Led_Compact::led_compact_t*>(buffer)->compact_index_bits == 2);
+    rebuilt.set_leds_from_compact(buffer, compact_size);
+    REQUIRE(memcmp(rebuilt.get_led_colors(), leds.get_led_colors(), LED_MAX_COUNT * sizeof(Led_Strip::led_color_t)) == 0);
+
+    // every led a different color - raw
+    for (uint32_t i = 0; i < LED_MAX_COUNT; i++)
+    {
+        leds.set_led_color(i, i, 255 - i, i / 2);
+    }
+    REQUIRE(Led_Compact::choose_encoding(leds.get_led_colors(), LED_MAX_COUNT, &encoded_size) == LED_COMPACT_RAW);
+    REQUIRE(encoded_size == sizeof(Led_Compact::led_compact_t) + LED_MAX_COUNT * sizeof(Led_Strip::led_color_t));
+    REQUIRE_THROWS_AS(Led_Compact::encode_into(LED_COMPACT_RLE, leds.get_led_colors(), LED_MAX_COUNT, buffer, 100), std::runtime_error);
+
+    // every encoding decodes to the same strip, runs longer than one entry are split
+    Led_Strip long_strip(1000, 7, 8, 9);
+    std::vector<uint8_t> long_buffer(4 * 1000);
+    std::vector<Led_Strip::led_color_t> long_rebuilt(1000);
+
+    long_strip.set_led_color(500, 1, 2, 3);
+    for (int encoding = LED_COMPACT_RAW; encoding < LED_COMPACT_COUNT; encoding++)
+    {
+        compact_size = Led_Compact::encode_into((led_compact_encoding_t)encoding, long_strip.get_led_colors(), 1000, long_buffer.data(), long_buffer.size());
+        REQUIRE(Led_Compact::decode_into(long_buffer.data(), compact_size, long_rebuilt.data(), 1000) == 1000);
+        REQUIRE(memcmp(long_rebuilt.data(), long_strip.get_led_colors(), 1000 * sizeof(Led_Strip::led_color_t)) == 0);
+    }
+    REQUIRE(Led_Compact::encode_into(LED_COMPACT_RLE, long_strip.get_led_colors(), 1000, long_buffer.data(), long_buffer.size())
+            == sizeof(Led_Compact::led_compact_t) + 5 * sizeof(Led_Compact::led_run_t));
+}
+
+TEST_CASE("Invalid compact frames leave the strip unchanged", "[Led_Compact::validate]")
+{
+    Led_Strip leds(10, 5, 5, 5);
+    Led_Strip rebuilt(3, 1, 1, 1);
+    Led_Strip::led_color_t expected_led = { 1, 1, 1 };
+    std::vector<Led_Strip::led_color_t> colors(10);
+    Led_Compact::led_compact_t *compact_header;
+    uint8_t buffer[LED_BUFFER_MAX_SIZE];
+    size_t compact_size;
+
+    leds.set_led_color(2, 0, 0, 0);
+    leds.set_led_color(7, 9, 9, 9);
+    compact_size = Led_Compact::encode_into(LED_COMPACT_PALETTE, leds.get_led_colors(), 10, buffer, sizeof(buffer));
+    compact_header = reinterpret_cast<Led_Compact::led_compact_t*>(buffer);
+
+    // truncated, trailing bytes, no room in the caller's colors
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size - 1), std::runtime_error);
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size + 1), std::runtime_error);
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, sizeof(Led_Compact::led_compact_t) - 1), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Compact::decode_into(buffer, compact_size, colors.data(), 9), std::runtime_error);
+
+    // index bits too narrow for the palette, index out of range - 3 colors with 2 bit indexes
+    compact_header->compact_index_bits = 1;
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size), std::runtime_error);
+    compact_header->compact_index_bits = 2;
+    buffer[sizeof(Led_Compact::led_compact_t) + 3 * sizeof(Led_Strip::led_color_t)] = 0xff;
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size), std::runtime_error);
+
+    // runs that do not cover the strip, unknown encoding
+    compact_size = Led_Compact::encode_into(LED_COMPACT_RLE, leds.get_led_colors(), 10, buffer, sizeof(buffer));
+    compact_header->compact_led_count = htonl(11);
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size), std::runtime_error);
+    compact_header->compact_led_count = htonl(10);
+    compact_header->compact_encoding = LED_COMPACT_COUNT;
+    REQUIRE_THROWS_AS(rebuilt.set_leds_from_compact(buffer, compact_size), std::runtime_error);
+
+    REQUIRE(rebuilt.get_led_count() == 3);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        REQUIRE(memcmp(&rebuilt.get_led_colors()[i], &expected_led, sizeof(expected_led)) == 0);
+    }
+}
+
+TEST_CASE("Frame hashes change with every byte and the led count", "[Led_Codec::hash]")
+{
+    std::vector<uint8_t> data(100, 0x5a);
+    std::vector<uint64_t> hashes;
+    Led_Strip leds(LED_MAX_COUNT, 1, 2, 3);
+    Led_Codec::led_frame_view_t view;
+    uint64_t frame_hash;
+
+    // every length - lanes, remaining words and tail bytes
+    for (size_t size = 0; size <= data.size(); size++)
+    {
+        hashes.push_back(Led_Codec::hash(data.data(), size));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    REQUIRE(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+
+    // a single bit anywhere
+    hashes.clear();
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] ^= 0x01;
+        hashes.push_back(Led_Codec::hash(data.data(), data.size()));
+        data[i] ^= 0x01;
+    }
+    hashes.push_back(Led_Codec::hash(data.data(), data.size()));
+    std::sort(hashes.begin(), hashes.end());
+    REQUIRE(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+
+    view.led_count = LED_MAX_COUNT;
+    view.led_colors = leds.get_led_colors();
+    frame_hash = Led_Codec::get_frame_hash(view);
+    REQUIRE(Led_Codec::get_frame_hash(view) == frame_hash);
+
+    view.led_count = LED_MAX_COUNT - 1;
+    REQUIRE(Led_Codec::get_frame_hash(view) != frame_hash);
+
+    view.led_count = LED_MAX_COUNT;
+    leds.set_led_color(LED_MAX_COUNT - 1, 1, 2, 4);
+    REQUIRE(Led_Codec::get_frame_hash(view) != frame_hash);
+}
+
+TEST_CASE("Preset stores find and validate presets by id and name", "[Led_Preset_Store::find_preset]")
+{
+    Led_Strip red_leds(10, 255, 0, 0);
+    Led_Strip blue_leds(100, 0, 0, 255);
+    const char *store_path = "./test_presets.dat";
+    const uint8_t *frame = nullptr;
+    size_t frame_size = 0;
+    uint32_t preset_id = 0;
+
+    red_leds.save_all_leds("./test_preset_red.dat");
+    blue_leds.save_all_leds("./test_preset_blue.dat");
+
+    // ids are not in order and names are not required to be set
+    Led_Preset_Store::create(store_path, {
+            {7, "blue", "./test_preset_blue.dat"},
+            {3, "red", "./test_preset_red.dat"},
+            {5, "", "./test_preset_red.dat"}});
+
+    Led_Preset_Store store(store_path);
+    REQUIRE(store.get_preset_count() == 3);
+
+    REQUIRE(store.find_preset(7, &frame, &frame_size) == true);
+    REQUIRE(frame_size == Led_Codec::get_frame_size(100));
+    REQUIRE(std::vector<uint8_t>(frame, frame + frame_size) == blue_leds.get_led_net_frame());
+
+    REQUIRE(store.find_preset(3, &frame, &frame_size) == true);
+    REQUIRE(std::vector<uint8_t>(frame, frame + frame_size) == red_leds.get_led_net_frame());
+    REQUIRE(store.find_preset(5, &frame, &frame_size) == true);
+    REQUIRE(store.find_preset(4, &frame, &frame_size) == false);
+    REQUIRE(store.find_preset(8, &frame, &frame_size) == false);
+
+    REQUIRE(store.find_preset("blue", &preset_id) == true);
+    REQUIRE(preset_id == 7);
+    REQUIRE(store.find_preset("green", &preset_id) == false);
+
+    // duplicate ids are refused
+    REQUIRE_THROWS_AS(Led_Preset_Store::create("./test_presets_duplicate.dat", {
+            {1, "red", "./test_preset_red.dat"},
+            {1, "blue", "./test_preset_blue.dat"}}), std::invalid_argument);
+}
+
+TEST_CASE("Invalid preset stores are refused when opened or used", "[Led_Preset_Store::constructor]")
+{
+    Led_Strip red_leds(10, 255, 0, 0);
+    const char *store_path = "./test_presets_invalid.dat";
+    const uint8_t *frame = nullptr;
+    size_t frame_size = 0;
+    std::vector<uint8_t> store_data;
+
+    REQUIRE_THROWS_AS(Led_Preset_Store("./test_presets_missing.dat"), std::runtime_error);
+
+    red_leds.save_all_leds("./test_preset_red.dat");
+    Led_Preset_Store::create(store_path, {{1, "red", "./test_preset_red.dat"}});
+    {
+        std::ifstream input_file(store_path, std::ios::binary);
+        store_data.assign(std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>());
+    }
+
+    // write a modified copy of the store
+    auto write_store = [&](const std::vector<uint8_t> &data)
+    {
+        std::ofstream output_file(store_path, std::ios::trunc | std::ios::binary);
+        output_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    };
+
+    // bad magic, or more index entries than the file holds
+    std::vector<uint8_t> bad_store(store_data);
+    bad_store[0] = 'X';
+    write_store(bad_store);
+    REQUIRE_THROWS_AS(Led_Preset_Store(store_path), std::runtime_error);
+
+    bad_store = store_data;
+    bad_store[offsetof(Led_Preset_Store::led_preset_header_t, preset_count) + 3] = 100;
+    write_store(bad_store);
+    REQUIRE_THROWS_AS(Led_Preset_Store(store_path), std::runtime_error);
+
+    // a frame cut short is only found when the preset is used
+    bad_store = store_data;
+    bad_store.resize(bad_store.size() - 1);
+    write_store(bad_store);
+    {
+        Led_Preset_Store store(store_path);
+
+        REQUIRE_THROWS_AS(store.find_preset(1, &frame, &frame_size), std::runtime_error);
+    }
+
+    // a frame with a corrupted led count
+    bad_store = store_data;
+    bad_store[sizeof(Led_Preset_Store::led_preset_header_t) + sizeof(Led_Preset_Store::led_preset_entry_t) + LED_MAGIC_LEN + 3] = 11;
+    write_store(bad_store);
+    {
+        Led_Preset_Store store(store_path);
+
+        REQUIRE_THROWS_AS(store.find_preset(1, &frame, &frame_size), std::runtime_error);
+    }
+}
+
+TEST_CASE("Multi-strip frames carry one frame per strip id", "[Led_Multi::decode]")
+{
+    Led_Strip first_leds(10, 255, 0, 0);
+    Led_Strip second_leds(LED_MAX_COUNT, 0, 255, 0);
+    Led_Strip empty_leds(0);
+    std::vector<Led_Multi::led_strip_ref_t> strips = {{3, &first_leds}, {0, &second_leds}, {LED_MAX_STRIPS - 1, &empty_leds}};
+    Led_Multi::led_strip_view_t strip_views[LED_MAX_STRIPS];
+    std::vector<uint8_t> buffer(LED_MULTI_MAX_SIZE);
+    size_t multi_size;
+
+    multi_size = Led_Multi::encode_into(strips.data(), strips.size(), buffer.data(), buffer.size());
+    REQUIRE(multi_size == sizeof(Led_Multi::led_multi_t) + (3 * sizeof(Led_Multi::led_strip_frame_t))
+            + Led_Codec::get_frame_size(10) + Led_Codec::get_frame_size(LED_MAX_COUNT) + Led_Codec::get_frame_size(0));
+
+    REQUIRE(Led_Multi::decode(buffer.data(), multi_size, strip_views, LED_MAX_STRIPS) == 3);
+    REQUIRE(strip_views[0].strip_id == 3);
+    REQUIRE(std::vector<uint8_t>(strip_views[0].led_frame, strip_views[0].led_frame + strip_views[0].frame_size) == first_leds.get_led_net_frame());
+    REQUIRE(strip_views[1].strip_id == 0);
+    REQUIRE(std::vector<uint8_t>(strip_views[1].led_frame, strip_views[1].led_frame + strip_views[1].frame_size) == second_leds.get_led_net_frame());
+    REQUIRE(strip_views[2].strip_id == LED_MAX_STRIPS - 1);
+    REQUIRE(strip_views[2].frame_size == sizeof(Led_Strip::led_net_t));
+
+    // every strip fits the largest message
+    std::vector<Led_Multi::led_strip_ref_t> all_strips;
+    for (uint32_t i = 0; i < LED_MAX_STRIPS; i++)
+    {
+        all_strips.push_back({i, &second_leds});
+    }
+    multi_size = Led_Multi::encode_into(all_strips.data(), all_strips.size(), buffer.data(), buffer.size());
+    REQUIRE(multi_size == LED_MULTI_MAX_SIZE);
+    REQUIRE(Led_Multi::decode(buffer.data(), multi_size, strip_views, LED_MAX_STRIPS) == LED_MAX_STRIPS);
+    REQUIRE_THROWS_AS(Led_Multi::decode(buffer.data(), multi_size, strip_views, LED_MAX_STRIPS - 1), std::runtime_error);
+
+    all_strips.push_back({0, &first_leds});
+    REQUIRE_THROWS_AS(Led_Multi::encode_into(all_strips.data(), all_strips.size(), buffer.data(), buffer.size()), std::runtime_error);
+}
+
+TEST_CASE("Invalid multi-strip frames are refused as a whole", "[Led_Multi::decode]")
+{
+    Led_Strip first_leds(10, 255, 0, 0);
+    Led_Strip second_leds(20, 0, 255, 0);
+    std::vector<Led_Multi::led_strip_ref_t> strips = {{1, &first_leds}, {2, &second_leds}};
+    Led_Multi::led_strip_view_t strip_views[LED_MAX_STRIPS];
+    std::vector<uint8_t> buffer(LED_MULTI_MAX_SIZE);
+    std::vector<uint8_t> multi;
+    size_t second_offset = sizeof(Led_Multi::led_multi_t) + sizeof(Led_Multi::led_strip_frame_t) + Led_Codec::get_frame_size(10);
+
+    multi.assign(buffer.begin(), buffer.begin() + Led_Multi::encode_into(strips.data(), strips.size(), buffer.data(), buffer.size()));
+
+    // cut short, or bytes after the last strip
+    REQUIRE_THROWS_AS(Led_Multi::decode(multi.data(), multi.size() - 1, strip_views, LED_MAX_STRIPS), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Multi::decode(buffer.data(), multi.size() + 1, strip_views, LED_MAX_STRIPS), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Multi::decode(multi.data(), sizeof(Led_Multi::led_multi_t) - 1, strip_views, LED_MAX_STRIPS), std::runtime_error);
+
+    // no strips, a repeated or out of range strip id, a bad sub-frame magic
+    std::vector<uint8_t> bad_multi(multi);
+    bad_multi[3] = 0;
+    REQUIRE_THROWS_AS(Led_Multi::decode(bad_multi.data(), bad_multi.size(), strip_views, LED_MAX_STRIPS), std::runtime_error);
+
+    bad_multi = multi;
+    bad_multi[second_offset + 3] = 1;
+    REQUIRE_THROWS_AS(Led_Multi::decode(bad_multi.data(), bad_multi.size(), strip_views, LED_MAX_STRIPS), std::runtime_error);
+
+    bad_multi = multi;
+    bad_multi[second_offset + 3] = LED_MAX_STRIPS;
+    REQUIRE_THROWS_AS(Led_Multi::decode(bad_multi.data(), bad_multi.size(), strip_views, LED_MAX_STRIPS), std::runtime_error);
+
+    bad_multi = multi;
+    bad_multi[second_offset + sizeof(Led_Multi::led_strip_frame_t)] = 'X';
+    REQUIRE_THROWS_AS(Led_Multi::decode(bad_multi.data(), bad_multi.size(), strip_views, LED_MAX_STRIPS), std::runtime_error);
+
+    REQUIRE(Led_Multi::decode(multi.data(), multi.size(), strip_views, LED_MAX_STRIPS) == 2);
+}
+
+TEST_CASE("Led_Dispatch_Pool runs every task once and reports task errors", "[Led_Dispatch_Pool::run]")
+{
+    Led_Dispatch_Pool dispatch_pool(3);
+    Led_Dispatch_Pool serial_pool(0);
+    std::vector<std::atomic<int>> run_counts(100);
+
+    REQUIRE(dispatch_pool.get_worker_count() == 3);
+
+    // batches reuse the same workers
+    for (int batch = 0; batch < 50; batch++)
+    {
+        dispatch_pool.run(run_counts.size(), [&](size_t i) { run_counts[i]++; });
+    }
+    serial_pool.run(run_counts.size(), [&](size_t i) { run_counts[i]++; });
+    for (std::atomic<int> &run_count : run_counts)
+    {
+        REQUIRE(run_count.load() == 51);
+    }
+
+    // the other tasks still run
+    REQUIRE_THROWS_AS(dispatch_pool.run(run_counts.size(), [&](size_t i)
+    {
+        run_counts[i]++;
+        if (i == 42)
+        {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+    for (std::atomic<int> &run_count : run_counts)
+    {
+        REQUIRE(run_count.load() == 52);
+    }
+}
+
+TEST_CASE("Timeline frames keep their offsets and are refused as a whole when invalid", "[Led_Timeline::decode]")
+{
+    std::vector<Led_Strip> strips = {Led_Strip(10, 1, 0, 0), Led_Strip(20, 2, 0, 0), Led_Strip(10, 3, 0, 0)};
+    Led_Timeline::led_timeline_ref_t frames[] = {{0, &strips[0]}, {16666, &strips[1]}, {16666, &strips[2]}};
+    Led_Timeline::led_timeline_view_t frame_views[LED_TIMELINE_MAX_FRAMES];
+    std::vector<uint8_t> timeline(1024);
+    uint32_t flags = 0;
+
+    timeline.resize(Led_Timeline::encode_into(frames, 3, LED_TIMELINE_FLAG_CONTINUE, timeline.data(), timeline.size()));
+    REQUIRE(timeline.size() == sizeof(Led_Timeline::led_timeline_t) + Led_Timeline::get_frame_size(10) * 2 + Led_Timeline::get_frame_size(20));
+
+    REQUIRE(Led_Timeline::decode(timeline.data(), timeline.size(), &flags, frame_views, LED_TIMELINE_MAX_FRAMES) == 3);
+    REQUIRE(flags == LED_TIMELINE_FLAG_CONTINUE);
+    REQUIRE(frame_views[1].offset_us == 16666);
+    REQUIRE(frame_views[2].offset_us == 16666);
+    REQUIRE(Led_Codec::decode_view(frame_views[1].led_frame, frame_views[1].frame_size).led_count == 20);
+    REQUIRE(Led_Codec::decode_view(frame_views[2].led_frame, frame_views[2].frame_size).led_colors[0].red == 3);
+
+    // too many frames for the caller, truncated, or trailing bytes
+    REQUIRE_THROWS_AS(Led_Timeline::decode(timeline.data(), timeline.size(), &flags, frame_views, 2), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Timeline::decode(timeline.data(), timeline.size() - 1, &flags, frame_views, LED_TIMELINE_MAX_FRAMES), std::runtime_error);
+    timeline.push_back(0);
+    REQUIRE_THROWS_AS(Led_Timeline::decode(timeline.data(), timeline.size(), &flags, frame_views, LED_TIMELINE_MAX_FRAMES), std::runtime_error);
+
+    // offsets may not go backwards
+    frames[2].offset_us = 100;
+    timeline.resize(1024);
+    timeline.resize(Led_Timeline::encode_into(frames, 3, 0, timeline.data(), timeline.size()));
+    REQUIRE_THROWS_AS(Led_Timeline::decode(timeline.data(), timeline.size(), &flags, frame_views, LED_TIMELINE_MAX_FRAMES), std::runtime_error);
+
+    REQUIRE_THROWS_AS(Led_Timeline::encode_into(frames, 3, 0, timeline.data(), 64), std::runtime_error);
+    REQUIRE_THROWS_AS(Led_Timeline::encode_into(frames, 0, 0, timeline.data(), timeline.size()), std::runtime_error);
+}
+
+TEST_CASE("Led_Playout_Queue shows frames at their time and skips overtaken ones", "[Led_Playout_Queue::wait_frame]")
+{
+    Led_Playout_Queue playout_queue(3);
+    Led_Strip leds(0);
+    std::vector<uint8_t> first_frame = Led_Strip(5, 1, 0, 0).get_led_net_frame();
+    std::vector<uint8_t> second_frame = Led_Strip(5, 2, 0, 0).get_led_net_frame();
+    std::vector<uint8_t> third_frame = Led_Strip(7, 3, 0, 0).get_led_net_frame();
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point play_time;
+    size_t skipped_count;
+
+    // two frames already due, one later
+    REQUIRE(playout_queue.push(now - std::chrono::milliseconds(2), first_frame.data(), first_frame.size()) == true);
+    REQUIRE(playout_queue.push(now - std::chrono::milliseconds(1), second_frame.data(), second_frame.size()) == true);
+    REQUIRE(playout_queue.push(now + std::chrono::milliseconds(20), third_frame.data(), third_frame.size()) == true);
+
+    // full, and out of order frames are refused
+    REQUIRE(playout_queue.push(now + std::chrono::milliseconds(30), first_frame.data(), first_frame.size()) == false);
+    REQUIRE(playout_queue.get_size() == 3);
+
+    // the newest due frame is shown, the one it overtook is skipped
+    REQUIRE(playout_queue.wait_frame(leds, &play_time, &skipped_count) == true);
+    REQUIRE(skipped_count == 1);
+    REQUIRE(leds.get_led_colors()[0].red == 2);
+    REQUIRE(playout_queue.push(now, first_frame.data(), first_frame.size()) == false);
+
+    // waits for the time of the last frame
+    REQUIRE(playout_queue.wait_frame(leds, &play_time, &skipped_count) == true);
+    REQUIRE(std::chrono::steady_clock::now() >= now + std::chrono::milliseconds(20));
+    REQUIRE(skipped_count == 0);
+    REQUIRE(leds.get_led_count() == 7);
+
+    // invalid frames are not queued
+    third_frame.pop_back();
+    REQUIRE_THROWS_AS(playout_queue.push(now, third_frame.data(), third_frame.size()), std::runtime_error);
+    REQUIRE(playout_queue.get_size() == 0);
+
+    REQUIRE(playout_queue.push(now + std::chrono::seconds(10), first_frame.data(), first_frame.size()) == true);
+    REQUIRE(playout_queue.clear() == 1);
+
+    // a waiting thread returns once the queue is stopped
+    std::thread stop_thread([&playout_queue]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        playout_queue.stop();
+    });
+    REQUIRE(playout_queue.wait_frame(leds, &play_time, &skipped_count) == false);
+    stop_thread.join();
+}
+
+TEST_CASE("Led_Triple_Buffer hands over the newest frame and collapses bursts", "[Led_Triple_Buffer::take]")
+{
+    Led_Triple_Buffer output_frames;
+    Led_Codec::led_frame_view_t view;
+    Led_Strip first_leds(5, 1, 0, 0);
+    Led_Strip second_leds(7, 2, 0, 0);
+    Led_Strip third_leds(3, 3, 0, 0);
+
+    REQUIRE(output_frames.take(&view) == false);
+
+    // a burst - only the last frame is taken
+    output_frames.publish({(uint32_t)first_leds.get_led_count(), first_leds.get_led_colors()});
+    output_frames.publish({(uint32_t)second_leds.get_led_count(), second_leds.get_led_colors()});
+    output_frames.publish({(uint32_t)third_leds.get_led_count(), third_leds.get_led_colors()});
+    REQUIRE(output_frames.take(&view) == true);
+    REQUIRE(view.led_count == 3);
+    REQUIRE(view.led_colors[2].red == 3);
+    REQUIRE(output_frames.take(&view) == false);
+    REQUIRE(output_frames.get_publish_count() == 3);
+    REQUIRE(output_frames.get_overwritten_count() == 2);
+
+    // the taken frame stays intact while the producer keeps publishing
+    output_frames.publish({(uint32_t)first_leds.get_led_count(), first_leds.get_led_colors()});
+    output_frames.publish({(uint32_t)second_leds.get_led_count(), second_leds.get_led_colors()});
+    REQUIRE(view.led_count == 3);
+    REQUIRE(view.led_colors[0].red == 3);
+    REQUIRE(output_frames.take(&view) == true);
+    REQUIRE(view.led_count == 7);
+
+    // a waiting consumer returns on timeout, and on a published frame
+    uint32_t wake_sequence = output_frames.get_wake_sequence();
+    output_frames.wait_frame(wake_sequence, 10);
+    REQUIRE(output_frames.take(&view) == false);
+
+    std::thread publish_thread([&output_frames, &first_leds]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        output_frames.publish({(uint32_t)first_leds.get_led_count(), first_leds.get_led_colors()});
+    });
+    wake_sequence = output_frames.get_wake_sequence();
+    while (!output_frames.take(&view))
+    {
+        output_frames.wait_frame(wake_sequence, -1);
+        wake_sequence = output_frames.get_wake_sequence();
+    }
+    publish_thread.join();
+    REQUIRE(view.led_count == 5);
+}
+
+TEST_CASE("Led_Triple_Buffer frames are never torn or taken out of order", "[Led_Triple_Buffer::publish]")
+{
+    Led_Triple_Buffer output_frames;
+    const int frame_count = 20000;
+    int taken_count = 0;
+    bool intact = true;
+    int last_value = -1;
+
+    // every frame holds one value in all leds, values increase
+    std::thread publish_thread([&output_frames]
+    {
+        std::vector<Led_Strip::led_color_t> led_colors(LED_MAX_COUNT);
+
+        for (int i = 0; i < frame_count; i++)
+        {
+            std::fill(led_colors.begin(), led_colors.end(), Led_Strip::led_color_t{(uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i});
+            output_frames.publish({(uint32_t)led_colors.size(), led_colors.data()});
+        }
+    });
+
+    while (last_value != frame_count - 1)
+    {
+        Led_Codec::led_frame_view_t view;
+        uint32_t wake_sequence = output_frames.get_wake_sequence();
+
+        if (!output_frames.take(&view))
+        {
+            output_frames.wait_frame(wake_sequence, 100);
+            continue;
+        }
+
+        int value = (view.led_colors[0].red << 16) | (view.led_colors[0].green << 8) | view.led_colors[0].blue;
+        for (uint32_t i = 1; i < view.led_count; i++)
+        {
+            intact = intact && std::memcmp(&view.led_colors[i], &view.led_colors[0], sizeof(view.led_colors[0])) == 0;
+        }
+        intact = intact && value > last_value;
+        last_value = value;
+        taken_count++;
+    }
+    publish_thread.join();
+
+    REQUIRE(intact == true);
+    REQUIRE(taken_count + output_frames.get_overwritten_count() == frame_count);
+}
+
+TEST_CASE("PruMem writes one word per led into the buffer it flips to", "[PruMem::write_mem_led_colors]")
+{
+    PruMem pru_mem((const void*)SHARED_MEM_START_ADDR);
+    Led_Strip leds(3, 0, 0, 0);
+    std::vector<uint32_t> pru_words(SHARED_MEM_SIZE / sizeof(uint32_t));
+
+    leds.set_led_color(0, 0x11, 0x22, 0x33);
+    leds.set_led_color(2, 0xff, 0x00, 0x80);
+
+    // without a PRU taking frames the host alternates between the buffers and never waits
+    for (int i = 0; i < 3; i++)
+    {
+        pru_mem.write_mem_led_count(leds.get_led_count());
+        pru_mem.write_mem_led_colors(leds.get_led_colors(), leds.get_led_count());
+        pru_mem.write_mem_led_start();
+    }
+    REQUIRE(pru_mem.get_wait_count() == 0);
+
+    std::ifstream pru_file(SHARED_MEM_MAP_FILE, std::ios::binary);
+    pru_file.read((char*)pru_words.data(), SHARED_MEM_SIZE);
+
+    // buffers 1, 0, then 1 again for sequence 3
+    REQUIRE(pru_words[SHARED_MEM_LED_BEGIN_WRITE_OFFSET] == ((3 << 1) | 1));
+    uint32_t *buffer = &pru_words[SHARED_MEM_LED_BUFFER_OFFSET + SHARED_MEM_LED_BUFFER_SIZE];
+    REQUIRE(buffer[SHARED_MEM_LED_COUNT_OFFSET] == 3);
+    REQUIRE(buffer[SHARED_MEM_LED_START_OFFSET] == 0x221133);
+    REQUIRE(buffer[SHARED_MEM_LED_START_OFFSET + 1] == 0);
+    REQUIRE(buffer[SHARED_MEM_LED_START_OFFSET + 2] == 0x00ff80);
+    REQUIRE(buffer[SHARED_MEM_LED_START_OFFSET + 3] == 0);
+    REQUIRE(pru_words[SHARED_MEM_LED_BUFFER_OFFSET + SHARED_MEM_LED_COUNT_OFFSET] == 3);
+
+    // a frame buffer holds WS2812_LED_COUNT leds
+    Led_Strip long_leds(WS2812_LED_COUNT + 1, 0, 0, 0);
+    REQUIRE_THROWS_AS(pru_mem.write_mem_led_colors(long_leds.get_led_colors(), long_leds.get_led_count()), std::invalid_argument);
+    REQUIRE_THROWS_AS(pru_mem.write_mem_led_count(WS2812_LED_COUNT + 1), std::invalid_argument);
+}
+
+TEST_CASE("PruMem waits for the simulated PRU only while both buffers are busy", "[PruMem::write_mem_led_start]")
+{
+    PruMem pru_mem((const void*)SHARED_MEM_START_ADDR);
+    Led_Pru_Sim pru_sim(WS2812_BIT_NS, 20000);
+    Led_Strip first_leds(4, 1, 0, 0);
+    Led_Strip second_leds(4, 2, 0, 0);
+    Led_Strip third_leds(6, 3, 0, 0);
+    auto write_frame = [&pru_mem](Led_Strip &leds)
+    {
+        pru_mem.write_mem_led_count(leds.get_led_count());
+        pru_mem.write_mem_led_colors(leds.get_led_colors(), leds.get_led_count());
+        pru_mem.write_mem_led_start();
+    };
+    auto wait_start = [&pru_sim](int start_count)
+    {
+        for (int i = 0; i < 1000 && pru_sim.get_start_count() < start_count; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // the PRU clocks out the first frame, the second goes to the other buffer without waiting
+    write_frame(first_leds);
+    wait_start(1);
+    REQUIRE(pru_sim.get_start_count() == 1);
+    write_frame(second_leds);
+    REQUIRE(pru_mem.get_wait_count() == 0);
+
+    // the second frame is pending and the first still busy - the third waits for the first buffer
+    auto start = std::chrono::steady_clock::now();
+    write_frame(third_leds);
+    REQUIRE(pru_mem.get_wait_count() == 1);
+    REQUIRE(pru_sim.get_frame_count() >= 1);
+    REQUIRE(std::chrono::steady_clock::now() - start > std::chrono::milliseconds(1));
+
+    // the newest frame is shown last, whole
+    for (int i = 0; i < 1000 && pru_sim.get_shown_leds().size() != 6; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::vector<Led_Strip::led_color_t> shown_leds = pru_sim.get_shown_leds();
+    REQUIRE(shown_leds.size() == 6);
+    REQUIRE(std::memcmp(shown_leds.data(), third_leds.get_led_colors(), shown_leds.size() * sizeof(shown_leds[0])) == 0);
+}
+
+TEST_CASE("Led_Pru_Sim clocks frames out at WS2812 timing and accounts for every flip", "[Led_Pru_Sim::get_stats]")
+{
+    PruMem pru_mem((const void*)SHARED_MEM_START_ADDR);
+    Led_Pru_Sim pru_sim;
+    const int flip_count = 20;
+    const uint32_t frame_us = WS2812_LED_COUNT * WS2812_LED_BIT_COUNT * WS2812_BIT_NS / 1000 + WS2812_RESET_US;
+
+    // flat out - the host waits whenever both buffers are busy, frames replaced while pending are dropped
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < flip_count; i++)
+    {
+        Led_Strip leds(WS2812_LED_COUNT, i, 0, 0);
+
+        pru_mem.write_mem_led_count(leds.get_led_count());
+        pru_mem.write_mem_led_colors(leds.get_led_colors(), leds.get_led_count());
+        pru_mem.write_mem_led_start();
+
+        // the first frame is clocked out before the rest follow
+        for (int j = 0; i == 0 && j < 1000 && pru_sim.get_start_count() == 0; j++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        Led_Pru_Sim::led_pru_sim_stats_t stats = pru_sim.get_stats();
+
+        if (stats.frame_count + stats.dropped_count == flip_count)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    Led_Pru_Sim::led_pru_sim_stats_t stats = pru_sim.get_stats();
+    REQUIRE(stats.frame_count + stats.dropped_count == flip_count);
+    REQUIRE(stats.frame_count >= 2);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::microseconds(stats.frame_count * frame_us));
+    REQUIRE(pru_sim.get_shown_leds()[0].red == flip_count - 1);
+
+    // 150 leds take 4.5 ms to clock out plus the latch, every frame waits at least that long after its flip
+    REQUIRE(stats.frame_us == frame_us);
+    REQUIRE(stats.refresh_rate == Approx(1e6 / frame_us));
+    REQUIRE(stats.latency_us_avg >= frame_us);
+    REQUIRE(stats.latency_us_max >= stats.queued_us_max + frame_us);
+    REQUIRE(pru_mem.get_wait_count() >= 1);
+}
+
+TEST_CASE("Led_Frame_Pacer ticks on a fixed schedule and counts missed ticks", "[Led_Frame_Pacer::wait_tick]")
+{
+    Led_Frame_Pacer frame_pacer(200);
+    Led_Frame_Pacer::led_pacer_stats_t stats;
+    int histogram_count = 0;
+
+    // the strip limits the rate
+    REQUIRE(Led_Frame_Pacer::get_max_refresh_rate() == 1000000 / WS2812_FRAME_US);
+    REQUIRE_THROWS_AS(Led_Frame_Pacer(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(Led_Frame_Pacer(Led_Frame_Pacer::get_max_refresh_rate() + 1), std::invalid_argument);
+
+    // 5 ms apart from the first wait
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(frame_pacer.wait_tick() == true);
+    }
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(49));
+
+    // ticks passing while busy are missed, the next wait returns at once
+    std::this_thread::sleep_for(std::chrono::milliseconds(22));
+    start = std::chrono::steady_clock::now();
+    REQUIRE(frame_pacer.wait_tick() == true);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(4));
+
+    stats = frame_pacer.get_stats();
+    REQUIRE(stats.tick_count == 11);
+    REQUIRE(stats.missed_tick_count >= 3);
+    for (int i = 0; i < LED_PACER_LATENESS_BUCKETS; i++)
+    {
+        histogram_count += stats.lateness_histogram[i];
+    }
+    REQUIRE(histogram_count == stats.tick_count);
+    REQUIRE(Led_Frame_Pacer::get_lateness_bucket_us(LED_PACER_LATENESS_BUCKETS - 1) == UINT32_MAX);
+
+    // a waiting thread returns once stopped
+    std::thread stop_thread([&frame_pacer]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        frame_pacer.stop();
+    });
+    while (frame_pacer.wait_tick())
+    {
+    }
+    stop_thread.join();
+    REQUIRE(frame_pacer.wait_tick() == false);
+}
+
+TEST_CASE("Led_Connection reports a send backlog until the peer reads its responses", "[Led_Connection::is_send_backlogged]")
+{
+    Led_Frame_Pool frame_pool(1);
+    uint8_t ack_message[LED_MSG_ACK_SIZE];
+    uint8_t peer_buffer[4096];
+    size_t ack_size = Led_Message::encode_ack_into(1, LED_ACK_STATUS_OK, 0, ack_message, sizeof(ack_message));
+    const uint8_t *data;
+    size_t size;
+    int sockets[2];
+    int send_size = 1;
+
+    // the socket accepts only a few responses, the rest stays queued in the connection
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets) == 0);
+    REQUIRE(setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &send_size, sizeof(send_size)) == 0);
+    {
+        Led_Connection connection(sockets[0], frame_pool);
+
+        while (!connection.is_send_backlogged())
+        {
+            connection.queue_send(ack_message, ack_size);
+        }
+        REQUIRE(connection.has_pending_send() == true);
+
+        // reading on the peer side drains the queue
+        while (connection.has_pending_send())
+        {
+            REQUIRE(recv(sockets[1], peer_buffer, sizeof(peer_buffer), 0) > 0);
+            connection.send_pending();
+        }
+        REQUIRE(connection.is_send_backlogged() == false);
+
+        // completion based sends count the block in flight until it completed
+        connection.set_deferred_send(true);
+        while (!connection.is_send_backlogged())
+        {
+            connection.queue_send(ack_message, ack_size);
+        }
+        REQUIRE(connection.start_send(&data, &size) == true);
+        REQUIRE(size > LED_CONNECTION_SEND_LIMIT);
+        REQUIRE(connection.is_send_backlogged() == true);
+        connection.complete_send(size - ack_size);
+        REQUIRE(connection.is_send_backlogged() == false);
+        REQUIRE(connection.has_pending_send() == true);
+    }
+    close(sockets[1]);
+}
+
+TEST_CASE("Led_Uring keeps every operation queued beyond a full ring", "[Led_Uring::get_sqe]")
+{
+    const int operation_count = 200;
+    std::vector<int> completed(operation_count + 1, 0);
+    std::unique_ptr<Led_Uring> uring;
+    struct io_uring_cqe cqe;
+    int completion_count = 0;
+    int pipe_fds[2];
+
+    // kernels without io_uring have nothing to test
+    try
+    {
+        uring.reset(new Led_Uring(4));
+    }
+    catch (const std::runtime_error& e)
+    {
+        WARN("io_uring not available: " << e.what());
+        return;
+    }
+
+    // polls on a readable pipe complete at once, far more than both rings hold are queued without reaping
+    REQUIRE(pipe(pipe_fds) == 0);
+    REQUIRE(write(pipe_fds[1], "x", 1) == 1);
+    for (int i = 1; i <= operation_count; i++)
+    {
+        uring->prep_poll(pipe_fds[0], POLLIN, i);
+    }
+
+    while (completion_count < operation_count)
+    {
+        uring->submit_and_wait(1, 1000);
+        if (!uring->get_completion(cqe))
+        {
+            break;
+        }
+
+        do
+        {
+            REQUIRE(cqe.user_data >= 1);
+            REQUIRE(cqe.user_data <= operation_count);
+            REQUIRE(cqe.res > 0);
+            completed[cqe.user_data]++;
+            completion_count++;
+        } while (uring->get_completion(cqe));
+    }
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    REQUIRE(completion_count == operation_count);
+    REQUIRE(std::count(completed.begin() + 1, completed.end(), 1) == operation_count);
+}